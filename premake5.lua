@@ -12,18 +12,16 @@ ndkstl "c++_static"
 ndkplatform "android-24"
 
 newoption {
-	trigger = "disable-load-delay-slots",
-	description = "Disable load delay slots (faster execution)",
+	trigger = "disable-fastmem",
+	description = "Disable guest memory mapping into host address space (Linux x86-64 only)",
 }
-filter "not options:disable-load-delay-slots"
-	defines "ENABLE_LOAD_DELAY_SLOTS"
+filter "not options:disable-fastmem"
+	defines "ENABLE_FASTMEM"
 
 newoption {
-	trigger = "enable-io-log",
-	description = "Enable IO access log",
+	trigger = "headless",
+	description = "Build avocado without SDL and GUI, runs given file and reports emulation speed",
 }
-filter "options:enable-io-log"
-	defines "ENABLE_IO_LOG"
 
 newoption {
     trigger = "asan",
@@ -83,6 +81,14 @@ filter {"kind:*App", "platforms:x86"}
 filter {"kind:*App", "system:android"}
 	targetdir "build/%{cfg.buildcfg}"
 
+filter {"kind:*App or SharedLib", "system:linux"}
+	links { "dl" } -- AOT modules
+	links { "pthread" }
+
+filter "system:linux"
+	pic "On" -- Static libraries are linked into avocado_lib
+	buildoptions { "-fno-semantic-interposition" } -- Keep inlining of global functions (INLINE) with PIC
+
 filter "configurations:Debug"
 	defines { "DEBUG" }
 	symbols "On"
@@ -185,7 +191,8 @@ project "avocado"
 	filter "options:headless"
 		files { 
 			"src/platform/headless/**.cpp",
-			"src/platform/headless/**.h"
+			"src/platform/headless/**.h",
+			"src/platform/null/**.*"
 		}
 
 	filter {"system:windows", "not options:headless"}
@@ -232,7 +239,7 @@ project "avocado"
 		linkoptions {getOutput("sdl2-config --libs")}
 		
 
-	filter {"system:macosx"}
+	filter {"system:macosx", "not options:headless"}
 	    kind "WindowedApp"
 		files { 
 			"src/imgui/**.*",
@@ -269,6 +276,33 @@ project "avocado"
 			"SDL2",
 		}
 
+project "avocado_lib"
+	uuid "5a0d7e3b-8c19-4f62-b4e1-9d2c6f8a3b70"
+	kind "SharedLib"
+	location "build/libs/avocado_lib"
+	targetdir "build/%{cfg.buildcfg}_%{cfg.platform}"
+
+	includedirs { 
+		"src", 
+		"externals/glm",
+		"externals/json/include",
+		"externals/EventBus/lib/include",
+	}
+
+	files { 
+		"src/platform/null/**.*",
+		"src/platform/library/**.h",
+		"src/platform/library/**.cpp"
+	}
+
+	links {
+		"core",
+		"miniz",
+		"chdr",
+		"lzma",
+		"flac",
+	}
+
 project "avocado_test"
 	uuid "07e62c76-7617-4add-bfb5-a5dba4ef41ce"
 	kind "ConsoleApp"
@@ -277,22 +311,85 @@ project "avocado_test"
 
 	includedirs { 
 		"src", 
-		"externals/catch/single_include"
+		"externals/catch/single_include",
+		"externals/glm",
+		"externals/json/include",
+		"externals/EventBus/lib/include",
 	}
 
 	files { 
 		"src/platform/null/**.*",
+		"tools/aot/translator.h",
+		"tools/aot/translator.cpp",
 		"tests/unit/**.h",
 		"tests/unit/**.cpp"
 	}
 
 	links {
-		"core"
+		"core",
+		"miniz",
+		"chdr",
+		"lzma",
+		"flac",
 	}
 
 	-- filter {"system:android"}
 	-- 	kind "SharedLib"
 
+project "avocado_benchmark"
+	uuid "9b3f1c2e-5d4a-4e8b-a6f7-2c1d0e9b8a73"
+	kind "ConsoleApp"
+	location "build/libs/avocado_benchmark"
+	debugdir "."
+
+	includedirs { 
+		"src", 
+		"externals/glm",
+		"externals/json/include",
+		"externals/EventBus/lib/include",
+	}
+
+	files { 
+		"src/platform/null/**.*",
+		"tests/benchmark/**.h",
+		"tests/benchmark/**.cpp"
+	}
+
+	links {
+		"core",
+		"miniz",
+		"chdr",
+		"lzma",
+		"flac",
+	}
+
+project "avocado_aot"
+	uuid "3e8a2f6d-7c41-4b9e-9d25-6f0b1a8c4e52"
+	kind "ConsoleApp"
+	location "build/libs/avocado_aot"
+	debugdir "."
+
+	includedirs { 
+		"src", 
+		"externals/glm",
+		"externals/json/include",
+		"externals/EventBus/lib/include",
+	}
+
+	files { 
+		"src/platform/null/**.*",
+		"tools/aot/**.h",
+		"tools/aot/**.cpp"
+	}
+
+	links {
+		"core",
+		"miniz",
+		"chdr",
+		"lzma",
+		"flac",
+	}
+
 project "avocado_autotest"
 	uuid "fcc880bc-c6fe-4b2b-80dc-d247345a1274"
 	kind "ConsoleApp"
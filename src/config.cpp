@@ -152,6 +152,7 @@ const json defaultConfig = {
     {"options", {
         {"graphics", {
             {"rendering_mode", RenderingMode::SOFTWARE},
+            {"render_threads", 0u},
             {"filtering", false},
             {"widescreen", false},
             {"forceWidescreen", false},
@@ -160,6 +161,31 @@ const json defaultConfig = {
                 {"height", 480u}
             }},
             {"vsync", false}
+        }},
+        {"system", {
+            {"cpu_core", CpuCore::INTERPRETER},
+            {"fastmem", false},
+            {"skip_idle_loops", true},
+            {"load_delay_slots", true},
+            {"cpu_multiplier", 1.0},
+            {"aot_module", ""}
+        }},
+        {"rewind", {
+            {"enabled", false},
+            {"budget_mb", 128u},
+            {"interval", 1u}
+        }},
+        {"run_ahead", {
+            {"frames", 0u},
+            {"auto", true}
+        }},
+        {"frameskip", {
+            {"frames", 0u},
+            {"auto", true}
+        }},
+        {"fast_forward", {
+            {"speed", 0u},
+            {"skip_presenting", true}
         }}
     }},
     {"debug", {
@@ -24,6 +24,13 @@ NLOHMANN_JSON_SERIALIZE_ENUM(RenderingMode, {
                                                 {RenderingMode::MIXED, "mixed"},
                                             });
 
+enum CpuCore { INTERPRETER, CACHED_INTERPRETER, JIT };
+NLOHMANN_JSON_SERIALIZE_ENUM(CpuCore, {
+                                          {CpuCore::INTERPRETER, "interpreter"},
+                                          {CpuCore::CACHED_INTERPRETER, "cached_interpreter"},
+                                          {CpuCore::JIT, "jit"},
+                                      });
+
 extern const char* CONFIG_NAME;
 extern const nlohmann::json defaultConfig;
 extern nlohmann::json config;
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include "cpu/opcode.h"
+
+// Interface between Avocado and code generated by avocado_aot.
+// Generated sources include only this header, CPU state is accessed through Context.
+
+#ifdef _WIN32
+#define AOT_EXPORT __declspec(dllexport)
+#else
+#define AOT_EXPORT __attribute__((visibility("default")))
+#endif
+
+namespace mips {
+struct CPU;
+};
+
+namespace mips::aot {
+// Bump on every change of structures below, modules with different version are rejected
+const uint32_t ABI_VERSION = 1;
+
+typedef void (*Handler)(CPU* cpu, Opcode i);
+
+struct Context {
+    CPU* cpu;
+    uint32_t* reg;
+    uint32_t* hi;
+    uint32_t* lo;
+    uint32_t* PC;
+    uint32_t* nextPC;
+    uint32_t* exceptionPC;
+    bool* exceptionIsInBranchDelay;
+    bool* exceptionIsBranchTaken;
+    bool* inBranchDelay;
+    bool* branchTaken;
+    Opcode* opcode;
+    bool* attention;
+
+    bool loadDelaySlots;
+    // Interpreter handlers for current CPU features, indexed by instructions::handlerIndex
+    const Handler* handlers;
+    void (*moveLoadDelaySlots)(CPU* cpu);
+    void (*invalidateSlot)(CPU* cpu, uint32_t r);
+};
+
+// Returns number of guest instructions executed (same as jit::BlockFunction)
+typedef int (*BlockFunction)(Context* c);
+
+struct BlockEntry {
+    uint32_t address;      // virtual address the block was translated for
+    uint32_t count;        // instructions
+    const uint32_t* code;  // original instructions, block is used only if memory still holds them
+    BlockFunction function;
+};
+
+struct ModuleInfo {
+    uint32_t version;
+    uint32_t count;
+    const BlockEntry* blocks;
+};
+
+// Exported by generated module
+#define AOT_MODULE_SYMBOL "avocadoAotModule"
+
+// saveStateForException and setPC(nextPC) for instruction at address known at translation time
+inline void begin(Context* c, uint32_t pc, uint32_t opcode) {
+    *c->exceptionPC = pc;
+    *c->exceptionIsInBranchDelay = false;
+    *c->exceptionIsBranchTaken = false;
+    *c->opcode = Opcode(opcode);
+    *c->PC = pc + 4;
+    *c->nextPC = pc + 8;
+}
+
+// Same for first instruction of block and delay slots, state depends on how the instruction was reached
+inline void beginDynamic(Context* c, uint32_t opcode) {
+    *c->exceptionPC = *c->PC;
+    *c->exceptionIsInBranchDelay = *c->inBranchDelay;
+    *c->exceptionIsBranchTaken = *c->branchTaken;
+    *c->inBranchDelay = false;
+    *c->branchTaken = false;
+    *c->opcode = Opcode(opcode);
+    *c->PC = *c->nextPC;
+    *c->nextPC = *c->PC + 4;
+}
+
+// Runs instruction with interpreter handler
+inline void execute(Context* c, uint32_t index, uint32_t opcode) { c->handlers[index](c->cpu, Opcode(opcode)); }
+
+// Register written by natively translated instruction, equivalent of CPU::loadAndInvalidate
+inline void invalidate(Context* c, uint32_t r) {
+    if (c->loadDelaySlots) c->invalidateSlot(c->cpu, r);
+}
+
+inline void moveLoadDelaySlots(Context* c) {
+    if (c->loadDelaySlots) c->moveLoadDelaySlots(c->cpu);
+}
+};  // namespace mips::aot
@@ -0,0 +1,84 @@
+#include "aot.h"
+#include <cstdio>
+#include "cpu/block_cache.h"
+#include "system.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace mips::aot {
+namespace {
+// RAM mirrors share translations
+uint32_t normalize(uint32_t address) {
+    address &= 0x1fffffff;
+    if (address < System::RAM_SIZE * 4) address &= System::RAM_SIZE - 1;
+    return address;
+}
+
+void* openLibrary(const std::string& path) {
+#ifdef _WIN32
+    return LoadLibraryA(path.c_str());
+#else
+    return dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+void* getSymbol(void* handle, const char* name) {
+#ifdef _WIN32
+    return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(handle), name));
+#else
+    return dlsym(handle, name);
+#endif
+}
+
+void closeLibrary(void* handle) {
+#ifdef _WIN32
+    FreeLibrary(static_cast<HMODULE>(handle));
+#else
+    dlclose(handle);
+#endif
+}
+};  // namespace
+
+std::unique_ptr<Module> Module::load(const std::string& path) {
+    void* handle = openLibrary(path);
+    if (handle == nullptr) {
+        printf("[AOT]: Unable to load %s\n", path.c_str());
+        return nullptr;
+    }
+
+    auto info = static_cast<const ModuleInfo*>(getSymbol(handle, AOT_MODULE_SYMBOL));
+    if (info == nullptr || info->version != ABI_VERSION) {
+        printf("[AOT]: %s is not compatible with this version\n", path.c_str());
+        closeLibrary(handle);
+        return nullptr;
+    }
+
+    auto module = std::unique_ptr<Module>(new Module());
+    module->path = path;
+    module->handle = handle;
+    for (uint32_t i = 0; i < info->count; i++) {
+        module->blocks[normalize(info->blocks[i].address)] = &info->blocks[i];
+    }
+    printf("[AOT]: Loaded %s (%zu blocks)\n", path.c_str(), module->blocks.size());
+    return module;
+}
+
+Module::~Module() {
+    if (handle != nullptr) closeLibrary(handle);
+}
+
+const BlockEntry* Module::find(const Block& block) const {
+    auto it = blocks.find(normalize(block.address));
+    if (it == blocks.end()) return nullptr;
+
+    const BlockEntry* entry = it->second;
+    if (entry->count != block.instructions.size()) return nullptr;
+    for (uint32_t i = 0; i < entry->count; i++) {
+        if (entry->code[i] != block.instructions[i].opcode.opcode) return nullptr;
+    }
+    return entry;
+}
+};  // namespace mips::aot
@@ -0,0 +1,36 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "abi.h"
+
+namespace mips {
+struct Block;
+};
+
+namespace mips::aot {
+/**
+ * Blocks translated ahead of time by avocado_aot, loaded from shared object.
+ * BlockCache attaches translation to a block only if memory holds exactly the translated code,
+ * anything else (code that wasn't found by translator or was modified) runs on cached interpreter or JIT.
+ */
+class Module {
+   public:
+    // Returns nullptr if file can't be loaded or was generated for different ABI version
+    static std::unique_ptr<Module> load(const std::string& path);
+    ~Module();
+
+    const std::string& getPath() const { return path; }
+    size_t getBlockCount() const { return blocks.size(); }
+
+    // Translation of block with identical instructions, block address is physical
+    const BlockEntry* find(const Block& block) const;
+
+   private:
+    Module() = default;
+
+    std::string path;
+    void* handle = nullptr;
+    std::unordered_map<uint32_t, const BlockEntry*> blocks;  // Indexed by physical address
+};
+};  // namespace mips::aot
@@ -0,0 +1,186 @@
+#include "block_cache.h"
+#include <cstring>
+#include "cpu/instructions.h"
+#include "system.h"
+
+namespace mips {
+static_assert(BlockCache::PAGE_SIZE == System::RAM_PROTECTION_PAGE_SIZE, "Code pages must match RAM write protection");
+
+namespace {
+// Register masks used by instructions allowed in idle loops, returns false for stores, mult/div, cop and links
+bool getRegisterUsage(Opcode i, uint32_t& reads, uint32_t& writes) {
+    reads = 0;
+    writes = 0;
+    if (i.op == 0) {
+        if (i.fun == 0 || i.fun == 2 || i.fun == 3) {  // sll, srl, sra
+            reads = 1 << i.rt;
+        } else if (i.fun == 4 || i.fun == 6 || i.fun == 7 || (i.fun >= 32 && i.fun <= 39) || i.fun == 42 || i.fun == 43) {
+            reads = (1 << i.rs) | (1 << i.rt);  // sllv, srlv, srav, add .. nor, slt, sltu
+        } else if (i.fun != 16 && i.fun != 18) {  // mfhi, mflo (hi/lo can't change in the loop)
+            return false;
+        }
+        writes = 1 << i.rd;
+        return true;
+    }
+
+    if (i.op == 1) {  // bltz, bgez
+        reads = 1 << i.rs;
+        return i.rt == 0 || i.rt == 1;
+    }
+    if (i.op == 2) return true;  // j
+    if (i.op == 4 || i.op == 5) {  // beq, bne
+        reads = (1 << i.rs) | (1 << i.rt);
+        return true;
+    }
+    if (i.op == 6 || i.op == 7) {  // blez, bgtz
+        reads = 1 << i.rs;
+        return true;
+    }
+    if ((i.op >= 8 && i.op <= 14) || i.op == 32 || i.op == 33 || i.op == 35 || i.op == 36 || i.op == 37) {
+        reads = 1 << i.rs;  // addi .. xori, lb, lh, lw, lbu, lhu
+        writes = 1 << i.rt;
+        return true;
+    }
+    if (i.op == 15) {  // lui
+        writes = 1 << i.rt;
+        return true;
+    }
+    return false;
+}
+
+// Loop that branches back to its start and doesn't read registers it modifies
+// ends every iteration in the same state until memory it reads changes.
+bool isIdleLoop(const Block& block, uint32_t address) {
+    const auto& instructions = block.instructions;
+    if (instructions.size() < 2) return false;
+
+    const size_t branchIndex = instructions.size() - 2;
+    const Opcode branch = instructions[branchIndex].opcode;
+    const uint32_t branchAddress = address + branchIndex * 4;
+    if (branch.op == 2) {
+        if (branch.target * 4 != (address & 0x0fffffff)) return false;
+    } else if (!Block::isBranch(branch) || branch.op == 0 || branch.op == 3) {
+        return false;
+    } else if (branchAddress + 4 + branch.offset * 4 != address) {
+        return false;
+    }
+
+    uint32_t written = 0;
+    uint32_t readFirst = 0;    // Registers read before being written in the iteration
+    uint32_t pendingLoad = 0;  // Load delay slot
+    for (const auto& instruction : instructions) {
+        uint32_t reads, writes;
+        if (!getRegisterUsage(instruction.opcode, reads, writes)) return false;
+
+        // Reading or overwriting register with pending load depends on previous iteration
+        readFirst |= reads & (~written | pendingLoad);
+        if (writes & pendingLoad) return false;
+        written |= pendingLoad;
+
+        pendingLoad = Block::isLoad(instruction.opcode) ? writes : 0;
+        if (pendingLoad == 0) written |= writes;
+    }
+    written |= pendingLoad;
+
+    return (readFirst & written & ~1u) == 0;
+}
+};  // namespace
+
+BlockCache::BlockCache(CPU* cpu) : cpu(cpu) {
+    ramBlocks.resize(RAM_SIZE / 4);
+    biosBlocks.resize(BIOS_SIZE / 4);
+    ramCodePages.fill(false);
+}
+
+Block* BlockCache::getBlock(uint32_t address) {
+    if (!released.empty()) released.clear();
+
+    uint32_t addr = address & 0x1fffffff;
+    std::unique_ptr<Block>* entry;
+    if (addr < RAM_SIZE * 4) {
+        entry = &ramBlocks[(addr & (RAM_SIZE - 1)) / 4];
+    } else if (addr >= System::BIOS_BASE && addr < System::BIOS_BASE + BIOS_SIZE) {
+        entry = &biosBlocks[(addr - System::BIOS_BASE) / 4];
+    } else {
+        return nullptr;
+    }
+
+    if (likely(*entry)) return entry->get();
+
+    *entry = compile(addr);
+    return entry->get();
+}
+
+std::unique_ptr<Block> BlockCache::compile(uint32_t address) {
+    bool inRam = address < RAM_SIZE * 4;
+    uint8_t* memory = inRam ? cpu->sys->ram : cpu->sys->bios;
+    uint32_t mask = inRam ? RAM_SIZE - 1 : BIOS_SIZE - 1;
+    uint32_t base = inRam ? address & mask : address - System::BIOS_BASE;
+
+    auto block = std::make_unique<Block>();
+    block->address = address;
+    block->instructions.reserve(8);
+
+    bool delaySlot = false;
+    for (uint32_t offset = base; block->instructions.size() < MAX_BLOCK_SIZE && offset <= mask; offset += 4) {
+        Opcode opcode(*reinterpret_cast<uint32_t*>(memory + offset));
+        block->instructions.push_back({instructions::decode(cpu->enabledFeatures, opcode), opcode});
+
+        if (delaySlot || Block::isException(opcode)) break;
+        delaySlot = Block::isBranch(opcode);
+    }
+    block->idleLoop = isIdleLoop(*block, address);
+    if (cpu->aotModule) block->aot = cpu->aotModule->find(*block);
+
+    if (inRam) {
+        uint32_t end = base + block->instructions.size() * 4 - 1;
+        for (uint32_t page = base / PAGE_SIZE; page <= end / PAGE_SIZE; page++) {
+            if (!ramCodePages[page]) cpu->sys->setRamWriteProtection(page * PAGE_SIZE, true);
+            ramCodePages[page] = true;
+            pageBlocks[page].push_back(base / 4);
+        }
+    }
+    return block;
+}
+
+void BlockCache::invalidatePage(int page) {
+    for (uint32_t index : pageBlocks[page]) {
+        if (ramBlocks[index]) released.push_back(std::move(ramBlocks[index]));
+    }
+    pageBlocks[page].clear();
+    ramCodePages[page] = false;
+    cpu->attention = true;  // Current block might be invalidated
+    cpu->sys->setRamWriteProtection(page * PAGE_SIZE, false);
+}
+
+void BlockCache::flush() {
+    for (int page = 0; page < RAM_PAGES; page++) {
+        if (ramCodePages[page]) invalidatePage(page);
+    }
+    for (auto& block : biosBlocks) {
+        if (block) released.push_back(std::move(block));
+    }
+    cpu->attention = true;
+}
+
+void BlockCache::saveCodePages() {
+    savedPages.clear();
+    savedContents.clear();
+    for (int page = 0; page < RAM_PAGES; page++) {
+        if (!ramCodePages[page]) continue;
+        const uint8_t* contents = cpu->sys->ram + page * PAGE_SIZE;
+        savedPages.push_back(page);
+        savedContents.insert(savedContents.end(), contents, contents + PAGE_SIZE);
+    }
+}
+
+void BlockCache::invalidateChangedPages() {
+    for (size_t i = 0; i < savedPages.size(); i++) {
+        int page = savedPages[i];
+        if (!ramCodePages[page]) continue;
+        if (memcmp(savedContents.data() + i * PAGE_SIZE, cpu->sys->ram + page * PAGE_SIZE, PAGE_SIZE) != 0) invalidatePage(page);
+    }
+    savedPages.clear();
+    cpu->attention = true;
+}
+};  // namespace mips
@@ -0,0 +1,106 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "cpu/aot/abi.h"
+#include "opcode.h"
+#include "utils/macros.h"
+
+namespace mips {
+struct CPU;
+
+/**
+ * Cached interpreter storage.
+ * Guest code is decoded once into basic blocks keyed by physical PC.
+ * Each entry has its handler resolved (no SPECIAL table lookup at runtime).
+ * Blocks are valid until RAM page that holds them is written,
+ * pages with code are write protected in System memory map.
+ */
+struct Block {
+    typedef void (*Handler)(CPU*, Opcode);
+
+    struct Instruction {
+        Handler handler;
+        Opcode opcode;
+    };
+
+    uint32_t address;  // physical
+    std::vector<Instruction> instructions;
+
+    // Native code (JIT), valid only when block is entered from codeAddress
+    void* code = nullptr;
+    uint32_t codeAddress = 0;
+
+    // Translation loaded from AOT module (see aot::Module), valid only when block is entered from aot->address
+    const aot::BlockEntry* aot = nullptr;
+
+    // Block branches to itself and its iteration has no side effects (polling loop)
+    bool idleLoop = false;
+
+    // Jumps and branches (block ends after their delay slot)
+    static bool isBranch(Opcode i) {
+        if (i.op == 0) return i.fun == 8 || i.fun == 9;  // jr, jalr
+        return i.op >= 1 && i.op <= 7;                   // regimm, j, jal, beq, bne, blez, bgtz
+    }
+
+    // Instructions that always raise an exception
+    static bool isException(Opcode i) {
+        return i.op == 0 && (i.fun == 12 || i.fun == 13);  // syscall, break
+    }
+
+    // Instructions that might use load delay slot
+    static bool isLoad(Opcode i) {
+        return i.op == 16 || i.op == 18 || (i.op >= 32 && i.op <= 38);  // cop0, cop2, lb .. lwr
+    }
+};
+
+class BlockCache {
+   public:
+    static const int PAGE_SIZE = 4 * 1024;
+    static const int MAX_BLOCK_SIZE = 64;
+
+    BlockCache(CPU* cpu);
+
+    // Returns nullptr if address is not cacheable (code is executed by interpreter)
+    Block* getBlock(uint32_t address);
+
+    // Address of block entry, RAM mirrors share blocks
+    static uint32_t physicalAddress(uint32_t address) {
+        address &= 0x1fffffff;
+        if (address < RAM_SIZE * 4) address &= RAM_SIZE - 1;
+        return address;
+    }
+
+    // Must be called on every write to write protected RAM page, offset is physical address in RAM
+    INLINE void invalidate(uint32_t offset) {
+        if (unlikely(ramCodePages[offset / PAGE_SIZE])) invalidatePage(offset / PAGE_SIZE);
+    }
+    void invalidatePage(int page);
+    void flush();
+
+    // RAM is about to be replaced (state load), keeps blocks of pages that end up with the same contents
+    void saveCodePages();
+    void invalidateChangedPages();
+
+   private:
+    static const int RAM_SIZE = 2 * 1024 * 1024;
+    static const int BIOS_SIZE = 512 * 1024;
+    static const int RAM_PAGES = RAM_SIZE / PAGE_SIZE;
+
+    CPU* cpu;
+    std::vector<std::unique_ptr<Block>> ramBlocks;   // Indexed by word offset in RAM
+    std::vector<std::unique_ptr<Block>> biosBlocks;  // Indexed by word offset in BIOS
+    std::array<bool, RAM_PAGES> ramCodePages;
+    std::array<std::vector<uint32_t>, RAM_PAGES> pageBlocks;  // Word offsets of blocks that overlap given page
+
+    // Invalidated blocks are released on next lookup, one of them might be still executing
+    std::vector<std::unique_ptr<Block>> released;
+
+    // Copy of RAM pages with code made by saveCodePages
+    std::vector<int> savedPages;
+    std::vector<uint8_t> savedContents;
+
+    std::unique_ptr<Block> compile(uint32_t address);
+};
+};  // namespace mips
@@ -1,6 +1,8 @@
 #include "cpu.h"
 #include <cassert>
+#include <utility>
 #include "bios/functions.h"
+#include "config.h"
 #include "cpu/instructions.h"
 #include "system.h"
 
@@ -12,37 +14,92 @@ CPU::CPU(System* sys) : sys(sys), _opcode(0) {
     hi = 0;
     lo = 0;
 
-    for (auto& slot : slots) slot.reg = 0;
-}
+    slots = {};
+
+    blockCache = std::make_unique<BlockCache>(this);
 
-void CPU::loadDelaySlot(uint32_t r, uint32_t data) {
-#ifdef ENABLE_LOAD_DELAY_SLOTS
-    assert(r < REGISTER_COUNT);
-    if (r == 0) return;
-    if (r == slots[0].reg) slots[0].reg = 0;  // Override previous write to same register
-
-    slots[1].reg = r;
-    slots[1].data = data;
-    slots[1].prevData = reg[r];
-#else
-    reg[r] = data;
-#endif
+    aotContext = {};
+    aotContext.cpu = this;
+    aotContext.reg = reg.data();
+    aotContext.hi = &hi;
+    aotContext.lo = &lo;
+    aotContext.PC = &PC;
+    aotContext.nextPC = &nextPC;
+    aotContext.exceptionPC = &exceptionPC;
+    aotContext.exceptionIsInBranchDelay = &exceptionIsInBranchDelay;
+    aotContext.exceptionIsBranchTaken = &exceptionIsBranchTaken;
+    aotContext.inBranchDelay = &inBranchDelay;
+    aotContext.branchTaken = &branchTaken;
+    aotContext.opcode = &_opcode;
+    aotContext.attention = &attention;
+    aotContext.moveLoadDelaySlots = [](CPU* cpu) { cpu->moveLoadDelaySlots<Feature::LOAD_DELAY_SLOTS>(); };
+    aotContext.invalidateSlot = [](CPU* cpu, uint32_t r) { cpu->invalidateSlot<Feature::LOAD_DELAY_SLOTS>(r); };
+    updateAotContext();
+
+    reload();
 }
 
-void CPU::moveLoadDelaySlots() {
-#ifdef ENABLE_LOAD_DELAY_SLOTS
-    if (slots[0].reg != 0) {
-        assert(slots[0].reg < REGISTER_COUNT);
+CPU::~CPU() = default;
 
-        // If register contents has been changed during delay slot - ignore it
-        if (reg[slots[0].reg] == slots[0].prevData) {
-            reg[slots[0].reg] = slots[0].data;
+void CPU::reload() {
+    Core newCore;
+    switch (sys->config["options"]["system"]["cpu_core"].get<CpuCore>()) {
+        case CpuCore::CACHED_INTERPRETER: newCore = Core::cachedInterpreter; break;
+        case CpuCore::JIT: newCore = Core::jit; break;
+        default: newCore = Core::interpreter; break;
+    }
+
+    if (newCore == Core::jit) {
+        if (!recompiler) recompiler = std::make_unique<jit::Recompiler>(this);
+        if (!recompiler->isAvailable()) {
+            printf("[CPU]: JIT is not available on this platform, using cached interpreter\n");
+            newCore = Core::cachedInterpreter;
         }
     }
 
-    slots[0] = slots[1];
-    slots[1].reg = 0;  // cancel
-#endif
+    if (newCore != core) {
+        blockCache->flush();
+        if (recompiler) recompiler->reset();
+    }
+    core = newCore;
+
+    std::string aotPath = sys->config["options"]["system"]["aot_module"];
+    if (aotPath != (aotModule ? aotModule->getPath() : "")) {
+        aotModule = aotPath.empty() ? nullptr : aot::Module::load(aotPath);
+        blockCache->flush();  // Attach translations to blocks again
+        if (recompiler) recompiler->reset();
+    }
+
+    skipIdleLoops = sys->config["options"]["system"]["skip_idle_loops"];
+    loadDelaySlots = sys->config["options"]["system"]["load_delay_slots"];
+    sys->scheduler->setCpuMultiplier(sys->config["options"]["system"]["cpu_multiplier"]);
+    gte.widescreenHack = sys->config["options"]["graphics"]["forceWidescreen"];
+}
+
+void CPU::updateFeatures() {
+    uint32_t features = 0;
+    if (loadDelaySlots) features |= Feature::LOAD_DELAY_SLOTS;
+    if (!breakpoints.empty()) features |= Feature::BREAKPOINTS;
+    if (sys->ioLog) features |= Feature::IO_LOG;
+    if (sys->biosLog) features |= Feature::BIOS_TRACE;
+    if (features == enabledFeatures) return;
+
+    // Commit pending loads, loop without delay slots would drop them
+    if ((enabledFeatures & Feature::LOAD_DELAY_SLOTS) && !(features & Feature::LOAD_DELAY_SLOTS)) {
+        moveLoadDelaySlots<Feature::LOAD_DELAY_SLOTS>();
+        moveLoadDelaySlots<Feature::LOAD_DELAY_SLOTS>();
+    }
+
+    // Cached blocks hold handlers of previous loop
+    blockCache->flush();
+    if (recompiler) recompiler->reset();
+    enabledFeatures = features;
+    updateAotContext();
+}
+
+void CPU::updateAotContext() {
+    aotContext.loadDelaySlots = (enabledFeatures & Feature::LOAD_DELAY_SLOTS) != 0;
+    aotContext.handlers = instructions::getHandlerTable(enabledFeatures).data();
 }
 
 void CPU::saveStateForException() {
@@ -76,35 +133,124 @@ bool CPU::handleBreakpoints() {
     return false;
 }
 
-bool CPU::executeInstructions(int count) {
-    for (int i = 0; i < count; i++) {
-        // HACK: BIOS hooks
-        uint32_t maskedPc = PC & 0x1FFFFF;
-        if (maskedPc == 0xa0 || maskedPc == 0xb0 || maskedPc == 0xc0) sys->handleBiosFunction();
+bool CPU::handleAttention() {
+    if (sys->state != System::State::run) return false;
+    attention = false;
+
+    // HACK: BIOS hooks
+    if (isBiosHook(PC)) {
+        sys->handleBiosFunction();
+        if (sys->state != System::State::run) {
+            attention = true;  // Interrupts are checked when system is resumed
+            return false;
+        }
+    }
+    if (isBiosHook(nextPC)) attention = true;  // Jump to hook, its delay slot is executed first
 
+    if ((cop0.cause.interruptPending & cop0.status.interruptMask) && cop0.status.interruptEnable) {
         saveStateForException();
+        instructions::exception(this, COP0::CAUSE::Exception::interrupt);
+    }
+    return true;
+}
+
+namespace {
+template <uint32_t... features>
+constexpr auto makeExecuteTable(std::integer_sequence<uint32_t, features...>) {
+    return std::array<bool (CPU::*)(int), sizeof...(features)>{{&CPU::execute<features>...}};
+}
+
+// Execution loop for every Feature combination, indexed by feature mask
+const auto executeTable = makeExecuteTable(std::make_integer_sequence<uint32_t, Feature::COMBINATIONS>());
+};  // namespace
+
+bool CPU::executeInstructions(int count) {
+    sliceExecuted = 0;
+    sliceLength = count;
+
+    updateFeatures();
+    return (this->*executeTable[enabledFeatures])(count);
+}
+
+template <uint32_t features>
+bool CPU::execute(int count) {
+    // Breakpoints are checked per instruction, which is done only by interpreter
+    if (core != Core::interpreter && (features & Feature::BREAKPOINTS) == 0) {
+        return executeBlocks<features>();
+    }
+    return interpret<features>(count);
+}
+
+template <uint32_t features>
+bool CPU::interpret(int count) {
+    return instructions::getInterpreter(features)(this, count);
+}
+
+template <uint32_t features>
+bool CPU::executeBlocks() {
+    while (sliceExecuted < sliceLength) {
+        if (unlikely(attention) && !handleAttention()) return false;
+
+        Block* block = blockCache->getBlock(PC);
 
-        checkForInterrupts();
+        // Uncached memory or not enough instructions left to execute whole block
+        if (block == nullptr || block->instructions.size() > static_cast<size_t>(sliceLength - sliceExecuted)) {
+            if (!interpret<features>(1)) return false;
+            continue;
+        }
+
+        if (block->idleLoop) sys->volatileRead = false;
+
+        // AOT translation is preferred, it doesn't need to be compiled
+        if (block->aot != nullptr && block->aot->address == PC) {
+            sliceExecuted += block->aot->function(&aotContext);
+            if (block->idleLoop) skipIdleLoop(block->address);
+            continue;
+        }
 
-        if (handleBreakpoints()) return false;
+        if (core == Core::jit && block->code == nullptr && !recompiler->compile(block, PC)) {
+            // Code buffer is full, drop all blocks and start over
+            blockCache->flush();
+            recompiler->reset();
+            continue;
+        }
+
+        // Native code is generated for one virtual address, mirrors are interpreted
+        if (block->code != nullptr && block->codeAddress == PC) {
+            sliceExecuted += reinterpret_cast<jit::BlockFunction>(block->code)(this);
+            if (block->idleLoop) skipIdleLoop(block->address);
+            continue;
+        }
 
-        _opcode = Opcode(sys->readMemory32(PC));
-        const auto& op = instructions::OpcodeTable[_opcode.op];
+        uint32_t address = PC;
+        for (const auto& instruction : block->instructions) {
+            saveStateForException();
 
-        setPC(nextPC);
+            _opcode = instruction.opcode;
+            setPC(nextPC);
 
-        op.instruction(this, _opcode);
+            instruction.handler(this, instruction.opcode);
 
-        moveLoadDelaySlots();
+            moveLoadDelaySlots<features>();
+            sliceExecuted++;
 
-        if (sys->state != System::State::run) return false;
+            // Exception, jump or attention request - leave the block
+            address += 4;
+            if (PC != address || attention) break;
+        }
+        if (block->idleLoop) skipIdleLoop(block->address);
     }
-    return true;
+    return sys->state == System::State::run;
 }
 
-void CPU::checkForInterrupts() {
-    if ((cop0.cause.interruptPending & cop0.status.interruptMask) && cop0.status.interruptEnable) {
-        instructions::exception(this, COP0::CAUSE::Exception::interrupt);
-    }
+void CPU::skipIdleLoop(uint32_t address) {
+    // Loop is taken again and nothing it reads can change until next event (interrupts are raised by events too)
+    if (!skipIdleLoops || attention || sys->volatileRead) return;
+    if (BlockCache::physicalAddress(PC) != BlockCache::physicalAddress(address)) return;
+
+    int skipped = sliceLength - sliceExecuted;
+    if (skipped <= 0) return;
+    sliceExecuted = sliceLength;
+    idleCyclesSkipped += sys->scheduler->cyclesFor(skipped);
 }
 }  // namespace mips
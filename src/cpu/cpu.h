@@ -1,9 +1,14 @@
 #pragma once
 #include <array>
+#include <cassert>
 #include <cstdint>
+#include <memory>
 #include <unordered_map>
+#include "cpu/aot/aot.h"
+#include "cpu/block_cache.h"
 #include "cpu/cop0.h"
 #include "cpu/gte/gte.h"
+#include "cpu/jit/jit.h"
 #include "opcode.h"
 #include "utils/macros.h"
 
@@ -41,6 +46,21 @@ r30     fp    - frame pointer
 r31     ra    - return address
 */
 
+/**
+ * CPU features that cost time on every instruction.
+ * Instruction handlers and execution loops are instantiated for every combination,
+ * CPU switches to the cheapest one required by config and debugger (see CPU::updateFeatures).
+ */
+namespace Feature {
+enum : uint32_t {
+    LOAD_DELAY_SLOTS = 1 << 0,  // Accurate load delay slots
+    BREAKPOINTS = 1 << 1,       // Debugger breakpoints and breakpoint opcode (0x3f)
+    IO_LOG = 1 << 2,            // IO accesses done by CPU are stored in System::ioLogList
+    BIOS_TRACE = 1 << 3,        // Syscalls are logged
+};
+const int COMBINATIONS = 1 << 4;
+};  // namespace Feature
+
 struct LoadSlot {
     uint32_t reg : 5;
     uint32_t data;
@@ -50,6 +70,12 @@ struct LoadSlot {
 struct CPU {
     static const int REGISTER_COUNT = 32;
 
+    enum class Core {
+        interpreter,        // Fetch and decode every instruction
+        cachedInterpreter,  // Execute pre-decoded basic blocks
+        jit,                // Execute blocks recompiled to native code (x86-64 only)
+    };
+
     // Saved state for exception handling
     uint32_t exceptionPC;
     bool exceptionIsInBranchDelay;
@@ -68,27 +94,85 @@ struct CPU {
     System* sys;
     Opcode _opcode;
 
+    Core core = Core::interpreter;
+    std::unique_ptr<BlockCache> blockCache;
+    std::unique_ptr<jit::Recompiler> recompiler;
+    // Code translated ahead of time, used by cachedInterpreter and jit cores
+    std::unique_ptr<aot::Module> aotModule;
+    aot::Context aotContext;
+
+    // Polling loops (see Block::idleLoop) end CPU slice early, time jumps to the next event
+    bool skipIdleLoops = true;
+    uint64_t idleCyclesSkipped = 0;
+
+    bool loadDelaySlots = true;
+    // Feature mask of currently used execution loop, handlers in BlockCache are resolved for it
+    uint32_t enabledFeatures = Feature::LOAD_DELAY_SLOTS;
+
+    // Fetch-execute loop leaves the fast path (and current block) only when this is set:
+    // interrupt request, jump to BIOS hook, breakpoints, system state change or code modification
+    bool attention = false;
+
     CPU(System* sys);
-    void checkForInterrupts();
-    void loadDelaySlot(uint32_t r, uint32_t data);
-    void moveLoadDelaySlots();
+    ~CPU();
+    // Apply options from System config (also to GTE)
+    void reload();
+    // Must be called after interrupt line or COP0 status change, interrupt is taken on next instruction
+    INLINE void updateInterrupts() {
+        if ((cop0.cause.interruptPending & cop0.status.interruptMask) && cop0.status.interruptEnable) attention = true;
+    }
+    static INLINE bool isBiosHook(uint32_t address) {
+        uint32_t masked = address & 0x1FFFFF;
+        return masked == 0xa0 || masked == 0xb0 || masked == 0xc0;
+    }
+    template <uint32_t features>
+    INLINE void loadDelaySlot(uint32_t r, uint32_t data) {
+        assert(r < REGISTER_COUNT);
+        if (r == 0) return;
+        if constexpr ((features & Feature::LOAD_DELAY_SLOTS) != 0) {
+            if (r == slots[0].reg) slots[0].reg = 0;  // Override previous write to same register
+
+            slots[1].reg = r;
+            slots[1].data = data;
+            slots[1].prevData = reg[r];
+        } else {
+            reg[r] = data;
+        }
+    }
+    template <uint32_t features>
+    INLINE void moveLoadDelaySlots() {
+        if constexpr ((features & Feature::LOAD_DELAY_SLOTS) != 0) {
+            if (slots[0].reg != 0) {
+                // If register contents has been changed during delay slot - ignore it
+                if (reg[slots[0].reg] == slots[0].prevData) {
+                    reg[slots[0].reg] = slots[0].data;
+                }
+            }
+
+            slots[0] = slots[1];
+            slots[1].reg = 0;  // cancel
+        }
+    }
+    template <uint32_t features>
     INLINE void invalidateSlot(uint32_t r) {
-#ifdef ENABLE_LOAD_DELAY_SLOTS
-        // TODO: Remove branching in delay slots to improve performance
-        if (slots[0].reg == r) {
-            slots[0].reg = 0;
+        if constexpr ((features & Feature::LOAD_DELAY_SLOTS) != 0) {
+            // TODO: Remove branching in delay slots to improve performance
+            if (slots[0].reg == r) {
+                slots[0].reg = 0;
+            }
         }
-#endif
     }
 
+    template <uint32_t features>
     INLINE void loadAndInvalidate(int r, uint32_t data) {
         if (r == 0) return;
         reg[r] = data;
-        invalidateSlot(r);
+        invalidateSlot<features>(r);
     }
     INLINE void jump(uint32_t address) {
         nextPC = address;
         branchTaken = true;
+        if (unlikely(isBiosHook(address))) attention = true;
     }
     INLINE void setPC(uint32_t address) {
         PC = address;
@@ -97,7 +181,31 @@ struct CPU {
 
     void saveStateForException();
     bool handleBreakpoints();
+    bool handleAttention();
+    // Switch to execution loop required by current config and debugger state
+    void updateFeatures();
+    // Handlers and features used by AOT translated code
+    void updateAotContext();
+    // Instructions executed in current slice, Scheduler shortens the slice if event is scheduled before its end
+    int sliceExecuted = 0;
+    int sliceLength = 0;
+
     bool executeInstructions(int count);
+    template <uint32_t features>
+    bool execute(int count);
+    template <uint32_t features>
+    bool interpret(int count);
+    template <uint32_t features>
+    bool executeBlocks();
+    void skipIdleLoop(uint32_t address);
+
+    // Cached blocks of changed RAM pages are invalidated after loading (see System::loadState)
+    template <class Archive>
+    void serialize(Archive& ar) {
+        ar(exceptionPC, exceptionIsInBranchDelay, exceptionIsBranchTaken);
+        ar(PC, nextPC, inBranchDelay, branchTaken, slots);
+        ar(reg, cop0, gte, hi, lo, _opcode);
+    }
 
     struct Breakpoint {
         bool enabled = true;
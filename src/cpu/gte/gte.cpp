@@ -1,14 +1,7 @@
 #include "gte.h"
-#include "config.h"
+#include <algorithm>
 
-GTE::GTE() : unrTable(generateUnrTable()) {
-    busToken = bus.listen<Event::Config::Gte>([&](auto) { reload(); });
-    reload();
-}
-
-GTE::~GTE() { bus.unlistenAll(busToken); }
-
-void GTE::reload() { widescreenHack = config["options"]["graphics"]["forceWidescreen"]; }
+GTE::GTE() : unrTable(generateUnrTable()) {}
 
 uint32_t GTE::read(uint8_t n) {
     uint32_t ret = [this](uint8_t n) -> uint32_t {
@@ -46,9 +39,9 @@ uint32_t GTE::read(uint8_t n) {
             case 27: return mac[3];
             case 28:
             case 29:
-                irgb = clip(ir[1] / 0x80, 0x1f, 0x00);
-                irgb |= clip(ir[2] / 0x80, 0x1f, 0x00) << 5;
-                irgb |= clip(ir[3] / 0x80, 0x1f, 0x00) << 10;
+                irgb = std::clamp(ir[1] / 0x80, 0x00, 0x1f);
+                irgb |= std::clamp(ir[2] / 0x80, 0x00, 0x1f) << 5;
+                irgb |= std::clamp(ir[3] / 0x80, 0x00, 0x1f) << 10;
                 return irgb;
             case 30: return lzcs;
             case 31: return lzcr;
@@ -87,7 +80,10 @@ uint32_t GTE::read(uint8_t n) {
             case 60: return dqb;
             case 61: return (int32_t)(int16_t)zsf3;  // gte_bug?: sign extended
             case 62: return (int32_t)(int16_t)zsf4;  // gte_bug?: sign extended
-            case 63: flag.calculate(); return flag.reg;
+            case 63:
+                calculateFlag();
+                flag.calculate();
+                return flag.reg;
             default: return 0;
         }
     }(n);
@@ -240,39 +236,33 @@ void GTE::write(uint8_t n, uint32_t d) {
         case 60: dqb = d; break;
         case 61: zsf3 = d; break;
         case 62: zsf4 = d; break;
-        case 63: flag.reg = d & 0x7FFFF000; break;
+        case 63:
+            flagPending = false;
+            flag.reg = d & 0x7FFFF000;
+            break;
         default: return;
     }
 }
 
 bool GTE::command(gte::Command& cmd) {
     flag.reg = 0;
-    this->sf = cmd.sf;
-    this->lm = cmd.lm;
 
-    switch (cmd.cmd) {
-        case 0x01: rtps(); return true;
-        case 0x06: nclip(); return true;
-        case 0x0c: op(); return true;
-        case 0x10: dpcs(); return true;
-        case 0x11: intpl(); return true;
-        case 0x12: mvmva(cmd.mvmvaMultiplyMatrix, cmd.mvmvaMultiplyVector, cmd.mvmvaTranslationVector); return true;
-        case 0x13: ncds(); return true;
-        case 0x14: cdp(); return true;
-        case 0x16: ncdt(); return true;
-        case 0x1b: nccs(); return true;
-        case 0x1c: cc(); return true;
-        case 0x1e: ncs(); return true;
-        case 0x20: nct(); return true;
-        case 0x2a: dpct(); return true;
-        case 0x28: sqr(); return true;
-        case 0x29: dcpl(); return true;
-        case 0x2d: avsz3(); return true;
-        case 0x2e: avsz4(); return true;
-        case 0x30: rtpt(); return true;
-        case 0x3d: gpf(); return true;
-        case 0x3e: gpl(); return true;
-        case 0x3f: ncct(); return true;
-        default: return false;
-    }
-}
\ No newline at end of file
+    // Saving registers costs about as much as calculating FLAG of single vertex commands
+    flagPending = lazyFlag(cmd.cmd);
+    if (!flagPending) return execute<true>(cmd);
+
+    flagInput = *this;
+    flagCommand = cmd;
+    return execute<false>(cmd);
+}
+
+void GTE::calculateFlag() {
+    if (!flagPending) return;
+    flagPending = false;
+
+    // Replay last command on its inputs, registers modified since then are restored afterwards
+    gte::Registers current = *this;
+    static_cast<gte::Registers&>(*this) = flagInput;
+    execute<true>(flagCommand);
+    static_cast<gte::Registers&>(*this) = current;
+}
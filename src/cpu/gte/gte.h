@@ -1,13 +1,46 @@
 #pragma once
 #include <cstddef>
 #include <cstdint>
+#include <utility>
 #include <vector>
 #include "command.h"
 #include "device/device.h"
 #include "math.h"
 #include "utils/logic.h"
 
-struct GTE {
+namespace gte {
+struct Product;
+
+// All data and control registers except FLAG
+struct Registers {
+    Vector<int16_t> v[3] = {};
+    Reg32 rgbc;
+    uint16_t otz = 0;
+    int16_t ir[4] = {0};
+    Vector<int16_t, int16_t, uint16_t> s[4] = {};
+    Reg32 rgb[3];
+    uint32_t res1 = 0;     // prohibited
+    int32_t mac[4] = {0};  // Sum of products
+    uint16_t irgb = 0;
+    int32_t lzcs = 0;
+    int32_t lzcr = 0;
+
+    Matrix rotation = {};
+    Vector<int32_t> translation = {};
+    Matrix light = {};
+    Vector<int32_t> backgroundColor = {};
+    Matrix color = {};
+    Vector<int32_t> farColor = {};
+    int32_t of[2] = {0};
+    uint16_t h = 0;
+    int16_t dqa = 0;
+    int32_t dqb = 0;
+    int16_t zsf3 = 0;
+    int16_t zsf4 = 0;
+};
+};  // namespace gte
+
+struct GTE : gte::Registers {
     union Flag {
         enum {
             IR0_SATURATED = 1 << 12,
@@ -58,34 +91,11 @@ struct GTE {
 
         void calculate() { flag = or_range<30, 23>(reg) | or_range<18, 13>(reg); }
     };
-    gte::Vector<int16_t> v[3];
-    Reg32 rgbc;
-    uint16_t otz = 0;
-    int16_t ir[4] = {0};
-    gte::Vector<int16_t, int16_t, uint16_t> s[4];
-    Reg32 rgb[3];
-    uint32_t res1 = 0;     // prohibited
-    int32_t mac[4] = {0};  // Sum of products
-    uint16_t irgb = 0;
-    int32_t lzcs = 0;
-    int32_t lzcr = 0;
-
-    gte::Matrix rotation;
-    gte::Vector<int32_t> translation;
-    gte::Matrix light;
-    gte::Vector<int32_t> backgroundColor;
-    gte::Matrix color;
-    gte::Vector<int32_t> farColor;
-    int32_t of[2] = {0};
-    uint16_t h = 0;
-    int16_t dqa = 0;
-    int32_t dqb = 0;
-    int16_t zsf3 = 0;
-    int16_t zsf4 = 0;
     Flag flag;
 
+    bool widescreenHack = false;  // Set by CPU::reload
+
     GTE();
-    ~GTE();
 
     uint32_t read(uint8_t n);
     void write(uint8_t n, uint32_t d);
@@ -101,8 +111,13 @@ struct GTE {
 
     std::vector<GTE_ENTRY> log;
 
+    template <class Archive>
+    void serialize(Archive& ar) {
+        calculateFlag();  // Pending FLAG is resolved, only registers are stored
+        ar(static_cast<gte::Registers&>(*this), flag);
+    }
+
    private:
-    int busToken;
     constexpr std::array<uint8_t, 0x101> generateUnrTable() {
         std::array<uint8_t, 0x101> table = {{0}};
         for (int i = 0; i < (int)table.size(); i++) {
@@ -112,67 +127,123 @@ struct GTE {
     }
     const std::array<uint8_t, 0x101> unrTable;
 
-    bool widescreenHack;
-    // Temporary, used in commands
-    bool sf;
-    bool lm;
-
-    void reload();
-
+    // FLAG of commands processing three vertices is not calculated,
+    // instead the command is replayed from saved registers when FLAG is read
+    static constexpr bool lazyFlag(uint32_t cmd) { return cmd == 0x16 || cmd == 0x20 || cmd == 0x2a || cmd == 0x30 || cmd == 0x3f; }
+    bool flagPending = false;
+    gte::Command flagCommand = 0;
+    gte::Registers flagInput;
+
+    void calculateFlag();
+
+    // Commands are instantiated for every sf and lm bit combination (and every MVMVA operand selection)
+    // Handler index: sf << 7 | lm << 6 | command
+    // MVMVA handler index: sf << 7 | mx << 5 | vx << 3 | tx << 1 | lm
+    typedef bool (GTE::*Handler)();
+    typedef void (GTE::*MvmvaHandler)();
+
+    template <bool flags>
+    bool execute(gte::Command cmd);
+    template <bool flags, uint32_t index>
+    bool runCommand();
+    template <bool flags, uint32_t... index>
+    static constexpr std::array<Handler, sizeof...(index)> makeHandlers(std::integer_sequence<uint32_t, index...>);
+    template <uint32_t... index>
+    static constexpr std::array<MvmvaHandler, sizeof...(index)> makeMvmvaHandlers(std::integer_sequence<uint32_t, index...>);
+
+    template <bool flags, bool sf, bool lm>
     void multiplyVectors(gte::Vector<int16_t> v1, gte::Vector<int16_t> v2, gte::Vector<int16_t> tr = gte::Vector<int16_t>(0));
-    void multiplyMatrixByVector(gte::Matrix m, gte::Vector<int16_t> v, gte::Vector<int32_t> tr = gte::Vector<int32_t>(0));
-    int64_t multiplyMatrixByVectorRTP(gte::Matrix m, gte::Vector<int16_t> v, gte::Vector<int32_t> tr);
+    template <bool flags, bool sf, bool lm>
+    void multiplyMatrixByVector(const gte::Matrix& m, const gte::Vector<int16_t>& v,
+                                const gte::Vector<int32_t>& tr = gte::Vector<int32_t>(0));
 
     int countLeadingZeroes(uint32_t n);
     size_t countLeadingZeroes16(uint16_t n);
-    int32_t clip(int32_t value, int32_t max, int32_t min, uint32_t flags = 0);
 
-    template <int bit_size>
+    template <bool flags>
+    int32_t clip(int32_t value, int32_t max, int32_t min, uint32_t bits = 0);
+
+    template <bool flags, int bit_size>
     void checkOverflow(int64_t value, uint32_t overflowBits, uint32_t underflowFlags);
 
-    template <int i>
+    template <bool flags, int i>
     int64_t checkMacOverflowAndExtend(int64_t value);
 
-    template <int i>
+    template <bool flags, int i, bool sf = false>
     int64_t setMac(int64_t value);
 
-    template <int i>
-    void setIr(int32_t value, bool lm = false);
+    template <bool flags, int i, bool lm = false>
+    void setIr(int32_t value);
+
+    template <bool flags, int i, bool sf, bool lm = false>
+    void setMacAndIr(int64_t value);
 
-    template <int i>
-    void setMacAndIr(int64_t value, bool lm = false);
+    template <bool flags>
+    void setMacAndIr(const gte::Product& p);
+    template <bool flags>
+    int64_t setMacAndIrRTP(gte::Product p);
 
+    template <bool flags>
     void setOtz(int64_t value);
+    template <bool flags>
     void pushScreenXY(int32_t x, int32_t y);
+    template <bool flags>
     void pushScreenZ(int32_t z);
+    template <bool flags>
     void pushColor();
+    template <bool flags>
     void pushColor(uint32_t r, uint32_t g, uint32_t b);
 
     uint32_t recip(uint16_t divisor);
+    template <bool flags>
     uint32_t divideUNR(uint32_t a, uint32_t b);
     uint32_t divide(uint16_t h, uint16_t sz3);
 
-    // Opcodes
+    // Opcodes, flags - calculate FLAG register, sf and lm - command bits
+    template <bool flags>
     void nclip();
+    template <bool flags, bool sf, bool lm>
     void ncds(int n = 0);
+    template <bool flags, bool sf, bool lm>
     void ncs(int n = 0);
+    template <bool flags, bool sf, bool lm>
     void nct();
+    template <bool flags, bool sf, bool lm>
     void nccs(int n = 0);
+    template <bool flags, bool sf, bool lm>
     void cc();
+    template <bool flags, bool sf, bool lm>
     void cdp();
+    template <bool flags, bool sf, bool lm>
     void ncdt();
+    template <bool flags, bool sf, bool lm>
     void ncct();
+    template <bool flags, bool sf, bool lm>
     void dpct();
+    template <bool flags, bool sf, bool lm>
     void dpcs(bool useRGB0 = false);
+    template <bool flags, bool sf, bool lm>
     void dcpl();
+    template <bool flags, bool sf, bool lm>
     void intpl();
+    template <bool flags, bool sf, bool lm>
     void rtps(int n = 0, bool setMAC0 = true);
+    template <bool flags>
+    void perspectiveTransform(int64_t mac3, bool setMAC0);
+    template <bool flags, bool sf, bool lm>
     void rtpt();
+    template <bool flags>
     void avsz3();
+    template <bool flags>
     void avsz4();
-    void mvmva(int mx, int vx, int tx);
+    template <bool flags, bool sf, bool lm, int mx, int vx, int tx>
+    void mvmva();
+    template <bool flags, bool sf, bool lm>
     void gpf();
+    template <bool flags, bool sf, bool lm>
     void gpl();
+    template <bool flags, bool sf, bool lm>
     void sqr();
+    template <bool flags, bool sf, bool lm>
     void op();
 };
@@ -1,61 +1,63 @@
 #include "gte.h"
+#include "simd.h"
 
 using gte::Matrix;
 using gte::toVector;
 using gte::Vector;
 
-int32_t GTE::clip(int32_t value, int32_t max, int32_t min, uint32_t flags) {
+template <bool flags>
+int32_t GTE::clip(int32_t value, int32_t max, int32_t min, uint32_t bits) {
     if (value > max) {
-        flag.reg |= flags;
+        if (flags) flag.reg |= bits;
         return max;
     }
     if (value < min) {
-        flag.reg |= flags;
+        if (flags) flag.reg |= bits;
         return min;
     }
     return value;
 }
 
-template <int bit_size>
+template <bool flags, int bit_size>
 void GTE::checkOverflow(int64_t value, uint32_t overflowBits, uint32_t underflowFlags) {
+    if (!flags) return;
     if (value >= (1LL << bit_size)) flag.reg |= overflowBits;
     if (value < -(1LL << bit_size)) flag.reg |= underflowFlags;
 }
 
-template <int i>
+template <bool flags, int i>
 int64_t GTE::checkMacOverflowAndExtend(int64_t value) {
     static_assert(i >= 1 && i <= 3, "Invalid mac for GTE::checkMacOverflowAndExtend");
 
     if (i == 1) {
-        checkOverflow<43>(value, Flag::MAC1_OVERFLOW_POSITIVE, Flag::MAC1_OVERFLOW_NEGATIVE);
+        checkOverflow<flags, 43>(value, Flag::MAC1_OVERFLOW_POSITIVE, Flag::MAC1_OVERFLOW_NEGATIVE);
     } else if (i == 2) {
-        checkOverflow<43>(value, Flag::MAC2_OVERFLOW_POSITIVE, Flag::MAC2_OVERFLOW_NEGATIVE);
+        checkOverflow<flags, 43>(value, Flag::MAC2_OVERFLOW_POSITIVE, Flag::MAC2_OVERFLOW_NEGATIVE);
     } else if (i == 3) {
-        checkOverflow<43>(value, Flag::MAC3_OVERFLOW_POSITIVE, Flag::MAC3_OVERFLOW_NEGATIVE);
+        checkOverflow<flags, 43>(value, Flag::MAC3_OVERFLOW_POSITIVE, Flag::MAC3_OVERFLOW_NEGATIVE);
     }
 
     return extend_sign<43, int64_t>(value);
 }
 
-#define O(i, value) checkMacOverflowAndExtend<i>(value)
+#define O(i, value) checkMacOverflowAndExtend<flags, i>(value)
 
-template <>
-int64_t GTE::setMac<0>(int64_t value) {
-    checkOverflow<31>(value, Flag::MAC0_OVERFLOW_POSITIVE, Flag::MAC0_OVERFLOW_NEGATIVE);
-    mac[0] = value;
-    return value;
-}
-
-template <int i>
+template <bool flags, int i, bool sf>
 int64_t GTE::setMac(int64_t value) {
-    static_assert(i >= 1 && i <= 3, "Invalid mac for GTE::setMac");
+    static_assert(i >= 0 && i <= 3, "Invalid mac for GTE::setMac");
+
+    if (i == 0) {
+        checkOverflow<flags, 31>(value, Flag::MAC0_OVERFLOW_POSITIVE, Flag::MAC0_OVERFLOW_NEGATIVE);
+        mac[0] = value;
+        return value;
+    }
 
     if (i == 1) {
-        checkOverflow<43>(value, Flag::MAC1_OVERFLOW_POSITIVE, Flag::MAC1_OVERFLOW_NEGATIVE);
+        checkOverflow<flags, 43>(value, Flag::MAC1_OVERFLOW_POSITIVE, Flag::MAC1_OVERFLOW_NEGATIVE);
     } else if (i == 2) {
-        checkOverflow<43>(value, Flag::MAC2_OVERFLOW_POSITIVE, Flag::MAC2_OVERFLOW_NEGATIVE);
+        checkOverflow<flags, 43>(value, Flag::MAC2_OVERFLOW_POSITIVE, Flag::MAC2_OVERFLOW_NEGATIVE);
     } else if (i == 3) {
-        checkOverflow<43>(value, Flag::MAC3_OVERFLOW_POSITIVE, Flag::MAC3_OVERFLOW_NEGATIVE);
+        checkOverflow<flags, 43>(value, Flag::MAC3_OVERFLOW_POSITIVE, Flag::MAC3_OVERFLOW_NEGATIVE);
     }
 
     if (sf) value >>= 12;
@@ -64,8 +66,8 @@ int64_t GTE::setMac(int64_t value) {
     return value;
 }
 
-template <int i>
-void GTE::setIr(int32_t value, bool lm) {
+template <bool flags, int i, bool lm>
+void GTE::setIr(int32_t value) {
     static_assert(i >= 1 && i <= 3, "Invalid ir for GTE::setIr");
 
     uint32_t saturatedBits = 0;
@@ -77,172 +79,177 @@ void GTE::setIr(int32_t value, bool lm) {
         saturatedBits = Flag::IR3_SATURATED;
     }
 
-    ir[i] = clip(value, 0x7fff, lm ? 0 : -0x8000, saturatedBits);
+    ir[i] = clip<flags>(value, 0x7fff, lm ? 0 : -0x8000, saturatedBits);
 }
 
-template <int i>
-void GTE::setMacAndIr(int64_t value, bool lm) {
-    setIr<i>(setMac<i>(value), lm);
+template <bool flags, int i, bool sf, bool lm>
+void GTE::setMacAndIr(int64_t value) {
+    setIr<flags, i, lm>(setMac<flags, i, sf>(value));
 }
 
-void GTE::setOtz(int64_t value) { otz = clip(value >> 12, 0xffff, 0x0000, Flag::SZ3_OTZ_SATURATED); }
+template <bool flags>
+void GTE::setOtz(int64_t value) { otz = clip<flags>(value >> 12, 0xffff, 0x0000, Flag::SZ3_OTZ_SATURATED); }
 
 #define R (rgbc.read(0) << 4)
 #define G (rgbc.read(1) << 4)
 #define B (rgbc.read(2) << 4)
 
+template <bool flags>
 void GTE::nclip() {
-    setMac<0>((int64_t)s[0].x * s[1].y + s[1].x * s[2].y + s[2].x * s[0].y - s[0].x * s[2].y - s[1].x * s[0].y - s[2].x * s[1].y);
+    setMac<flags, 0>((int64_t)s[0].x * s[1].y + s[1].x * s[2].y + s[2].x * s[0].y - s[0].x * s[2].y - s[1].x * s[0].y - s[2].x * s[1].y);
 }
 
+template <bool flags, bool sf, bool lm>
 void GTE::multiplyVectors(Vector<int16_t> v1, Vector<int16_t> v2, Vector<int16_t> tr) {
-    setMacAndIr<1>(((int64_t)tr.x << 12) + v1.x * v2.x, lm);
-    setMacAndIr<2>(((int64_t)tr.y << 12) + v1.y * v2.y, lm);
-    setMacAndIr<3>(((int64_t)tr.z << 12) + v1.z * v2.z, lm);
+    setMacAndIr<flags, 1, sf, lm>(((int64_t)tr.x << 12) + v1.x * v2.x);
+    setMacAndIr<flags, 2, sf, lm>(((int64_t)tr.y << 12) + v1.y * v2.y);
+    setMacAndIr<flags, 3, sf, lm>(((int64_t)tr.z << 12) + v1.z * v2.z);
 }
 
-void GTE::multiplyMatrixByVector(Matrix m, Vector<int16_t> v, Vector<int32_t> tr) {
-    Vector<int64_t> result;
-
-    result.x = O(1, O(1, O(1, ((int64_t)tr.x << 12) + m[0][0] * v.x) + m[0][1] * v.y) + m[0][2] * v.z);
-    result.y = O(2, O(2, O(2, ((int64_t)tr.y << 12) + m[1][0] * v.x) + m[1][1] * v.y) + m[1][2] * v.z);
-    result.z = O(3, O(3, O(3, ((int64_t)tr.z << 12) + m[2][0] * v.x) + m[2][1] * v.y) + m[2][2] * v.z);
-
-    setMacAndIr<1>(result.x, lm);
-    setMacAndIr<2>(result.y, lm);
-    setMacAndIr<3>(result.z, lm);
+template <bool flags, bool sf, bool lm>
+INLINE void GTE::multiplyMatrixByVector(const Matrix& m, const Vector<int16_t>& v, const Vector<int32_t>& tr) {
+    setMacAndIr<flags>(gte::multiplyMatrixByVector<flags>(m, v, tr, sf, lm));
 }
 
-int64_t GTE::multiplyMatrixByVectorRTP(Matrix m, Vector<int16_t> v, Vector<int32_t> tr) {
-    Vector<int64_t> result;
-
-    result.x = O(1, O(1, O(1, ((int64_t)tr.x << 12) + m[0][0] * v.x) + m[0][1] * v.y) + m[0][2] * v.z);
-    result.y = O(2, O(2, O(2, ((int64_t)tr.y << 12) + m[1][0] * v.x) + m[1][1] * v.y) + m[1][2] * v.z);
-    result.z = O(3, O(3, O(3, ((int64_t)tr.z << 12) + m[2][0] * v.x) + m[2][1] * v.y) + m[2][2] * v.z);
-
-    setMacAndIr<1>(result.x, lm);
-    setMacAndIr<2>(result.y, lm);
-    setMac<3>(result.z);
+template <bool flags>
+INLINE void GTE::setMacAndIr(const gte::Product& p) {
+    for (int i = 0; i < 3; i++) {
+        mac[i + 1] = p.mac[i];
+        ir[i + 1] = p.ir[i];
+    }
+    if (flags) flag.reg |= p.flags;
+}
 
+template <bool flags>
+int64_t GTE::setMacAndIrRTP(gte::Product p) {
     // RTP calculates IR3 saturation flag as if lm bit was always false
-    clip(result.z >> 12, 0x7fff, -0x8000, Flag::IR3_SATURATED);
+    p.flags &= ~Flag::IR3_SATURATED;
+    clip<flags>(p.value[2] >> 12, 0x7fff, -0x8000, Flag::IR3_SATURATED);
 
     // But calculation itself respects lm bit
-    ir[3] = clip(mac[3], 0x7fff, lm ? 0 : -0x8000);
+    setMacAndIr<flags>(p);
 
-    return result.z;
+    return p.value[2];
 }
 
+template <bool flags, bool sf, bool lm>
 void GTE::ncds(int n) {
-    multiplyMatrixByVector(light, v[n]);
-    multiplyMatrixByVector(color, toVector(ir), backgroundColor);
-
-    auto prevIr = toVector(ir);
-
-    setMacAndIr<1>(((int64_t)farColor.r << 12) - (R * ir[1]));
-    setMacAndIr<2>(((int64_t)farColor.g << 12) - (G * ir[2]));
-    setMacAndIr<3>(((int64_t)farColor.b << 12) - (B * ir[3]));
-
-    setMacAndIr<1>((R * prevIr.x) + ir[0] * ir[1], lm);
-    setMacAndIr<2>((G * prevIr.y) + ir[0] * ir[2], lm);
-    setMacAndIr<3>((B * prevIr.z) + ir[0] * ir[3], lm);
-    pushColor();
+    multiplyMatrixByVector<flags, sf, lm>(light, v[n]);
+    cdp<flags, sf, lm>();
 }
 
+template <bool flags, bool sf, bool lm>
 void GTE::ncs(int n) {
-    multiplyMatrixByVector(light, v[n]);
-    multiplyMatrixByVector(color, toVector(ir), backgroundColor);
-    pushColor();
+    multiplyMatrixByVector<flags, sf, lm>(light, v[n]);
+    multiplyMatrixByVector<flags, sf, lm>(color, toVector(ir), backgroundColor);
+    pushColor<flags>();
 }
 
+template <bool flags, bool sf, bool lm>
 void GTE::nct() {
-    ncs(0);
-    ncs(1);
-    ncs(2);
+    ncs<flags, sf, lm>(0);
+    ncs<flags, sf, lm>(1);
+    ncs<flags, sf, lm>(2);
 }
 
+template <bool flags, bool sf, bool lm>
 void GTE::nccs(int n) {
-    multiplyMatrixByVector(light, v[n]);
-    multiplyMatrixByVector(color, toVector(ir), backgroundColor);
-    multiplyVectors(Vector<int16_t>(R, G, B), toVector(ir));
-    pushColor();
+    multiplyMatrixByVector<flags, sf, lm>(light, v[n]);
+    cc<flags, sf, lm>();
 }
 
+template <bool flags, bool sf, bool lm>
 void GTE::cc() {
-    multiplyMatrixByVector(color, toVector(ir), backgroundColor);
-    multiplyVectors(Vector<int16_t>(R, G, B), toVector(ir));
-    pushColor();
+    multiplyMatrixByVector<flags, sf, lm>(color, toVector(ir), backgroundColor);
+    multiplyVectors<flags, sf, lm>(Vector<int16_t>(R, G, B), toVector(ir));
+    pushColor<flags>();
 }
 
+template <bool flags, bool sf, bool lm>
 void GTE::cdp() {
-    multiplyMatrixByVector(color, toVector(ir), backgroundColor);
+    multiplyMatrixByVector<flags, sf, lm>(color, toVector(ir), backgroundColor);
 
     auto prevIr = toVector(ir);
 
-    setMacAndIr<1>(((int64_t)farColor.r << 12) - (R * ir[1]));
-    setMacAndIr<2>(((int64_t)farColor.g << 12) - (G * ir[2]));
-    setMacAndIr<3>(((int64_t)farColor.b << 12) - (B * ir[3]));
+    setMacAndIr<flags, 1, sf>(((int64_t)farColor.r << 12) - (R * ir[1]));
+    setMacAndIr<flags, 2, sf>(((int64_t)farColor.g << 12) - (G * ir[2]));
+    setMacAndIr<flags, 3, sf>(((int64_t)farColor.b << 12) - (B * ir[3]));
 
-    setMacAndIr<1>((R * prevIr.x) + ir[0] * ir[1], lm);
-    setMacAndIr<2>((G * prevIr.y) + ir[0] * ir[2], lm);
-    setMacAndIr<3>((B * prevIr.z) + ir[0] * ir[3], lm);
-    pushColor();
+    setMacAndIr<flags, 1, sf, lm>((R * prevIr.x) + ir[0] * ir[1]);
+    setMacAndIr<flags, 2, sf, lm>((G * prevIr.y) + ir[0] * ir[2]);
+    setMacAndIr<flags, 3, sf, lm>((B * prevIr.z) + ir[0] * ir[3]);
+    pushColor<flags>();
 }
 
+// Light stage of all three vertices is independent, so it is done before color stages
+template <bool flags, bool sf, bool lm>
 void GTE::ncdt() {
-    ncds(0);
-    ncds(1);
-    ncds(2);
+    gte::Product lighting[3];
+    for (int n = 0; n < 3; n++) lighting[n] = gte::multiplyMatrixByVector<flags>(light, v[n], Vector<int32_t>(0), sf, lm);
+
+    for (int n = 0; n < 3; n++) {
+        setMacAndIr<flags>(lighting[n]);
+        cdp<flags, sf, lm>();
+    }
 }
 
+template <bool flags, bool sf, bool lm>
 void GTE::ncct() {
-    nccs(0);
-    nccs(1);
-    nccs(2);
+    gte::Product lighting[3];
+    for (int n = 0; n < 3; n++) lighting[n] = gte::multiplyMatrixByVector<flags>(light, v[n], Vector<int32_t>(0), sf, lm);
+
+    for (int n = 0; n < 3; n++) {
+        setMacAndIr<flags>(lighting[n]);
+        cc<flags, sf, lm>();
+    }
 }
 
+template <bool flags, bool sf, bool lm>
 void GTE::dpct() {
-    dpcs(true);
-    dpcs(true);
-    dpcs(true);
+    dpcs<flags, sf, lm>(true);
+    dpcs<flags, sf, lm>(true);
+    dpcs<flags, sf, lm>(true);
 }
 
+template <bool flags, bool sf, bool lm>
 void GTE::dpcs(bool useRGB0) {
     // TODO: Change to Color struct
     int16_t r = useRGB0 ? rgb[0].read(0) << 4 : R;
     int16_t g = useRGB0 ? rgb[0].read(1) << 4 : G;
     int16_t b = useRGB0 ? rgb[0].read(2) << 4 : B;
 
-    setMacAndIr<1>(((int64_t)farColor.r << 12) - (r << 12));
-    setMacAndIr<2>(((int64_t)farColor.g << 12) - (g << 12));
-    setMacAndIr<3>(((int64_t)farColor.b << 12) - (b << 12));
+    setMacAndIr<flags, 1, sf>(((int64_t)farColor.r << 12) - (r << 12));
+    setMacAndIr<flags, 2, sf>(((int64_t)farColor.g << 12) - (g << 12));
+    setMacAndIr<flags, 3, sf>(((int64_t)farColor.b << 12) - (b << 12));
 
-    multiplyVectors(Vector<int16_t>(ir[0]), toVector(ir), Vector<int16_t>(r, g, b));
-    pushColor();
+    multiplyVectors<flags, sf, lm>(Vector<int16_t>(ir[0]), toVector(ir), Vector<int16_t>(r, g, b));
+    pushColor<flags>();
 }
 
+template <bool flags, bool sf, bool lm>
 void GTE::dcpl() {
     auto prevIr = toVector(ir);
 
-    setMacAndIr<1>(((int64_t)farColor.r << 12) - (R * prevIr.x));
-    setMacAndIr<2>(((int64_t)farColor.g << 12) - (G * prevIr.y));
-    setMacAndIr<3>(((int64_t)farColor.b << 12) - (B * prevIr.z));
+    setMacAndIr<flags, 1, sf>(((int64_t)farColor.r << 12) - (R * prevIr.x));
+    setMacAndIr<flags, 2, sf>(((int64_t)farColor.g << 12) - (G * prevIr.y));
+    setMacAndIr<flags, 3, sf>(((int64_t)farColor.b << 12) - (B * prevIr.z));
 
-    setMacAndIr<1>(R * prevIr.x + ir[0] * ir[1], lm);
-    setMacAndIr<2>(G * prevIr.y + ir[0] * ir[2], lm);
-    setMacAndIr<3>(B * prevIr.z + ir[0] * ir[3], lm);
-    pushColor();
+    setMacAndIr<flags, 1, sf, lm>(R * prevIr.x + ir[0] * ir[1]);
+    setMacAndIr<flags, 2, sf, lm>(G * prevIr.y + ir[0] * ir[2]);
+    setMacAndIr<flags, 3, sf, lm>(B * prevIr.z + ir[0] * ir[3]);
+    pushColor<flags>();
 }
 
+template <bool flags, bool sf, bool lm>
 void GTE::intpl() {
     auto prevIr = toVector(ir);
 
-    setMacAndIr<1>(((int64_t)farColor.r << 12) - (prevIr.x << 12));
-    setMacAndIr<2>(((int64_t)farColor.g << 12) - (prevIr.y << 12));
-    setMacAndIr<3>(((int64_t)farColor.b << 12) - (prevIr.z << 12));
+    setMacAndIr<flags, 1, sf>(((int64_t)farColor.r << 12) - (prevIr.x << 12));
+    setMacAndIr<flags, 2, sf>(((int64_t)farColor.g << 12) - (prevIr.y << 12));
+    setMacAndIr<flags, 3, sf>(((int64_t)farColor.b << 12) - (prevIr.z << 12));
 
-    multiplyVectors(Vector<int16_t>(ir[0]), toVector(ir), prevIr);
-    pushColor();
+    multiplyVectors<flags, sf, lm>(Vector<int16_t>(ir[0]), toVector(ir), prevIr);
+    pushColor<flags>();
 }
 
 int GTE::countLeadingZeroes(uint32_t n) {
@@ -288,9 +295,10 @@ uint32_t GTE::recip(uint16_t divisor) {
     return tmp2;
 }
 
+template <bool flags>
 uint32_t GTE::divideUNR(uint32_t lhs, uint32_t rhs) {
     if (!(rhs * 2 > lhs)) {
-        flag.divide_overflow = 1;
+        if (flags) flag.divide_overflow = 1;
         return 0x1ffff;
     }
 
@@ -303,39 +311,43 @@ uint32_t GTE::divideUNR(uint32_t lhs, uint32_t rhs) {
     uint32_t result = ((uint64_t)lhs * reciprocal + 0x8000) >> 16;
 
     if (result > 0x1ffff) {
-        flag.divide_overflow = 1;
+        if (flags) flag.divide_overflow = 1;
         return 0x1ffff;
     }
     return result;
 }
 
+template <bool flags>
 void GTE::pushScreenXY(int32_t x, int32_t y) {
     s[0].x = s[1].x;
     s[0].y = s[1].y;
     s[1].x = s[2].x;
     s[1].y = s[2].y;
 
-    s[2].x = clip(x, 0x3ff, -0x400, Flag::SX2_SATURATED);
-    s[2].y = clip(y, 0x3ff, -0x400, Flag::SY2_SATURATED);
+    s[2].x = clip<flags>(x, 0x3ff, -0x400, Flag::SX2_SATURATED);
+    s[2].y = clip<flags>(y, 0x3ff, -0x400, Flag::SY2_SATURATED);
 }
 
+template <bool flags>
 void GTE::pushScreenZ(int32_t z) {
     s[0].z = s[1].z;
     s[1].z = s[2].z;
     s[2].z = s[3].z;  // There is only s[3].z (no s[3].xy)
 
-    s[3].z = clip(z, 0xffff, 0x0000, Flag::SZ3_OTZ_SATURATED);
+    s[3].z = clip<flags>(z, 0xffff, 0x0000, Flag::SZ3_OTZ_SATURATED);
 }
 
-void GTE::pushColor() { pushColor(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4); }
+template <bool flags>
+void GTE::pushColor() { pushColor<flags>(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4); }
 
+template <bool flags>
 void GTE::pushColor(uint32_t r, uint32_t g, uint32_t b) {
     rgb[0] = rgb[1];
     rgb[1] = rgb[2];
 
-    rgb[2].write(0, clip(r, 0xff, 0x00, Flag::COLOR_R_SATURATED));
-    rgb[2].write(1, clip(g, 0xff, 0x00, Flag::COLOR_G_SATURATED));
-    rgb[2].write(2, clip(b, 0xff, 0x00, Flag::COLOR_B_SATURATED));
+    rgb[2].write(0, clip<flags>(r, 0xff, 0x00, Flag::COLOR_R_SATURATED));
+    rgb[2].write(1, clip<flags>(g, 0xff, 0x00, Flag::COLOR_G_SATURATED));
+    rgb[2].write(2, clip<flags>(b, 0xff, 0x00, Flag::COLOR_B_SATURATED));
     rgb[2].write(3, rgbc.read(3));
 }
 
@@ -345,58 +357,65 @@ void GTE::pushColor(uint32_t r, uint32_t g, uint32_t b) {
  * Multiplicate vector (V) with rotation matrix (R),
  * translate it (TR) and apply perspective transformation.
  */
+template <bool flags, bool sf, bool lm>
 void GTE::rtps(int n, bool setMAC0) {
-    int64_t mac3 = multiplyMatrixByVectorRTP(rotation, v[n], translation);
+    int64_t mac3 = setMacAndIrRTP<flags>(gte::multiplyMatrixByVector<flags>(rotation, v[n], translation, sf, lm));
+    perspectiveTransform<flags>(mac3, setMAC0);
+}
 
-    pushScreenZ((int32_t)(mac3 >> 12));
-    int64_t h_s3z = divideUNR(h, s[3].z);
+template <bool flags>
+void GTE::perspectiveTransform(int64_t mac3, bool setMAC0) {
+    pushScreenZ<flags>((int32_t)(mac3 >> 12));
+    int64_t h_s3z = divideUNR<flags>(h, s[3].z);
 
     float ratio = widescreenHack ? 0.75f : 1.f;
-    int32_t x = setMac<0>((int64_t)(h_s3z * ir[1] * ratio) + of[0]) >> 16;
-    int32_t y = setMac<0>(h_s3z * ir[2] + of[1]) >> 16;
-    pushScreenXY(x, y);
+    int32_t x = setMac<flags, 0>((int64_t)(h_s3z * ir[1] * ratio) + of[0]) >> 16;
+    int32_t y = setMac<flags, 0>(h_s3z * ir[2] + of[1]) >> 16;
+    pushScreenXY<flags>(x, y);
 
     if (setMAC0) {
-        int64_t mac0 = setMac<0>(h_s3z * dqa + dqb);
-        ir[0] = clip(mac0 >> 12, 0x1000, 0x0000, Flag::IR0_SATURATED);
+        int64_t mac0 = setMac<flags, 0>(h_s3z * dqa + dqb);
+        ir[0] = clip<flags>(mac0 >> 12, 0x1000, 0x0000, Flag::IR0_SATURATED);
     }
 }
 
 /**
  * Same as RTPS, but repeated for vector 0, 1 and 2
+ * Rotation of all three vertices is independent, so it is done before perspective transformations
  */
+template <bool flags, bool sf, bool lm>
 void GTE::rtpt() {
-    rtps(0, false);
-    rtps(1, false);
-    rtps(2, true);
+    gte::Product rotated[3];
+    for (int n = 0; n < 3; n++) rotated[n] = gte::multiplyMatrixByVector<flags>(rotation, v[n], translation, sf, lm);
+
+    for (int n = 0; n < 3; n++) perspectiveTransform<flags>(setMacAndIrRTP<flags>(rotated[n]), n == 2);
 }
 
 /**
  * Calculate average of 3 z values
  */
-void GTE::avsz3() { setOtz(setMac<0>((int64_t)zsf3 * (s[1].z + s[2].z + s[3].z))); }
+template <bool flags>
+void GTE::avsz3() { setOtz<flags>(setMac<flags, 0>((int64_t)zsf3 * (s[1].z + s[2].z + s[3].z))); }
 
 /**
  * Calculate average of 4 z values
  */
-void GTE::avsz4() { setOtz(setMac<0>((int64_t)zsf4 * (s[0].z + s[1].z + s[2].z + s[3].z))); }
-
-void GTE::mvmva(int mx, int vx, int tx) {
-    Matrix Mx;
-    if (mx == 0) {
-        Mx = rotation;
-    } else if (mx == 1) {
-        Mx = light;
-    } else if (mx == 2) {
-        Mx = color;
-    } else {
+template <bool flags>
+void GTE::avsz4() { setOtz<flags>(setMac<flags, 0>((int64_t)zsf4 * (s[0].z + s[1].z + s[2].z + s[3].z))); }
+
+template <bool flags, bool sf, bool lm, int mx, int vx, int tx>
+void GTE::mvmva() {
+    // Matrices are referenced, not copied - SIMD path loads them whole
+    Matrix buggy;
+    if (mx == 3) {
         // Buggy matrix selected
-        Mx[0][0] = -R;
-        Mx[0][1] = R;
-        Mx[0][2] = ir[0];
-        Mx[1][0] = Mx[1][1] = Mx[1][2] = rotation[0][2];
-        Mx[2][0] = Mx[2][1] = Mx[2][2] = rotation[1][1];
+        buggy[0][0] = -R;
+        buggy[0][1] = R;
+        buggy[0][2] = ir[0];
+        buggy[1][0] = buggy[1][1] = buggy[1][2] = rotation[0][2];
+        buggy[2][0] = buggy[2][1] = buggy[2][2] = rotation[1][1];
     }
+    const Matrix& Mx = mx == 0 ? rotation : mx == 1 ? light : mx == 2 ? color : buggy;
 
     Vector<int16_t> V;
     if (vx == 0) {
@@ -422,25 +441,25 @@ void GTE::mvmva(int mx, int vx, int tx) {
 
         Vector<int64_t> result;
         // Flag is calculated from 1st component
-        setIr<1>(O(1, ((int64_t)Tx.x << 12) + Mx[0][0] * V.x) >> (sf * 12));
-        setIr<2>(O(2, ((int64_t)Tx.y << 12) + Mx[1][0] * V.x) >> (sf * 12));
-        setIr<3>(O(3, ((int64_t)Tx.z << 12) + Mx[2][0] * V.x) >> (sf * 12));
+        setIr<flags, 1>(O(1, ((int64_t)Tx.x << 12) + Mx[0][0] * V.x) >> (sf * 12));
+        setIr<flags, 2>(O(2, ((int64_t)Tx.y << 12) + Mx[1][0] * V.x) >> (sf * 12));
+        setIr<flags, 3>(O(3, ((int64_t)Tx.z << 12) + Mx[2][0] * V.x) >> (sf * 12));
 
         // But result is 2nd and 3rd components
         result.x = O(1, O(1, Mx[0][1] * V.y) + Mx[0][2] * V.z);
         result.y = O(2, O(2, Mx[1][1] * V.y) + Mx[1][2] * V.z);
         result.z = O(3, O(3, Mx[2][1] * V.y) + Mx[2][2] * V.z);
 
-        setMacAndIr<1>(result.x, lm);
-        setMacAndIr<2>(result.y, lm);
-        setMacAndIr<3>(result.z, lm);
+        setMacAndIr<flags, 1, sf, lm>(result.x);
+        setMacAndIr<flags, 2, sf, lm>(result.y);
+        setMacAndIr<flags, 3, sf, lm>(result.z);
         return;
 
     } else {
         Tx.x = Tx.y = Tx.z = 0;
     }
 
-    multiplyMatrixByVector(Mx, V, Tx);
+    multiplyMatrixByVector<flags, sf, lm>(Mx, V, Tx);
 }
 
 /**
@@ -449,34 +468,124 @@ void GTE::mvmva(int mx, int vx, int tx) {
  *
  * Result is also saved as 24bit color
  */
+template <bool flags, bool sf, bool lm>
 void GTE::gpf() {
-    multiplyVectors(Vector<int16_t>(ir[0]), toVector(ir));
-    pushColor();
+    multiplyVectors<flags, sf, lm>(Vector<int16_t>(ir[0]), toVector(ir));
+    pushColor<flags>();
 }
 
 /**
  * Same as gpf, but add mac[i]
  * Multiply vector (ir[1..3]) by scalar(ir[0]) and add mac[1..3]
  */
+template <bool flags, bool sf, bool lm>
 void GTE::gpl() {
-    setMacAndIr<1>(((int64_t)mac[1] << (sf * 12)) + ir[0] * ir[1], lm);
-    setMacAndIr<2>(((int64_t)mac[2] << (sf * 12)) + ir[0] * ir[2], lm);
-    setMacAndIr<3>(((int64_t)mac[3] << (sf * 12)) + ir[0] * ir[3], lm);
-    pushColor();
+    setMacAndIr<flags, 1, sf, lm>(((int64_t)mac[1] << (sf * 12)) + ir[0] * ir[1]);
+    setMacAndIr<flags, 2, sf, lm>(((int64_t)mac[2] << (sf * 12)) + ir[0] * ir[2]);
+    setMacAndIr<flags, 3, sf, lm>(((int64_t)mac[3] << (sf * 12)) + ir[0] * ir[3]);
+    pushColor<flags>();
 }
 
 /**
  * Square vector
  * lm is ignored, as result cannot be negative
  */
-void GTE::sqr() { multiplyVectors(toVector(ir), toVector(ir)); }
+template <bool flags, bool sf, bool lm>
+void GTE::sqr() { multiplyVectors<flags, sf, lm>(toVector(ir), toVector(ir)); }
 
+template <bool flags, bool sf, bool lm>
 void GTE::op() {
-    setMac<1>(rotation[1][1] * ir[3] - rotation[2][2] * ir[2]);
-    setMac<2>(rotation[2][2] * ir[1] - rotation[0][0] * ir[3]);
-    setMac<3>(rotation[0][0] * ir[2] - rotation[1][1] * ir[1]);
-
-    setIr<1>(mac[1], lm);
-    setIr<2>(mac[2], lm);
-    setIr<3>(mac[3], lm);
-}
\ No newline at end of file
+    setMac<flags, 1, sf>(rotation[1][1] * ir[3] - rotation[2][2] * ir[2]);
+    setMac<flags, 2, sf>(rotation[2][2] * ir[1] - rotation[0][0] * ir[3]);
+    setMac<flags, 3, sf>(rotation[0][0] * ir[2] - rotation[1][1] * ir[1]);
+
+    setIr<flags, 1, lm>(mac[1]);
+    setIr<flags, 2, lm>(mac[2]);
+    setIr<flags, 3, lm>(mac[3]);
+}
+
+template <bool flags, uint32_t index>
+bool GTE::runCommand() {
+    constexpr bool sf = (index >> 7) & 1;
+    constexpr bool lm = (index >> 6) & 1;
+    constexpr uint32_t cmd = index & 0x3f;
+
+    if constexpr (!flags && !lazyFlag(cmd)) {
+        return false;  // Only commands with lazy FLAG are run without it
+    } else if constexpr (cmd == 0x01) {
+        rtps<flags, sf, lm>();
+    } else if constexpr (cmd == 0x06) {
+        nclip<flags>();
+    } else if constexpr (cmd == 0x0c) {
+        op<flags, sf, lm>();
+    } else if constexpr (cmd == 0x10) {
+        dpcs<flags, sf, lm>();
+    } else if constexpr (cmd == 0x11) {
+        intpl<flags, sf, lm>();
+    } else if constexpr (cmd == 0x13) {
+        ncds<flags, sf, lm>();
+    } else if constexpr (cmd == 0x14) {
+        cdp<flags, sf, lm>();
+    } else if constexpr (cmd == 0x16) {
+        ncdt<flags, sf, lm>();
+    } else if constexpr (cmd == 0x1b) {
+        nccs<flags, sf, lm>();
+    } else if constexpr (cmd == 0x1c) {
+        cc<flags, sf, lm>();
+    } else if constexpr (cmd == 0x1e) {
+        ncs<flags, sf, lm>();
+    } else if constexpr (cmd == 0x20) {
+        nct<flags, sf, lm>();
+    } else if constexpr (cmd == 0x2a) {
+        dpct<flags, sf, lm>();
+    } else if constexpr (cmd == 0x28) {
+        sqr<flags, sf, lm>();
+    } else if constexpr (cmd == 0x29) {
+        dcpl<flags, sf, lm>();
+    } else if constexpr (cmd == 0x2d) {
+        avsz3<flags>();
+    } else if constexpr (cmd == 0x2e) {
+        avsz4<flags>();
+    } else if constexpr (cmd == 0x30) {
+        rtpt<flags, sf, lm>();
+    } else if constexpr (cmd == 0x3d) {
+        gpf<flags, sf, lm>();
+    } else if constexpr (cmd == 0x3e) {
+        gpl<flags, sf, lm>();
+    } else if constexpr (cmd == 0x3f) {
+        ncct<flags, sf, lm>();
+    } else {
+        return false;  // MVMVA (0x12) has its own handlers
+    }
+    return true;
+}
+
+template <bool flags, uint32_t... index>
+constexpr std::array<GTE::Handler, sizeof...(index)> GTE::makeHandlers(std::integer_sequence<uint32_t, index...>) {
+    return {{&GTE::runCommand<flags, index>...}};
+}
+
+template <uint32_t... index>
+constexpr std::array<GTE::MvmvaHandler, sizeof...(index)> GTE::makeMvmvaHandlers(std::integer_sequence<uint32_t, index...>) {
+    return {{&GTE::mvmva<true, (index >> 7) & 1, index & 1, (index >> 5) & 3, (index >> 3) & 3, (index >> 1) & 3>...}};
+}
+
+template <bool flags>
+bool GTE::execute(gte::Command cmd) {
+    static constexpr auto handlers = makeHandlers<flags>(std::make_integer_sequence<uint32_t, 0x100>());
+
+    if constexpr (flags) {
+        if (cmd.cmd == 0x12) {
+            static constexpr auto mvmvaHandlers = makeMvmvaHandlers(std::make_integer_sequence<uint32_t, 0x100>());
+            uint32_t index = (cmd.sf << 7) | (cmd.mvmvaMultiplyMatrix << 5) | (cmd.mvmvaMultiplyVector << 3)
+                             | (cmd.mvmvaTranslationVector << 1) | cmd.lm;
+            (this->*mvmvaHandlers[index])();
+            return true;
+        }
+    }
+
+    return (this->*handlers[(cmd.sf << 7) | (cmd.lm << 6) | cmd.cmd])();
+}
+
+template bool GTE::execute<false>(gte::Command cmd);
+template bool GTE::execute<true>(gte::Command cmd);
@@ -0,0 +1,133 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include "gte.h"
+#include "utils/macros.h"
+
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define GTE_SIMD
+#include <immintrin.h>
+#endif
+
+namespace gte {
+// Matrix by vector product as written to GTE registers by GTE::setMacAndIr
+// Rows 0..2, 4th element is padding so SIMD path can store whole registers.
+struct Product {
+    int64_t value[4];  // 44bit sums before sf shift (needed by RTP)
+    int32_t mac[4];
+    int16_t ir[4];
+    uint32_t flags;  // MACn overflow and IRn saturation bits
+};
+
+#ifdef GTE_SIMD
+// Sums are checked against 44bit range by biasing them to unsigned and looking at upper bits.
+// Overflow direction is kept in bit 63 of accumulators:
+// negative - set if any sum was below range, noPositive - cleared if any sum was above range.
+INLINE inline __m128i accumulate(__m128i sum, __m128i product, __m128i& negative, __m128i& noPositive) {
+    const __m128i bias = _mm_set1_epi64x(1LL << 43);
+    sum = _mm_add_epi64(sum, product);
+    __m128i biased = _mm_add_epi64(sum, bias);
+    __m128i inRange = _mm_cmpeq_epi64(_mm_srli_epi64(biased, 44), _mm_setzero_si128());
+    negative = _mm_or_si128(negative, _mm_andnot_si128(inRange, sum));
+    noPositive = _mm_and_si128(noPositive, _mm_or_si128(inRange, sum));
+    return _mm_sub_epi64(_mm_and_si128(biased, _mm_set1_epi64x((1LL << 44) - 1)), bias);
+}
+
+inline int signMask(__m128i lo, __m128i hi) { return _mm_movemask_pd(_mm_castsi128_pd(lo)) | (_mm_movemask_pd(_mm_castsi128_pd(hi)) << 2); }
+#endif
+
+// Reference implementation, used on platforms without SIMD
+template <bool flags = true>
+inline Product multiplyMatrixByVectorScalar(const Matrix& m, const Vector<int16_t>& v, const Vector<int32_t>& tr, bool sf, bool lm) {
+    const int32_t vector[3] = {v.x, v.y, v.z};
+    const int32_t translation[3] = {tr.x, tr.y, tr.z};
+
+    Product p = {};
+    for (int i = 0; i < 3; i++) {
+        int64_t sum = (int64_t)translation[i] << 12;
+        for (int j = 0; j < 3; j++) {
+            sum += m[i][j] * vector[j];
+            if (flags && sum >= (1LL << 43)) p.flags |= GTE::Flag::MAC1_OVERFLOW_POSITIVE >> i;
+            if (flags && sum < -(1LL << 43)) p.flags |= GTE::Flag::MAC1_OVERFLOW_NEGATIVE >> i;
+            sum = extend_sign<43, int64_t>(sum);
+        }
+
+        p.value[i] = sum;
+        p.mac[i] = (int32_t)(sf ? sum >> 12 : sum);
+
+        const int32_t min = lm ? 0 : -0x8000;
+        if (flags && (p.mac[i] > 0x7fff || p.mac[i] < min)) p.flags |= GTE::Flag::IR1_SATURATED >> i;
+        p.ir[i] = std::clamp(p.mac[i], min, 0x7fff);
+    }
+    return p;
+}
+
+// (tr << 12) + m * v, every partial sum is checked for overflow and truncated to 44 bits.
+// All three rows are computed in parallel lanes when SSE4.1 is available (two 64bit lanes per register).
+// Without flags overflow tracking is unused and optimized out.
+#ifdef GTE_SIMD
+template <bool flags = true>
+INLINE inline Product multiplyMatrixByVector(const Matrix& m, const Vector<int16_t>& v, const Vector<int32_t>& tr, bool sf, bool lm) {
+    // Lane per matrix row in reverse order (lane 0 - row 2), so lane masks map directly to flag bits (MAC3/IR3 are lowest).
+    // 4th lane is zero. Each column is expanded to 32bit lanes (upper half zero) and multiplied with pmaddwd.
+    const __m128i rows = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m.data()));  // m00..m21
+    const __m128i columns[3] = {
+        _mm_shuffle_epi8(rows, _mm_setr_epi8(12, 13, -1, -1, 6, 7, -1, -1, 0, 1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(rows, _mm_setr_epi8(14, 15, -1, -1, 8, 9, -1, -1, 2, 3, -1, -1, -1, -1, -1, -1)),
+        _mm_insert_epi16(_mm_shuffle_epi8(rows, _mm_setr_epi8(-1, -1, -1, -1, 10, 11, -1, -1, 4, 5, -1, -1, -1, -1, -1, -1)), m[2][2], 0),
+    };
+    const __m128i product[3] = {
+        _mm_madd_epi16(columns[0], _mm_set1_epi32(static_cast<uint16_t>(v.x))),
+        _mm_madd_epi16(columns[1], _mm_set1_epi32(static_cast<uint16_t>(v.y))),
+        _mm_madd_epi16(columns[2], _mm_set1_epi32(static_cast<uint16_t>(v.z))),
+    };
+    const __m128i translation = _mm_setr_epi32(tr.z, tr.y, tr.x, 0);
+    const __m128i shift = _mm_cvtsi32_si128(sf ? 12 : 0);
+
+    Product p;
+    __m128i mac;
+    int negative, positive;
+
+    __m128i negativeLanes[2] = {_mm_setzero_si128(), _mm_setzero_si128()};
+    __m128i noPositiveLanes[2] = {_mm_set1_epi64x(-1), _mm_set1_epi64x(-1)};
+    __m128i sum[2] = {
+        _mm_slli_epi64(_mm_cvtepi32_epi64(translation), 12),
+        _mm_slli_epi64(_mm_cvtepi32_epi64(_mm_srli_si128(translation, 8)), 12),
+    };
+    for (int j = 0; j < 3; j++) {
+        sum[0] = accumulate(sum[0], _mm_cvtepi32_epi64(product[j]), negativeLanes[0], noPositiveLanes[0]);
+        sum[1] = accumulate(sum[1], _mm_cvtepi32_epi64(_mm_srli_si128(product[j], 8)), negativeLanes[1], noPositiveLanes[1]);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p.value), _mm_unpacklo_epi64(sum[1], _mm_unpackhi_epi64(sum[0], sum[0])));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p.value + 2), sum[0]);
+
+    // Lower 32 bits of every lane (upper bits are dropped when MAC is written)
+    mac = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(_mm_srl_epi64(sum[0], shift)), _mm_castsi128_ps(_mm_srl_epi64(sum[1], shift)),
+                                          _MM_SHUFFLE(2, 0, 2, 0)));
+    negative = signMask(negativeLanes[0], negativeLanes[1]);
+    positive = ~signMask(noPositiveLanes[0], noPositiveLanes[1]);
+
+    __m128i ir = _mm_min_epi32(_mm_max_epi32(mac, _mm_set1_epi32(lm ? 0 : -0x8000)), _mm_set1_epi32(0x7fff));
+    int saturated = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(ir, mac)));
+
+    // Back to row order
+    mac = _mm_shuffle_epi32(mac, _MM_SHUFFLE(3, 0, 1, 2));
+    ir = _mm_shuffle_epi32(ir, _MM_SHUFFLE(3, 0, 1, 2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p.mac), mac);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p.ir), _mm_packs_epi32(ir, ir));
+
+    if (!flags) {
+        p.flags = 0;
+        return p;
+    }
+    p.flags = ((positive & 7) * GTE::Flag::MAC3_OVERFLOW_POSITIVE) | ((negative & 7) * GTE::Flag::MAC3_OVERFLOW_NEGATIVE)
+              | ((saturated & 7) * GTE::Flag::IR3_SATURATED);
+    return p;
+}
+#else
+template <bool flags = true>
+INLINE inline Product multiplyMatrixByVector(const Matrix& m, const Vector<int16_t>& v, const Vector<int32_t>& tr, bool sf, bool lm) {
+    return multiplyMatrixByVectorScalar<flags>(m, v, tr, sf, lm);
+}
+#endif
+};  // namespace gte
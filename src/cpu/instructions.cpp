@@ -1,5 +1,6 @@
 #include "instructions.h"
 #include <cstdio>
+#include <utility>
 #include "system.h"
 
 using namespace mips;
@@ -7,157 +8,155 @@ using namespace mips;
 namespace instructions {
 
 // clang-format off
-std::array<PrimaryInstruction, 64> OpcodeTable = {{
-    {0, special},
-    {1, branch},
-    {2, op_j},
-    {3, op_jal},
-    {4, op_beq},
-    {5, op_bne},
-    {6, op_blez},
-    {7, op_bgtz},
-
-    {8, op_addi},
-    {9, op_addiu},
-    {10, op_slti},
-    {11, op_sltiu},
-    {12, op_andi},
-    {13, op_ori},
-    {14, op_xori},
-    {15, op_lui},
-
-    {16, op_cop0},
-    {17, dummy},
-    {18, op_cop2},
-    {19, dummy},
-    {20, invalid},
-    {21, invalid},
-    {22, invalid},
-    {23, invalid},
-
-    {24, invalid},
-    {25, invalid},
-    {26, invalid},
-    {27, invalid},
-    {28, invalid},
-    {29, invalid},
-    {30, invalid},
-    {31, invalid},
-
-    {32, op_lb},
-    {33, op_lh},
-    {34, op_lwl},
-    {35, op_lw},
-    {36, op_lbu},
-    {37, op_lhu},
-    {38, op_lwr},
-    {39, invalid},
-
-    {40, op_sb},
-    {41, op_sh},
-    {42, op_swl},
-    {43, op_sw},
-    {44, invalid},
-    {45, invalid},
-    {46, op_swr},
-    {47, invalid},
-
-    {48, dummy},
-    {49, dummy},
-    {50, op_lwc2},
-    {51, dummy},
-    {52, invalid},
-    {53, invalid},
-    {54, invalid},
-    {55, invalid},
-
-    {56, dummy},
-    {57, dummy},
-    {58, op_swc2},
-    {59, dummy},
-    {60, invalid},
-    {61, invalid},
-    {62, invalid},
-#ifdef ENABLE_BREAKPOINTS
-    {63, op_breakpoint}
-#else
-    {63, invalid}
-#endif
+template <uint32_t F>
+constexpr std::array<PrimaryInstruction, 64> OpcodeTable = {{
+    {0, special<F>},
+    {1, branch<F>},
+    {2, op_j<F>},
+    {3, op_jal<F>},
+    {4, op_beq<F>},
+    {5, op_bne<F>},
+    {6, op_blez<F>},
+    {7, op_bgtz<F>},
+
+    {8, op_addi<F>},
+    {9, op_addiu<F>},
+    {10, op_slti<F>},
+    {11, op_sltiu<F>},
+    {12, op_andi<F>},
+    {13, op_ori<F>},
+    {14, op_xori<F>},
+    {15, op_lui<F>},
+
+    {16, op_cop0<F>},
+    {17, dummy<F>},
+    {18, op_cop2<F>},
+    {19, dummy<F>},
+    {20, invalid<F>},
+    {21, invalid<F>},
+    {22, invalid<F>},
+    {23, invalid<F>},
+
+    {24, invalid<F>},
+    {25, invalid<F>},
+    {26, invalid<F>},
+    {27, invalid<F>},
+    {28, invalid<F>},
+    {29, invalid<F>},
+    {30, invalid<F>},
+    {31, invalid<F>},
+
+    {32, op_lb<F>},
+    {33, op_lh<F>},
+    {34, op_lwl<F>},
+    {35, op_lw<F>},
+    {36, op_lbu<F>},
+    {37, op_lhu<F>},
+    {38, op_lwr<F>},
+    {39, invalid<F>},
+
+    {40, op_sb<F>},
+    {41, op_sh<F>},
+    {42, op_swl<F>},
+    {43, op_sw<F>},
+    {44, invalid<F>},
+    {45, invalid<F>},
+    {46, op_swr<F>},
+    {47, invalid<F>},
+
+    {48, dummy<F>},
+    {49, dummy<F>},
+    {50, op_lwc2<F>},
+    {51, dummy<F>},
+    {52, invalid<F>},
+    {53, invalid<F>},
+    {54, invalid<F>},
+    {55, invalid<F>},
+
+    {56, dummy<F>},
+    {57, dummy<F>},
+    {58, op_swc2<F>},
+    {59, dummy<F>},
+    {60, invalid<F>},
+    {61, invalid<F>},
+    {62, invalid<F>},
+    {63, (F & Feature::BREAKPOINTS) ? op_breakpoint<F> : invalid<F>}
 }};
 
 // opcodes encoded with "function" field, when opcode == 0
-std::array<PrimaryInstruction, 64> SpecialTable = {{
-    {0, op_sll},
-    {1, invalid},
-    {2, op_srl},
-    {3, op_sra},
-    {4, op_sllv},
-    {5, invalid},
-    {6, op_srlv},
-    {7, op_srav},
-
-    {8, op_jr},
-    {9, op_jalr},
-    {10, invalid},
-    {11, invalid},
-    {12, op_syscall},
-    {13, op_break},
-    {14, invalid},
-    {15, invalid},
-
-    {16, op_mfhi},
-    {17, op_mthi},
-    {18, op_mflo},
-    {19, op_mtlo},
-    {20, invalid},
-    {21, invalid},
-    {22, invalid},
-    {23, invalid},
-
-    {24, op_mult},
-    {25, op_multu},
-    {26, op_div},
-    {27, op_divu},
-    {28, invalid},
-    {29, invalid},
-    {30, invalid},
-    {31, invalid},
-
-    {32, op_add},
-    {33, op_addu},
-    {34, op_sub},
-    {35, op_subu},
-    {36, op_and},
-    {37, op_or},
-    {38, op_xor},
-    {39, op_nor},
-
-    {40, invalid},
-    {41, invalid},
-    {42, op_slt},
-    {43, op_sltu},
-    {44, invalid},
-    {45, invalid},
-    {46, invalid},
-    {47, invalid},
-
-    {48, invalid},
-    {49, invalid},
-    {50, invalid},
-    {51, invalid},
-    {52, invalid},
-    {53, invalid},
-    {54, invalid},
-    {55, invalid},
-
-    {56, invalid},
-    {57, invalid},
-    {58, invalid},
-    {59, invalid},
-    {60, invalid},
-    {61, invalid},
-    {62, invalid},
-    {63, invalid},
+template <uint32_t F>
+constexpr std::array<PrimaryInstruction, 64> SpecialTable = {{
+    {0, op_sll<F>},
+    {1, invalid<F>},
+    {2, op_srl<F>},
+    {3, op_sra<F>},
+    {4, op_sllv<F>},
+    {5, invalid<F>},
+    {6, op_srlv<F>},
+    {7, op_srav<F>},
+
+    {8, op_jr<F>},
+    {9, op_jalr<F>},
+    {10, invalid<F>},
+    {11, invalid<F>},
+    {12, op_syscall<F>},
+    {13, op_break<F>},
+    {14, invalid<F>},
+    {15, invalid<F>},
+
+    {16, op_mfhi<F>},
+    {17, op_mthi<F>},
+    {18, op_mflo<F>},
+    {19, op_mtlo<F>},
+    {20, invalid<F>},
+    {21, invalid<F>},
+    {22, invalid<F>},
+    {23, invalid<F>},
+
+    {24, op_mult<F>},
+    {25, op_multu<F>},
+    {26, op_div<F>},
+    {27, op_divu<F>},
+    {28, invalid<F>},
+    {29, invalid<F>},
+    {30, invalid<F>},
+    {31, invalid<F>},
+
+    {32, op_add<F>},
+    {33, op_addu<F>},
+    {34, op_sub<F>},
+    {35, op_subu<F>},
+    {36, op_and<F>},
+    {37, op_or<F>},
+    {38, op_xor<F>},
+    {39, op_nor<F>},
+
+    {40, invalid<F>},
+    {41, invalid<F>},
+    {42, op_slt<F>},
+    {43, op_sltu<F>},
+    {44, invalid<F>},
+    {45, invalid<F>},
+    {46, invalid<F>},
+    {47, invalid<F>},
+
+    {48, invalid<F>},
+    {49, invalid<F>},
+    {50, invalid<F>},
+    {51, invalid<F>},
+    {52, invalid<F>},
+    {53, invalid<F>},
+    {54, invalid<F>},
+    {55, invalid<F>},
+
+    {56, invalid<F>},
+    {57, invalid<F>},
+    {58, invalid<F>},
+    {59, invalid<F>},
+    {60, invalid<F>},
+    {61, invalid<F>},
+    {62, invalid<F>},
+    {63, invalid<F>},
 }};
 // clang-format on
 
@@ -192,11 +191,76 @@ void exception(CPU *cpu, COP0::CAUSE::Exception cause) {
     cpu->setPC(cpu->cop0.status.getHandlerAddress());
 }
 
+namespace {
+// Both tables merged, indexed by handlerIndex()
+template <uint32_t F>
+constexpr std::array<_Instruction, HANDLER_COUNT> makeHandlerTable() {
+    std::array<_Instruction, HANDLER_COUNT> table = {};
+    for (size_t i = 0; i < 64; i++) {
+        table[i] = OpcodeTable<F>[i].instruction;
+        table[64 + i] = SpecialTable<F>[i].instruction;
+    }
+    return table;
+}
+
+template <uint32_t F>
+constexpr std::array<_Instruction, HANDLER_COUNT> HandlerTable = makeHandlerTable<F>();
+
+template <uint32_t F>
+bool interpret(CPU *cpu, int count);
+
+template <uint32_t... F>
+constexpr auto makeHandlerTables(std::integer_sequence<uint32_t, F...>) {
+    return std::array<const std::array<_Instruction, HANDLER_COUNT> *, sizeof...(F)>{{&HandlerTable<F>...}};
+}
+
+template <uint32_t... F>
+constexpr auto makeInterpreters(std::integer_sequence<uint32_t, F...>) {
+    return std::array<Interpreter, sizeof...(F)>{{&interpret<F>...}};
+}
+
+const auto handlerTables = makeHandlerTables(std::make_integer_sequence<uint32_t, Feature::COMBINATIONS>());
+const auto interpreters = makeInterpreters(std::make_integer_sequence<uint32_t, Feature::COMBINATIONS>());
+
+// Memory access done by instructions, logs IO access if IO_LOG feature is enabled
+template <uint32_t F, typename T>
+INLINE T readMemory(CPU *cpu, uint32_t address) {
+    T data;
+    if constexpr (sizeof(T) == 1) data = cpu->sys->readMemory8(address);
+    if constexpr (sizeof(T) == 2) data = cpu->sys->readMemory16(address);
+    if constexpr (sizeof(T) == 4) data = cpu->sys->readMemory32(address);
+
+    if constexpr ((F & Feature::IO_LOG) != 0) {
+        if (System::isIo(address)) cpu->sys->ioLogList.push_back({System::IO_LOG_ENTRY::MODE::READ, sizeof(T) * 8, address, data, cpu->PC});
+    }
+    return data;
+}
+
+template <uint32_t F, typename T>
+INLINE void writeMemory(CPU *cpu, uint32_t address, T data) {
+    if constexpr ((F & Feature::IO_LOG) != 0) {
+        if (System::isIo(address)) cpu->sys->ioLogList.push_back({System::IO_LOG_ENTRY::MODE::WRITE, sizeof(T) * 8, address, data, cpu->PC});
+    }
+
+    if constexpr (sizeof(T) == 1) cpu->sys->writeMemory8(address, data);
+    if constexpr (sizeof(T) == 2) cpu->sys->writeMemory16(address, data);
+    if constexpr (sizeof(T) == 4) cpu->sys->writeMemory32(address, data);
+}
+};  // namespace
+
+const std::array<_Instruction, HANDLER_COUNT> &getHandlerTable(uint32_t features) { return *handlerTables[features]; }
+
+_Instruction decode(uint32_t features, Opcode i) { return (*handlerTables[features])[handlerIndex(i)]; }
+
+Interpreter getInterpreter(uint32_t features) { return interpreters[features]; }
+
+template <uint32_t F>
 void dummy(CPU *cpu, Opcode i) {
     UNUSED(cpu);
     UNUSED(i);
 }
 
+template <uint32_t F>
 void invalid(CPU *cpu, Opcode i) {
     UNUSED(i);
     // printf("Invalid opcode at 0x%08x: 0x%08x\n", cpu->PC, i.opcode);
@@ -206,43 +270,53 @@ void invalid(CPU *cpu, Opcode i) {
     // TODO: cpu->sys kinda sucks
 }
 
+template <uint32_t F>
 void notImplemented(CPU *cpu, Opcode i) {
     printf("Opcode not implemented at 0x%08x: 0x%08x\n", cpu->PC, i.opcode);
     cpu->sys->state = System::State::halted;
+    cpu->attention = true;
     // TODO: cpu->sys kinda sucks
 }
 
+template <uint32_t F>
 void special(CPU *cpu, Opcode i) {
-    const auto &instruction = SpecialTable[i.fun];
+    const auto &instruction = SpecialTable<F>[i.fun];
     instruction.instruction(cpu, i);
 }
 
 // Shift Word Left Logical
 // SLL rd, rt, a
-void op_sll(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rd, cpu->reg[i.rt] << i.sh); }
+template <uint32_t F>
+void op_sll(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rd, cpu->reg[i.rt] << i.sh); }
 
 // Shift Word Right Logical
 // SRL rd, rt, a
-void op_srl(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rd, cpu->reg[i.rt] >> i.sh); }
+template <uint32_t F>
+void op_srl(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rd, cpu->reg[i.rt] >> i.sh); }
 
 // Shift Word Right Arithmetic
 // SRA rd, rt, a
-void op_sra(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rd, ((int32_t)cpu->reg[i.rt]) >> i.sh); }
+template <uint32_t F>
+void op_sra(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rd, ((int32_t)cpu->reg[i.rt]) >> i.sh); }
 
 // Shift Word Left Logical Variable
 // SLLV rd, rt, rs
-void op_sllv(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rd, cpu->reg[i.rt] << (cpu->reg[i.rs] & 0x1f)); }
+template <uint32_t F>
+void op_sllv(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rd, cpu->reg[i.rt] << (cpu->reg[i.rs] & 0x1f)); }
 
 // Shift Word Right Logical Variable
 // SRLV rd, rt, a
-void op_srlv(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rd, cpu->reg[i.rt] >> (cpu->reg[i.rs] & 0x1f)); }
+template <uint32_t F>
+void op_srlv(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rd, cpu->reg[i.rt] >> (cpu->reg[i.rs] & 0x1f)); }
 
 // Shift Word Right Arithmetic Variable
 // SRAV rd, rt, rs
-void op_srav(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rd, ((int32_t)cpu->reg[i.rt]) >> (cpu->reg[i.rs] & 0x1f)); }
+template <uint32_t F>
+void op_srav(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rd, ((int32_t)cpu->reg[i.rt]) >> (cpu->reg[i.rs] & 0x1f)); }
 
 // Jump Register
 // JR rs
+template <uint32_t F>
 void op_jr(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs];
     cpu->inBranchDelay = true;
@@ -256,10 +330,11 @@ void op_jr(CPU *cpu, Opcode i) {
 
 // Jump Register
 // JALR
+template <uint32_t F>
 void op_jalr(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs];
     cpu->inBranchDelay = true;
-    cpu->loadAndInvalidate(i.rd, cpu->nextPC);
+    cpu->loadAndInvalidate<F>(i.rd, cpu->nextPC);
     if (unlikely(addr & 3)) {
         cpu->cop0.bada = addr;
         exception(cpu, COP0::CAUSE::Exception::addressErrorLoad);
@@ -270,9 +345,10 @@ void op_jalr(CPU *cpu, Opcode i) {
 
 // Syscall
 // SYSCALL
+template <uint32_t F>
 void op_syscall(CPU *cpu, Opcode i) {
     UNUSED(i);
-    if (cpu->sys->biosLog) {
+    if constexpr ((F & Feature::BIOS_TRACE) != 0) {
         cpu->sys->handleSyscallFunction();
     }
     exception(cpu, COP0::CAUSE::Exception::syscall);
@@ -280,6 +356,7 @@ void op_syscall(CPU *cpu, Opcode i) {
 
 // Break
 // BREAK
+template <uint32_t F>
 void op_break(CPU *cpu, Opcode i) {
     UNUSED(i);
     exception(cpu, COP0::CAUSE::Exception::breakpoint);
@@ -287,22 +364,27 @@ void op_break(CPU *cpu, Opcode i) {
 
 // Move From Hi
 // MFHI rd
-void op_mfhi(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rd, cpu->hi); }
+template <uint32_t F>
+void op_mfhi(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rd, cpu->hi); }
 
 // Move To Hi
 // MTHI rd
+template <uint32_t F>
 void op_mthi(CPU *cpu, Opcode i) { cpu->hi = cpu->reg[i.rs]; }
 
 // Move From Lo
 // MFLO rd
-void op_mflo(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rd, cpu->lo); }
+template <uint32_t F>
+void op_mflo(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rd, cpu->lo); }
 
 // Move To Lo
 // MTLO rd
+template <uint32_t F>
 void op_mtlo(CPU *cpu, Opcode i) { cpu->lo = cpu->reg[i.rs]; }
 
 // Multiply
 // mult rs, rt
+template <uint32_t F>
 void op_mult(CPU *cpu, Opcode i) {
     uint64_t temp = (int64_t)(int32_t)cpu->reg[i.rs] * (int64_t)(int32_t)cpu->reg[i.rt];
     cpu->lo = temp & 0xffffffff;
@@ -311,6 +393,7 @@ void op_mult(CPU *cpu, Opcode i) {
 
 // Multiply Unsigned
 // multu rs, rt
+template <uint32_t F>
 void op_multu(CPU *cpu, Opcode i) {
     uint64_t temp = (uint64_t)cpu->reg[i.rs] * (uint64_t)cpu->reg[i.rt];
     cpu->lo = temp & 0xffffffff;
@@ -318,6 +401,7 @@ void op_multu(CPU *cpu, Opcode i) {
 }
 // Divide
 // div rs, rt
+template <uint32_t F>
 void op_div(CPU *cpu, Opcode i) {
     int32_t rs = (int32_t)cpu->reg[i.rs];
     int32_t rt = (int32_t)cpu->reg[i.rt];
@@ -335,6 +419,7 @@ void op_div(CPU *cpu, Opcode i) {
 
 // Divide Unsigned Word
 // divu rs, rt
+template <uint32_t F>
 void op_divu(CPU *cpu, Opcode i) {
     uint32_t rs = cpu->reg[i.rs];
     uint32_t rt = cpu->reg[i.rt];
@@ -349,6 +434,7 @@ void op_divu(CPU *cpu, Opcode i) {
 }
 
 // add rd, rs, rt
+template <uint32_t F>
 void op_add(CPU *cpu, Opcode i) {
     uint32_t a = cpu->reg[i.rs];
     uint32_t b = cpu->reg[i.rt];
@@ -358,15 +444,17 @@ void op_add(CPU *cpu, Opcode i) {
         exception(cpu, COP0::CAUSE::Exception::arithmeticOverflow);
         return;
     }
-    cpu->loadAndInvalidate(i.rd, result);
+    cpu->loadAndInvalidate<F>(i.rd, result);
 }
 
 // Add unsigned
 // addu rd, rs, rt
-void op_addu(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rd, cpu->reg[i.rs] + cpu->reg[i.rt]); }
+template <uint32_t F>
+void op_addu(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rd, cpu->reg[i.rs] + cpu->reg[i.rt]); }
 
 // Subtract
 // sub rd, rs, rt
+template <uint32_t F>
 void op_sub(CPU *cpu, Opcode i) {
     uint32_t a = cpu->reg[i.rs];
     uint32_t b = cpu->reg[i.rt];
@@ -376,45 +464,52 @@ void op_sub(CPU *cpu, Opcode i) {
         exception(cpu, COP0::CAUSE::Exception::arithmeticOverflow);
         return;
     }
-    cpu->loadAndInvalidate(i.rd, result);
+    cpu->loadAndInvalidate<F>(i.rd, result);
 }
 
 // Subtract unsigned
 // subu rd, rs, rt
-void op_subu(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rd, cpu->reg[i.rs] - cpu->reg[i.rt]); }
+template <uint32_t F>
+void op_subu(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rd, cpu->reg[i.rs] - cpu->reg[i.rt]); }
 
 // And
 // and rd, rs, rt
-void op_and(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rd, cpu->reg[i.rs] & cpu->reg[i.rt]); }
+template <uint32_t F>
+void op_and(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rd, cpu->reg[i.rs] & cpu->reg[i.rt]); }
 
 // Or
 // OR rd, rs, rt
-void op_or(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rd, cpu->reg[i.rs] | cpu->reg[i.rt]); }
+template <uint32_t F>
+void op_or(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rd, cpu->reg[i.rs] | cpu->reg[i.rt]); }
 
 // Xor
 // XOR rd, rs, rt
-void op_xor(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rd, cpu->reg[i.rs] ^ cpu->reg[i.rt]); }
+template <uint32_t F>
+void op_xor(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rd, cpu->reg[i.rs] ^ cpu->reg[i.rt]); }
 
 // Nor
 // NOR rd, rs, rt
-void op_nor(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rd, ~(cpu->reg[i.rs] | cpu->reg[i.rt])); }
+template <uint32_t F>
+void op_nor(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rd, ~(cpu->reg[i.rs] | cpu->reg[i.rt])); }
 
 // Set On Less Than Signed
 // SLT rd, rs, rt
+template <uint32_t F>
 void op_slt(CPU *cpu, Opcode i) {
     if ((int32_t)cpu->reg[i.rs] < (int32_t)cpu->reg[i.rt])
-        cpu->loadAndInvalidate(i.rd, 1);
+        cpu->loadAndInvalidate<F>(i.rd, 1);
     else
-        cpu->loadAndInvalidate(i.rd, 0);
+        cpu->loadAndInvalidate<F>(i.rd, 0);
 }
 
 // Set On Less Than Unsigned
 // SLTU rd, rs, rt
+template <uint32_t F>
 void op_sltu(CPU *cpu, Opcode i) {
     if (cpu->reg[i.rs] < cpu->reg[i.rt])
-        cpu->loadAndInvalidate(i.rd, 1);
+        cpu->loadAndInvalidate<F>(i.rd, 1);
     else
-        cpu->loadAndInvalidate(i.rd, 0);
+        cpu->loadAndInvalidate<F>(i.rd, 0);
 }
 
 /**
@@ -425,6 +520,7 @@ void op_sltu(CPU *cpu, Opcode i) {
  *
  *  When bits4:1 are equal to 0x10 (and only then!) then return address is saved.
  */
+template <uint32_t F>
 void branch(CPU *cpu, Opcode i) {
     bool greaterAndEqual = i.rt & 0x01;
     bool link = (i.rt & 0x1e) == 0x10;
@@ -450,6 +546,7 @@ void branch(CPU *cpu, Opcode i) {
 
 // Jump
 // J target
+template <uint32_t F>
 void op_j(CPU *cpu, Opcode i) {
     cpu->inBranchDelay = true;
     cpu->jump((cpu->nextPC & 0xf0000000) | (i.target * 4));
@@ -457,6 +554,7 @@ void op_j(CPU *cpu, Opcode i) {
 
 // Jump And Link
 // JAL target
+template <uint32_t F>
 void op_jal(CPU *cpu, Opcode i) {
     cpu->inBranchDelay = true;
     cpu->reg[31] = cpu->nextPC;
@@ -465,6 +563,7 @@ void op_jal(CPU *cpu, Opcode i) {
 
 // Branch On Equal
 // BEQ rs, rt, offset
+template <uint32_t F>
 void op_beq(CPU *cpu, Opcode i) {
     cpu->inBranchDelay = true;
     if (cpu->reg[i.rt] == cpu->reg[i.rs]) {
@@ -474,6 +573,7 @@ void op_beq(CPU *cpu, Opcode i) {
 
 // Branch On Greater Than Zero
 // BGTZ rs, offset
+template <uint32_t F>
 void op_bgtz(CPU *cpu, Opcode i) {
     cpu->inBranchDelay = true;
     if ((int32_t)cpu->reg[i.rs] > 0) {
@@ -483,6 +583,7 @@ void op_bgtz(CPU *cpu, Opcode i) {
 
 // Branch On Less Than Or Equal To Zero
 // BLEZ rs, offset
+template <uint32_t F>
 void op_blez(CPU *cpu, Opcode i) {
     cpu->inBranchDelay = true;
     if ((int32_t)cpu->reg[i.rs] <= 0) {
@@ -492,6 +593,7 @@ void op_blez(CPU *cpu, Opcode i) {
 
 // Branch On Not Equal
 // BNE rs, offset
+template <uint32_t F>
 void op_bne(CPU *cpu, Opcode i) {
     cpu->inBranchDelay = true;
     if (cpu->reg[i.rt] != cpu->reg[i.rs]) {
@@ -501,6 +603,7 @@ void op_bne(CPU *cpu, Opcode i) {
 
 // Add Immediate Word
 // ADDI rt, rs, imm
+template <uint32_t F>
 void op_addi(CPU *cpu, Opcode i) {
     uint32_t a = cpu->reg[i.rs];
     uint32_t b = i.offset;
@@ -510,48 +613,56 @@ void op_addi(CPU *cpu, Opcode i) {
         exception(cpu, COP0::CAUSE::Exception::arithmeticOverflow);
         return;
     }
-    cpu->loadAndInvalidate(i.rt, result);
+    cpu->loadAndInvalidate<F>(i.rt, result);
 }
 
 // Add Immediate Unsigned Word
 // ADDIU rt, rs, imm
-void op_addiu(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rt, cpu->reg[i.rs] + i.offset); }
+template <uint32_t F>
+void op_addiu(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rt, cpu->reg[i.rs] + i.offset); }
 
 // Set On Less Than Immediate
 // SLTI rd, rs, rt
+template <uint32_t F>
 void op_slti(CPU *cpu, Opcode i) {
     if ((int32_t)cpu->reg[i.rs] < (int32_t)i.offset)
-        cpu->loadAndInvalidate(i.rt, 1);
+        cpu->loadAndInvalidate<F>(i.rt, 1);
     else
-        cpu->loadAndInvalidate(i.rt, 0);
+        cpu->loadAndInvalidate<F>(i.rt, 0);
 }
 
 // Set On Less Than Immediate Unsigned
 // SLTIU rd, rs, rt
+template <uint32_t F>
 void op_sltiu(CPU *cpu, Opcode i) {
     if (cpu->reg[i.rs] < (uint32_t)i.offset)
-        cpu->loadAndInvalidate(i.rt, 1);
+        cpu->loadAndInvalidate<F>(i.rt, 1);
     else
-        cpu->loadAndInvalidate(i.rt, 0);
+        cpu->loadAndInvalidate<F>(i.rt, 0);
 }
 
 // And Immediate
 // ANDI rt, rs, imm
-void op_andi(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rt, cpu->reg[i.rs] & i.imm); }
+template <uint32_t F>
+void op_andi(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rt, cpu->reg[i.rs] & i.imm); }
 
 // Or Immediete
 // ORI rt, rs, imm
-void op_ori(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rt, cpu->reg[i.rs] | i.imm); }
+template <uint32_t F>
+void op_ori(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rt, cpu->reg[i.rs] | i.imm); }
 
 // Xor Immediate
 // XORI rt, rs, imm
-void op_xori(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rt, cpu->reg[i.rs] ^ i.imm); }
+template <uint32_t F>
+void op_xori(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rt, cpu->reg[i.rs] ^ i.imm); }
 
 // Load Upper Immediate
 // LUI rt, imm
-void op_lui(CPU *cpu, Opcode i) { cpu->loadAndInvalidate(i.rt, i.imm << 16); }
+template <uint32_t F>
+void op_lui(CPU *cpu, Opcode i) { cpu->loadAndInvalidate<F>(i.rt, i.imm << 16); }
 
 // Coprocessor zero
+template <uint32_t F>
 void op_cop0(CPU *cpu, Opcode i) {
     switch (i.rs) {
         case 0: {
@@ -562,7 +673,7 @@ void op_cop0(CPU *cpu, Opcode i) {
                 exception(cpu, COP0::CAUSE::Exception::reservedInstruction);
                 return;
             }
-            cpu->loadDelaySlot(i.rt, val);
+            cpu->loadDelaySlot<F>(i.rt, val);
             break;
         }
 
@@ -570,12 +681,15 @@ void op_cop0(CPU *cpu, Opcode i) {
             // Move to co-processor zero (from cpu reg)
             // MTC0 rt, cop0.rd
             cpu->cop0.write(i.rd, cpu->reg[i.rt]);
+            if (i.rd == 12) cpu->sys->setCacheIsolation(cpu->cop0.status.isolateCache);
+            cpu->updateInterrupts();
             break;
 
         case 16:
             // Restore from exception
             // RFE
             cpu->cop0.returnFromException();
+            cpu->updateInterrupts();
             break;
 
         default: exception(cpu, COP0::CAUSE::Exception::reservedInstruction); break;
@@ -583,6 +697,7 @@ void op_cop0(CPU *cpu, Opcode i) {
 }
 
 // Coprocessor two
+template <uint32_t F>
 void op_cop2(CPU *cpu, Opcode i) {
     gte::Command command(i.opcode);
     if (i.opcode & (1 << 25)) {
@@ -597,11 +712,11 @@ void op_cop2(CPU *cpu, Opcode i) {
     if (i.rs == 0x00) {
         // Move data from co-processor two
         // MFC2 rt, cop2.<nn>
-        cpu->loadDelaySlot(i.rt, cpu->gte.read(i.rd));
+        cpu->loadDelaySlot<F>(i.rt, cpu->gte.read(i.rd));
     } else if (i.rs == 0x02) {
         // Move control from co-processor two
         // CFC2 rt, cop2.<nn + 32>
-        cpu->loadDelaySlot(i.rt, cpu->gte.read(i.rd + 32));
+        cpu->loadDelaySlot<F>(i.rt, cpu->gte.read(i.rd + 32));
     } else if (i.rs == 0x04) {
         // Move data to co-processor two
         // MTC2 rt, cop2.<nn>
@@ -611,19 +726,21 @@ void op_cop2(CPU *cpu, Opcode i) {
         // CTC2 rt, cop2.<nn + 32>
         cpu->gte.write(i.rd + 32, cpu->reg[i.rt]);
     } else {
-        invalid(cpu, i);
+        invalid<F>(cpu, i);
     }
 }
 
 // Load Byte
 // LB rt, offset(base)
+template <uint32_t F>
 void op_lb(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs] + i.offset;
-    cpu->loadDelaySlot(i.rt, ((int32_t)(cpu->sys->readMemory8(addr) << 24)) >> 24);
+    cpu->loadDelaySlot<F>(i.rt, ((int32_t)(readMemory<F, uint8_t>(cpu, addr) << 24)) >> 24);
 }
 
 // Load Halfword
 // LH rt, offset(base)
+template <uint32_t F>
 void op_lh(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs] + i.offset;
     if (unlikely(addr & 1)) {
@@ -631,14 +748,15 @@ void op_lh(CPU *cpu, Opcode i) {
         exception(cpu, COP0::CAUSE::Exception::addressErrorLoad);
         return;
     }
-    cpu->loadDelaySlot(i.rt, (int32_t)(int16_t)cpu->sys->readMemory16(addr));
+    cpu->loadDelaySlot<F>(i.rt, (int32_t)(int16_t)readMemory<F, uint16_t>(cpu, addr));
 }
 
 // Load Word Left
 // LWL rt, offset(base)
+template <uint32_t F>
 void op_lwl(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs] + i.offset;
-    uint32_t mem = cpu->sys->readMemory32(addr & 0xfffffffc);
+    uint32_t mem = readMemory<F, uint32_t>(cpu, addr & 0xfffffffc);
 
     uint32_t reg;
     if (cpu->slots[0].reg == i.rt) {
@@ -654,11 +772,12 @@ void op_lwl(CPU *cpu, Opcode i) {
         case 2: result = (reg & 0x000000ff) | (mem << 8); break;
         case 3: result = (reg & 0x00000000) | (mem); break;
     }
-    cpu->loadDelaySlot(i.rt, result);
+    cpu->loadDelaySlot<F>(i.rt, result);
 }
 
 // Load Word
 // LW rt, offset(base)
+template <uint32_t F>
 void op_lw(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs] + i.offset;
     if (unlikely(addr & 3)) {
@@ -666,18 +785,20 @@ void op_lw(CPU *cpu, Opcode i) {
         exception(cpu, COP0::CAUSE::Exception::addressErrorLoad);
         return;
     }
-    cpu->loadDelaySlot(i.rt, cpu->sys->readMemory32(addr));
+    cpu->loadDelaySlot<F>(i.rt, readMemory<F, uint32_t>(cpu, addr));
 }
 
 // Load Byte Unsigned
 // LBU rt, offset(base)
+template <uint32_t F>
 void op_lbu(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs] + i.offset;
-    cpu->loadDelaySlot(i.rt, cpu->sys->readMemory8(addr));
+    cpu->loadDelaySlot<F>(i.rt, readMemory<F, uint8_t>(cpu, addr));
 }
 
 // Load Halfword Unsigned
 // LHU rt, offset(base)
+template <uint32_t F>
 void op_lhu(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs] + i.offset;
     if (unlikely(addr & 1)) {
@@ -685,15 +806,16 @@ void op_lhu(CPU *cpu, Opcode i) {
         exception(cpu, COP0::CAUSE::Exception::addressErrorLoad);
         return;
     }
-    cpu->loadDelaySlot(i.rt, cpu->sys->readMemory16(addr));
+    cpu->loadDelaySlot<F>(i.rt, readMemory<F, uint16_t>(cpu, addr));
 }
 
 // Load Word Right
 // LWR rt, offset(base)
+template <uint32_t F>
 void op_lwr(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs] + i.offset;
 
-    uint32_t mem = cpu->sys->readMemory32(addr & 0xfffffffc);
+    uint32_t mem = readMemory<F, uint32_t>(cpu, addr & 0xfffffffc);
 
     uint32_t reg;
     if (cpu->slots[0].reg == i.rt) {
@@ -709,18 +831,20 @@ void op_lwr(CPU *cpu, Opcode i) {
         case 2: result = (reg & 0xffff0000) | (mem >> 16); break;
         case 3: result = (reg & 0xffffff00) | (mem >> 24); break;
     }
-    cpu->loadDelaySlot(i.rt, result);
+    cpu->loadDelaySlot<F>(i.rt, result);
 }
 
 // Store Byte
 // SB rt, offset(base)
+template <uint32_t F>
 void op_sb(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs] + i.offset;
-    cpu->sys->writeMemory8(addr, cpu->reg[i.rt]);
+    writeMemory<F, uint8_t>(cpu, addr, cpu->reg[i.rt]);
 }
 
 // Store Halfword
 // SH rt, offset(base)
+template <uint32_t F>
 void op_sh(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs] + i.offset;
     if (unlikely(addr & 1)) {
@@ -728,14 +852,15 @@ void op_sh(CPU *cpu, Opcode i) {
         exception(cpu, COP0::CAUSE::Exception::addressErrorStore);
         return;
     }
-    cpu->sys->writeMemory16(addr, cpu->reg[i.rt]);
+    writeMemory<F, uint16_t>(cpu, addr, cpu->reg[i.rt]);
 }
 
 // Store Word Left
 // SWL rt, offset(base)
+template <uint32_t F>
 void op_swl(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs] + i.offset;
-    uint32_t mem = cpu->sys->readMemory32(addr & 0xfffffffc);
+    uint32_t mem = readMemory<F, uint32_t>(cpu, addr & 0xfffffffc);
     uint32_t reg = cpu->reg[i.rt];
 
     uint32_t result = 0;
@@ -745,11 +870,12 @@ void op_swl(CPU *cpu, Opcode i) {
         case 2: result = (mem & 0xff000000) | (reg >> 8); break;
         case 3: result = (mem & 0x00000000) | (reg); break;
     }
-    cpu->sys->writeMemory32(addr & 0xfffffffc, result);
+    writeMemory<F, uint32_t>(cpu, addr & 0xfffffffc, result);
 }
 
 // Store Word
 // SW rt, offset(base)
+template <uint32_t F>
 void op_sw(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs] + i.offset;
     if (unlikely(addr & 3)) {
@@ -757,14 +883,15 @@ void op_sw(CPU *cpu, Opcode i) {
         exception(cpu, COP0::CAUSE::Exception::addressErrorStore);
         return;
     }
-    cpu->sys->writeMemory32(addr, cpu->reg[i.rt]);
+    writeMemory<F, uint32_t>(cpu, addr, cpu->reg[i.rt]);
 }
 
 // Store Word Right
 // SWR rt, offset(base)
+template <uint32_t F>
 void op_swr(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs] + i.offset;
-    uint32_t mem = cpu->sys->readMemory32(addr & 0xfffffffc);
+    uint32_t mem = readMemory<F, uint32_t>(cpu, addr & 0xfffffffc);
     uint32_t reg = cpu->reg[i.rt];
 
     uint32_t result = 0;
@@ -774,32 +901,107 @@ void op_swr(CPU *cpu, Opcode i) {
         case 2: result = (reg << 16) | (mem & 0x0000ffff); break;
         case 3: result = (reg << 24) | (mem & 0x00ffffff); break;
     }
-    cpu->sys->writeMemory32(addr & 0xfffffffc, result);
+    writeMemory<F, uint32_t>(cpu, addr & 0xfffffffc, result);
 }
 
 // Load to coprocessor 2
 // LWC2 ??? ???
+template <uint32_t F>
 void op_lwc2(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs] + i.offset;
 
     assert(i.rt < 64);
-    auto data = cpu->sys->readMemory32(addr);
+    auto data = readMemory<F, uint32_t>(cpu, addr);
     cpu->gte.write(i.rt, data);
 }
 
 // Store from coprocessor 2
 // SWC2 ??? ???
+template <uint32_t F>
 void op_swc2(CPU *cpu, Opcode i) {
     uint32_t addr = cpu->reg[i.rs] + i.offset;
     assert(i.rt < 64);
     auto gteRead = cpu->gte.read(i.rt);
-    cpu->sys->writeMemory32(addr, gteRead);
+    writeMemory<F, uint32_t>(cpu, addr, gteRead);
 }
 
 // BREAKPOINT
+template <uint32_t F>
 void op_breakpoint(CPU *cpu, Opcode i) {
     UNUSED(i);
     cpu->sys->state = System::State::halted;
+    cpu->attention = true;
+    cpu->setPC(cpu->nextPC);
+}
+
+namespace {
+// Fetches next instruction, returns false when interpreter loop should exit
+template <uint32_t F>
+INLINE bool fetch(CPU *cpu, int &count) {
+    if (count-- <= 0 || cpu->sliceExecuted >= cpu->sliceLength) return false;
+    if (unlikely(cpu->attention) && !cpu->handleAttention()) return false;
+    if constexpr ((F & Feature::BREAKPOINTS) != 0) {
+        if (cpu->handleBreakpoints()) return false;
+    }
+
+    cpu->saveStateForException();
+    cpu->_opcode = Opcode(cpu->sys->readMemory32(cpu->PC));
     cpu->setPC(cpu->nextPC);
+    return true;
+}
+
+// Handler is resolved at compile time, so it is called directly (and might be inlined)
+template <uint32_t F, uint32_t index>
+INLINE void execute(CPU *cpu) {
+    constexpr _Instruction handler = HandlerTable<F>[index];
+    handler(cpu, cpu->_opcode);
+    cpu->moveLoadDelaySlots<F>();
+    cpu->sliceExecuted++;
+}
+
+// Expands X(index) for every handler index
+// clang-format off
+#define HANDLER_ROW(X, h) \
+    X(0x##h##0) X(0x##h##1) X(0x##h##2) X(0x##h##3) X(0x##h##4) X(0x##h##5) X(0x##h##6) X(0x##h##7) \
+    X(0x##h##8) X(0x##h##9) X(0x##h##a) X(0x##h##b) X(0x##h##c) X(0x##h##d) X(0x##h##e) X(0x##h##f)
+#define HANDLERS(X) \
+    HANDLER_ROW(X, 0) HANDLER_ROW(X, 1) HANDLER_ROW(X, 2) HANDLER_ROW(X, 3) \
+    HANDLER_ROW(X, 4) HANDLER_ROW(X, 5) HANDLER_ROW(X, 6) HANDLER_ROW(X, 7)
+// clang-format on
+
+// Threaded code - every handler ends with its own indirect jump to the next one,
+// which is easier to predict than single shared dispatch branch.
+// Compilers without computed goto (MSVC) use switch, which is still a single jump table lookup.
+template <uint32_t F>
+bool interpret(CPU *cpu, int count) {
+#if defined(__GNUC__)
+#define DISPATCH()                                                           \
+    if (!fetch<F>(cpu, count)) return cpu->sys->state == System::State::run; \
+    goto *labels[handlerIndex(cpu->_opcode)]
+#define HANDLER_LABEL(n) &&handler_##n,
+#define HANDLER(n)                    \
+    handler_##n : execute<F, n>(cpu); \
+    DISPATCH();
+
+    static const void *const labels[HANDLER_COUNT] = {HANDLERS(HANDLER_LABEL)};
+
+    DISPATCH();
+    HANDLERS(HANDLER)
+#undef DISPATCH
+#undef HANDLER_LABEL
+#undef HANDLER
+#else
+#define HANDLER(n) \
+    case n: execute<F, n>(cpu); break;
+
+    while (fetch<F>(cpu, count)) {
+        switch (handlerIndex(cpu->_opcode)) { HANDLERS(HANDLER) }
+    }
+    return cpu->sys->state == System::State::run;
+#undef HANDLER
+#endif
 }
+#undef HANDLERS
+#undef HANDLER_ROW
+};  // namespace
 };  // namespace instructions
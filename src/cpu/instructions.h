@@ -15,73 +15,147 @@ struct PrimaryInstruction {
 
 void exception(CPU* cpu, COP0::CAUSE::Exception cause);
 
+// Flat decode: primary opcodes map to 0 - 63, SPECIAL (opcode 0) instructions to 64 + function field
+const int HANDLER_COUNT = 128;
+inline uint32_t handlerIndex(Opcode i) { return i.op != 0 ? i.op : 64 + i.fun; }
+
+// Handlers are instantiated for every combination of mips::Feature flags (F)
+const std::array<_Instruction, HANDLER_COUNT>& getHandlerTable(uint32_t features);
+// Resolves handler of given opcode, including SPECIAL instructions
+_Instruction decode(uint32_t features, Opcode i);
+
+// Interpreter loop, runs up to count instructions (or until end of CPU slice)
+typedef bool (*Interpreter)(CPU*, int);
+Interpreter getInterpreter(uint32_t features);
+
+template <uint32_t F>
 void dummy(CPU* cpu, Opcode i);
+template <uint32_t F>
 void invalid(CPU* cpu, Opcode i);
+template <uint32_t F>
 void notImplemented(CPU* cpu, Opcode i);
+template <uint32_t F>
 void special(CPU* cpu, Opcode i);
+template <uint32_t F>
 void branch(CPU* cpu, Opcode i);
 
+template <uint32_t F>
 void op_sll(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_srl(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_sra(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_sllv(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_srlv(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_srav(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_jr(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_jalr(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_syscall(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_break(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_mfhi(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_mthi(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_mflo(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_mtlo(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_mult(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_multu(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_div(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_divu(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_add(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_addu(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_sub(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_subu(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_and(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_or(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_xor(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_nor(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_slt(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_sltu(CPU* cpu, Opcode i);
 
+template <uint32_t F>
 void op_j(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_jal(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_beq(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_bgtz(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_blez(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_bne(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_addi(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_addiu(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_slti(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_sltiu(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_andi(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_ori(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_xori(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_lui(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_cop0(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_cop2(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_lb(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_lh(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_lwl(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_lw(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_lbu(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_lhu(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_lwr(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_sb(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_sh(CPU* cpu, Opcode i);
-void op_sh(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_swl(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_sw(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_swr(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_lwc2(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_swc2(CPU* cpu, Opcode i);
+template <uint32_t F>
 void op_breakpoint(CPU* cpu, Opcode i);
-
-extern std::array<PrimaryInstruction, 64> OpcodeTable;
 }  // namespace instructions
@@ -0,0 +1,33 @@
+#include "code_buffer.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace mips::jit {
+CodeBuffer::CodeBuffer(size_t size) {
+#ifdef _WIN32
+    void* ptr = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+    if (ptr == nullptr) return;
+#else
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_JIT
+    flags |= MAP_JIT;
+#endif
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, flags, -1, 0);
+    if (ptr == MAP_FAILED) return;
+#endif
+    base = static_cast<uint8_t*>(ptr);
+    this->size = size;
+}
+
+CodeBuffer::~CodeBuffer() {
+    if (base == nullptr) return;
+#ifdef _WIN32
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    munmap(base, size);
+#endif
+}
+};  // namespace mips::jit
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace mips::jit {
+// Executable memory for generated code, allocated once and filled linearly
+class CodeBuffer {
+   public:
+    CodeBuffer(size_t size);
+    ~CodeBuffer();
+
+    bool isValid() const { return base != nullptr; }
+    uint8_t* getCurrent() const { return base + used; }
+    size_t getFree() const { return size - used; }
+    void commit(size_t bytes) { used += bytes; }
+    void reset() { used = 0; }
+
+   private:
+    uint8_t* base = nullptr;
+    size_t size = 0;
+    size_t used = 0;
+};
+};  // namespace mips::jit
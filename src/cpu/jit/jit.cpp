@@ -0,0 +1,257 @@
+#include "jit.h"
+#include <vector>
+#include "code_buffer.h"
+#include "cpu/cpu.h"
+#include "system.h"
+#include "x64_emitter.h"
+
+namespace mips::jit {
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_AVAILABLE
+#endif
+
+namespace {
+const size_t CODE_BUFFER_SIZE = 32 * 1024 * 1024;
+
+void moveLoadDelaySlots(CPU* cpu) { cpu->moveLoadDelaySlots<Feature::LOAD_DELAY_SLOTS>(); }
+
+// Offsets of CPU fields relative to rbx
+struct Layout {
+    CPU* cpu;
+    int32_t operator()(const void* field) const {
+        return static_cast<int32_t>(reinterpret_cast<const uint8_t*>(field) - reinterpret_cast<const uint8_t*>(cpu));
+    }
+    int32_t reg(int r) const { return (*this)(&cpu->reg[r]); }
+};
+
+// Clear pending load of register r, equivalent of CPU::invalidateSlot
+void emitInvalidateSlot(Emitter& e, const Layout& at, int r) {
+    Emitter::Label skip;
+    e.loadReg(EAX, at(&at.cpu->slots[0]));
+    e.aluImm(ALU_AND, EAX, 31);
+    e.aluImm(ALU_CMP, EAX, r);
+    e.jcc(CC_NE, skip);
+    e.aluMemImm(ALU_AND, at(&at.cpu->slots[0]), ~31u);
+    e.bind(skip);
+}
+
+// Emits instructions without side effects other than register writes, returns false for anything else
+bool emitNative(Emitter& e, const Layout& at, Opcode i, bool invalidate) {
+    int target = -1;  // Register written with loadAndInvalidate
+
+    auto aluReg = [&](AluOp op) {
+        e.loadReg(EAX, at.reg(i.rs));
+        e.aluMem(op, EAX, at.reg(i.rt));
+        target = i.rd;
+    };
+    auto shiftImm = [&](ShiftOp op) {
+        e.loadReg(EAX, at.reg(i.rt));
+        if (i.sh != 0) e.shiftImm(op, EAX, i.sh);
+        target = i.rd;
+    };
+    auto shiftReg = [&](ShiftOp op) {
+        e.loadReg(ECX, at.reg(i.rs));
+        e.loadReg(EAX, at.reg(i.rt));
+        e.shiftCl(op, EAX);
+        target = i.rd;
+    };
+    auto compare = [&](Condition cc, bool immediate) {
+        e.loadReg(EAX, at.reg(i.rs));
+        if (immediate) {
+            e.aluImm(ALU_CMP, EAX, static_cast<uint32_t>(static_cast<int32_t>(i.offset)));
+        } else {
+            e.aluMem(ALU_CMP, EAX, at.reg(i.rt));
+        }
+        e.setccEax(cc);
+        target = immediate ? i.rt : i.rd;
+    };
+    auto aluImm = [&](AluOp op, uint32_t imm) {
+        e.loadReg(EAX, at.reg(i.rs));
+        e.aluImm(op, EAX, imm);
+        target = i.rt;
+    };
+
+    if (i.op == 0) {
+        switch (i.fun) {
+            case 0: shiftImm(SHIFT_SHL); break;   // sll
+            case 2: shiftImm(SHIFT_SHR); break;   // srl
+            case 3: shiftImm(SHIFT_SAR); break;   // sra
+            case 4: shiftReg(SHIFT_SHL); break;   // sllv
+            case 6: shiftReg(SHIFT_SHR); break;   // srlv
+            case 7: shiftReg(SHIFT_SAR); break;   // srav
+            case 33: aluReg(ALU_ADD); break;      // addu
+            case 35: aluReg(ALU_SUB); break;      // subu
+            case 36: aluReg(ALU_AND); break;      // and
+            case 37: aluReg(ALU_OR); break;       // or
+            case 38: aluReg(ALU_XOR); break;      // xor
+            case 42: compare(CC_L, false); break;  // slt
+            case 43: compare(CC_B, false); break;  // sltu
+            case 39:                               // nor
+                aluReg(ALU_OR);
+                e.notReg(EAX);
+                break;
+            case 16:  // mfhi
+            case 18:  // mflo
+                e.loadReg(EAX, at(i.fun == 16 ? &at.cpu->hi : &at.cpu->lo));
+                target = i.rd;
+                break;
+            case 17:  // mthi
+            case 19:  // mtlo
+                e.loadReg(EAX, at.reg(i.rs));
+                e.storeReg(at(i.fun == 17 ? &at.cpu->hi : &at.cpu->lo), EAX);
+                return true;
+            default: return false;
+        }
+    } else {
+        switch (i.op) {
+            case 9: aluImm(ALU_ADD, static_cast<uint32_t>(static_cast<int32_t>(i.offset))); break;  // addiu
+            case 10: compare(CC_L, true); break;                                                    // slti
+            case 11: compare(CC_B, true); break;                                                    // sltiu
+            case 12: aluImm(ALU_AND, i.imm); break;                                                 // andi
+            case 13: aluImm(ALU_OR, i.imm); break;                                                  // ori
+            case 14: aluImm(ALU_XOR, i.imm); break;                                                 // xori
+            case 15:                                                                                // lui
+                if (i.rt == 0) return true;
+                e.storeImm(at.reg(i.rt), i.imm << 16);
+                if (invalidate) emitInvalidateSlot(e, at, i.rt);
+                return true;
+            default: return false;
+        }
+    }
+
+    // loadAndInvalidate ignores writes to r0 - computed value is dropped
+    if (target == 0) return true;
+    e.storeReg(at.reg(target), EAX);
+    if (invalidate) emitInvalidateSlot(e, at, target);
+    return true;
+}
+};  // namespace
+
+Recompiler::Recompiler(CPU* cpu) : cpu(cpu) {
+#ifdef JIT_AVAILABLE
+    buffer = std::make_unique<CodeBuffer>(CODE_BUFFER_SIZE);
+#endif
+}
+
+Recompiler::~Recompiler() = default;
+
+bool Recompiler::isAvailable() const { return buffer && buffer->isValid(); }
+
+void Recompiler::reset() {
+    if (buffer) buffer->reset();
+}
+
+bool Recompiler::compile(Block* block, uint32_t address) {
+#ifdef JIT_AVAILABLE
+    const Layout at{cpu};
+    const auto& instructions = block->instructions;
+    const int count = static_cast<int>(instructions.size());
+    // Handlers were resolved for the same features (BlockCache is flushed when they change)
+    const bool loadDelaySlots = (cpu->enabledFeatures & Feature::LOAD_DELAY_SLOTS) != 0;
+
+    // Instructions that are emitted inline and can't raise exceptions
+    std::vector<bool> native(count);
+    for (int n = 0; n < count; n++) {
+        Emitter scratch;
+        native[n] = emitNative(scratch, at, instructions[n].opcode, false);
+    }
+
+    Emitter e;
+    Emitter::Label end;
+    std::vector<Emitter::Label> exits(count + 1);  // exits[n] - leave block with n instructions executed
+
+    e.prologue();
+
+    for (int n = 0; n < count; n++) {
+        const Opcode i = instructions[n].opcode;
+        const uint32_t pc = address + n * 4;
+
+        // State that is known only at block entry or after a jump
+        const bool dynamic = n == 0 || Block::isBranch(instructions[n - 1].opcode);
+        // Load delay slots might be occupied
+        const bool pendingLoad = loadDelaySlots && (n == 0 || Block::isLoad(instructions[n - 1].opcode));
+
+        // saveStateForException
+        if (dynamic) {
+            if (n == 0) {
+                e.loadReg(EAX, at(&cpu->PC));
+                e.storeReg(at(&cpu->exceptionPC), EAX);
+            } else {
+                e.storeImm(at(&cpu->exceptionPC), pc);
+            }
+            e.loadByte(EAX, at(&cpu->inBranchDelay));
+            e.storeByte(at(&cpu->exceptionIsInBranchDelay), EAX);
+            e.loadByte(EAX, at(&cpu->branchTaken));
+            e.storeByte(at(&cpu->exceptionIsBranchTaken), EAX);
+            e.storeImmByte(at(&cpu->inBranchDelay), 0);
+            e.storeImmByte(at(&cpu->branchTaken), 0);
+        } else {
+            e.storeImm(at(&cpu->exceptionPC), pc);
+            e.storeImmByte(at(&cpu->exceptionIsInBranchDelay), 0);
+            e.storeImmByte(at(&cpu->exceptionIsBranchTaken), 0);
+        }
+
+        e.storeImm(at(&cpu->_opcode), i.opcode);
+
+        // setPC(nextPC)
+        if (dynamic) {
+            e.loadReg(EAX, at(&cpu->nextPC));
+            e.storeReg(at(&cpu->PC), EAX);
+            e.aluImm(ALU_ADD, EAX, 4);
+            e.storeReg(at(&cpu->nextPC), EAX);
+        } else {
+            e.storeImm(at(&cpu->PC), pc + 4);
+            e.storeImm(at(&cpu->nextPC), pc + 8);
+        }
+
+        if (!native[n]) {
+            e.movArgCpu();
+            e.movArg2Imm(i.opcode);
+            e.call(reinterpret_cast<const void*>(instructions[n].handler));
+        } else {
+            emitNative(e, at, i, pendingLoad);
+        }
+
+        if (pendingLoad || (loadDelaySlots && Block::isLoad(i))) {
+            e.movArgCpu();
+            e.call(reinterpret_cast<const void*>(&moveLoadDelaySlots));
+        }
+
+        // Interrupt, state change or code modification (only handlers can request attention)
+        if (!native[n]) {
+            e.testMemByte(at(&cpu->attention), 1);
+            e.jcc(CC_NE, exits[n + 1]);
+        }
+
+        // Exception or jump (block entered in a delay slot)
+        if (!native[n] || dynamic) {
+            e.aluMemImm(ALU_CMP, at(&cpu->PC), pc + 4);
+            e.jcc(CC_NE, exits[n + 1]);
+        }
+    }
+
+    e.movImm(EAX, count);
+    e.bind(end);
+    e.epilogue();
+
+    for (int n = 0; n <= count; n++) {
+        if (exits[n].fixups.empty()) continue;
+        e.bind(exits[n]);
+        e.movImm(EAX, n);
+        e.jmp(end);
+    }
+
+    if (e.size() > buffer->getFree()) return false;
+
+    e.copyTo(buffer->getCurrent());
+    block->code = buffer->getCurrent();
+    block->codeAddress = address;
+    buffer->commit(e.size());
+    return true;
+#else
+    UNUSED(block);
+    UNUSED(address);
+    return false;
+#endif
+}
+};  // namespace mips::jit
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include "cpu/block_cache.h"
+
+namespace mips {
+struct CPU;
+};
+
+namespace mips::jit {
+class CodeBuffer;
+
+// Returns number of guest instructions executed
+typedef int (*BlockFunction)(CPU* cpu);
+
+/**
+ * x86-64 dynamic recompiler.
+ * Translates blocks from BlockCache into native code with exactly the same
+ * semantics as cached interpreter (exceptions, interrupts and delay slots).
+ * Simple ALU instructions are emitted inline, everything else (memory access,
+ * branches, COP0, GTE) calls interpreter handlers.
+ */
+class Recompiler {
+   public:
+    Recompiler(CPU* cpu);
+    ~Recompiler();
+
+    // Host is x86-64 and executable memory was allocated
+    bool isAvailable() const;
+
+    // Compile block for given virtual address, fails if code buffer is full
+    bool compile(Block* block, uint32_t address);
+
+    // Drop all generated code, blocks that reference it must be flushed first
+    void reset();
+
+   private:
+    CPU* cpu;
+    std::unique_ptr<CodeBuffer> buffer;
+};
+};  // namespace mips::jit
@@ -0,0 +1,185 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+namespace mips::jit {
+enum Reg32 { EAX = 0, ECX = 1, EDX = 2, EBX = 3, ESP = 4, EBP = 5, ESI = 6, EDI = 7 };
+enum Condition { CC_B = 0x2, CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC };
+enum AluOp { ALU_ADD = 0, ALU_OR = 1, ALU_AND = 4, ALU_SUB = 5, ALU_XOR = 6, ALU_CMP = 7 };
+enum ShiftOp { SHIFT_SHL = 4, SHIFT_SHR = 5, SHIFT_SAR = 7 };
+
+/**
+ * Minimal x86-64 encoder for the subset of instructions used by the recompiler.
+ * All memory operands are [rbx + disp32], rbx holds CPU* during block execution.
+ */
+class Emitter {
+   public:
+    struct Label {
+        std::vector<size_t> fixups;
+        size_t position = SIZE_MAX;
+    };
+
+    std::vector<uint8_t> code;
+
+    size_t size() const { return code.size(); }
+
+    // Jumps are relative to each other and calls use absolute addresses, so code can be moved as is
+    void copyTo(uint8_t* dst) const { memcpy(dst, code.data(), code.size()); }
+
+    void bind(Label& label) {
+        label.position = code.size();
+        for (size_t fixup : label.fixups) patch32(fixup, static_cast<uint32_t>(label.position - (fixup + 4)));
+        label.fixups.clear();
+    }
+
+    // mov r32, [rbx + disp]
+    void loadReg(Reg32 r, int32_t disp) { memOp(0x8B, r, disp); }
+    // mov [rbx + disp], r32
+    void storeReg(int32_t disp, Reg32 r) { memOp(0x89, r, disp); }
+    // mov r8, [rbx + disp]
+    void loadByte(Reg32 r, int32_t disp) { memOp(0x8A, r, disp); }
+    // mov [rbx + disp], r8
+    void storeByte(int32_t disp, Reg32 r) { memOp(0x88, r, disp); }
+    // mov dword [rbx + disp], imm32
+    void storeImm(int32_t disp, uint32_t imm) {
+        memOp(0xC7, 0, disp);
+        emit32(imm);
+    }
+    // mov byte [rbx + disp], imm8
+    void storeImmByte(int32_t disp, uint8_t imm) {
+        memOp(0xC6, 0, disp);
+        emit8(imm);
+    }
+    // op r32, [rbx + disp]
+    void aluMem(AluOp op, Reg32 r, int32_t disp) { memOp(static_cast<uint8_t>(op * 8 + 3), r, disp); }
+    // op r32, imm32
+    void aluImm(AluOp op, Reg32 r, uint32_t imm) {
+        emit8(0x81);
+        emit8(0xC0 | (op << 3) | r);
+        emit32(imm);
+    }
+    // op dword [rbx + disp], imm32
+    void aluMemImm(AluOp op, int32_t disp, uint32_t imm) {
+        memOp(0x81, op, disp);
+        emit32(imm);
+    }
+    // test byte [rbx + disp], imm8
+    void testMemByte(int32_t disp, uint8_t imm) {
+        memOp(0xF6, 0, disp);
+        emit8(imm);
+    }
+    // not r32
+    void notReg(Reg32 r) {
+        emit8(0xF7);
+        emit8(0xD0 | r);
+    }
+    // shl/shr/sar r32, imm8
+    void shiftImm(ShiftOp op, Reg32 r, uint8_t imm) {
+        emit8(0xC1);
+        emit8(0xC0 | (op << 3) | r);
+        emit8(imm);
+    }
+    // shl/shr/sar r32, cl
+    void shiftCl(ShiftOp op, Reg32 r) {
+        emit8(0xD3);
+        emit8(0xC0 | (op << 3) | r);
+    }
+    // setcc al; movzx eax, al
+    void setccEax(Condition cc) {
+        emit8(0x0F);
+        emit8(0x90 | cc);
+        emit8(0xC0);
+        emit8(0x0F);
+        emit8(0xB6);
+        emit8(0xC0);
+    }
+    // mov r32, imm32
+    void movImm(Reg32 r, uint32_t imm) {
+        emit8(0xB8 | r);
+        emit32(imm);
+    }
+    // mov rax, imm64
+    void movRaxImm64(uint64_t imm) {
+        emit8(0x48);
+        emit8(0xB8);
+        emit64(imm);
+    }
+    // mov r64, rbx (first argument register)
+    void movArgCpu() {
+#ifdef _WIN32
+        emit({0x48, 0x89, 0xD9});  // mov rcx, rbx
+#else
+        emit({0x48, 0x89, 0xDF});  // mov rdi, rbx
+#endif
+    }
+    // mov r32, imm32 (second argument register)
+    void movArg2Imm(uint32_t imm) {
+#ifdef _WIN32
+        movImm(EDX, imm);
+#else
+        movImm(ESI, imm);
+#endif
+    }
+    // mov rax, imm64; call rax
+    void call(const void* function) {
+        movRaxImm64(reinterpret_cast<uint64_t>(function));
+        emit8(0xFF);
+        emit8(0xD0);
+    }
+    void jcc(Condition cc, Label& label) {
+        emit8(0x0F);
+        emit8(0x80 | cc);
+        emitLabel(label);
+    }
+    void jmp(Label& label) {
+        emit8(0xE9);
+        emitLabel(label);
+    }
+
+    void prologue() {
+        emit8(0x53);  // push rbx
+#ifdef _WIN32
+        emit({0x48, 0x83, 0xEC, 0x20});  // sub rsp, 32 (shadow space)
+        emit({0x48, 0x89, 0xCB});        // mov rbx, rcx
+#else
+        emit({0x48, 0x89, 0xFB});  // mov rbx, rdi
+#endif
+    }
+    void epilogue() {
+#ifdef _WIN32
+        emit({0x48, 0x83, 0xC4, 0x20});  // add rsp, 32
+#endif
+        emit8(0x5B);  // pop rbx
+        emit8(0xC3);  // ret
+    }
+
+   private:
+    void emit8(uint8_t v) { code.push_back(v); }
+    void emit(std::initializer_list<uint8_t> bytes) { code.insert(code.end(), bytes); }
+    void emit32(uint32_t v) {
+        for (int i = 0; i < 4; i++) emit8(static_cast<uint8_t>(v >> (i * 8)));
+    }
+    void emit64(uint64_t v) {
+        for (int i = 0; i < 8; i++) emit8(static_cast<uint8_t>(v >> (i * 8)));
+    }
+    void patch32(size_t at, uint32_t v) {
+        for (int i = 0; i < 4; i++) code[at + i] = static_cast<uint8_t>(v >> (i * 8));
+    }
+    // opcode, ModRM with mod=10 (disp32), rm=rbx
+    void memOp(uint8_t opcode, int reg, int32_t disp) {
+        emit8(opcode);
+        emit8(0x80 | (reg << 3) | EBX);
+        emit32(static_cast<uint32_t>(disp));
+    }
+    void emitLabel(Label& label) {
+        if (label.position != SIZE_MAX) {
+            emit32(static_cast<uint32_t>(label.position - (code.size() + 4)));
+        } else {
+            label.fixups.push_back(code.size());
+            emit32(0);
+        }
+    }
+};
+};  // namespace mips::jit
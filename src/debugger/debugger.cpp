@@ -208,6 +208,12 @@ Instruction decodeInstruction(mips::Opcode& i) {
             O(17, "cop1", "");
 
         case 18:
+            // GTE command
+            if (i.opcode & (1 << 25)) {
+                ins.mnemonic = std::string("cop2");
+                ins.parameters = string_format("0x%07x", i.opcode & 0x1ffffff);
+                break;
+            }
             switch (i.rs) {
                 O(0, "mfc2", string_format("%s, %s", R(i.rt), cop2reg(i.rd).c_str()));
                 O(2, "cfc2", string_format("%s, %s", R(i.rt), cop2reg(i.rd + 32).c_str()));
@@ -13,8 +13,19 @@ namespace device {
 namespace cdrom {
 
 CDROM::CDROM(System* sys) : sys(sys) {
-    verbose = config["debug"]["log"]["cdrom"];
+    verbose = sys->config["debug"]["log"]["cdrom"];
     disc = std::make_unique<disc::Empty>();
+
+    interruptEvent = sys->scheduler->addEvent("cdrom interrupt", [this] { step(); });
+    sectorEvent = sys->scheduler->addEvent("cdrom sector", [this] {
+        stepSector();
+        this->sys->scheduler->reschedule(sectorEvent, System::SYSTEM_CLOCK / (mode.speed ? 150 : 75));
+    });
+    sys->scheduler->schedule(sectorEvent, System::SYSTEM_CLOCK / 75);
+}
+
+void CDROM::scheduleInterrupt() {
+    if (!sys->scheduler->isScheduled(interruptEvent)) sys->scheduler->schedule(interruptEvent, INTERRUPT_DELAY);
 }
 
 void CDROM::step() {
@@ -24,121 +35,121 @@ void CDROM::step() {
             sys->interrupt->trigger(interrupt::CDROM);
         }
     }
+}
 
-    static int readcnt = 0;
-    if ((stat.read || stat.play) && readcnt++ == 1150) {  // FIXME: yey, magic numbers
-        readcnt = 0;
-        const std::array<uint8_t, 12> sync = {{0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00}};
+void CDROM::stepSector() {
+    if (!stat.read && !stat.play) return;
 
-        auto pos = disc::Position::fromLba(readSector);
-        std::tie(rawSector, trackType) = disc->read(pos);
-        readSector++;
+    const std::array<uint8_t, 12> sync = {{0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00}};
 
-        if (trackType == disc::TrackType::AUDIO && stat.play) {
-            if (!mode.cddaEnable) {
-                return;
-            }
+    auto pos = disc::Position::fromLba(readSector);
+    std::tie(rawSector, trackType) = disc->read(pos);
+    readSector++;
 
-            if (memcmp(rawSector.data(), sync.data(), sync.size()) == 0) {
-                printf("[CDROM] Trying to read Data track as audio\n");
-                return;
-            }
+    if (trackType == disc::TrackType::AUDIO && stat.play) {
+        if (!mode.cddaEnable) {
+            return;
+        }
 
-            if (mode.cddaReport) {
-                // Report--> INT1(stat, track, index, mm / amm, ss + 80h / ass, sect / asect, peaklo, peakhi)
-                auto pos = disc::Position::fromLba(readSector);
+        if (memcmp(rawSector.data(), sync.data(), sync.size()) == 0) {
+            printf("[CDROM] Trying to read Data track as audio\n");
+            return;
+        }
 
-                int track = disc->getTrackByPosition(pos);
+        if (mode.cddaReport) {
+            // Report--> INT1(stat, track, index, mm / amm, ss + 80h / ass, sect / asect, peaklo, peakhi)
+            auto pos = disc::Position::fromLba(readSector);
 
-                postInterrupt(1);
-                writeResponse(stat._reg);           // stat
-                writeResponse(bcd::toBcd(track));   // track
-                writeResponse(0x01);                // index
-                writeResponse(bcd::toBcd(pos.mm));  // minute (disc)
-                writeResponse(bcd::toBcd(pos.ss));  // second (disc)
-                writeResponse(bcd::toBcd(pos.ff));  // sector (disc)
-                writeResponse(bcd::toBcd(0));       // peaklo
-                writeResponse(bcd::toBcd(0));       // peakhi
+            int track = disc->getTrackByPosition(pos);
 
-                if (verbose) {
-                    printf("CDROM: CDDA report -> (%s)\n", dumpFifo(CDROM_response).c_str());
-                }
-            }
+            postInterrupt(1);
+            writeResponse(stat._reg);           // stat
+            writeResponse(bcd::toBcd(track));   // track
+            writeResponse(0x01);                // index
+            writeResponse(bcd::toBcd(pos.mm));  // minute (disc)
+            writeResponse(bcd::toBcd(pos.ss));  // second (disc)
+            writeResponse(bcd::toBcd(pos.ff));  // sector (disc)
+            writeResponse(bcd::toBcd(0));       // peaklo
+            writeResponse(bcd::toBcd(0));       // peakhi
 
-            if (!this->mute) {
-                // Decode Red Book Audio (16bit Stereo 44100Hz)
-                bool channel = true;
-                for (size_t i = 0; i < rawSector.size(); i += 2) {
-                    int16_t sample = rawSector[i] | (rawSector[i + 1] << 8);
-
-                    if (channel) {
-                        audio.first.push_back(sample);
-                    } else {
-                        audio.second.push_back(sample);
-                    }
-                    channel = !channel;
-                }
+            if (verbose) {
+                printf("CDROM: CDDA report -> (%s)\n", dumpFifo(CDROM_response).c_str());
             }
-        } else if (trackType == disc::TrackType::DATA && stat.read) {
-            ackMoreData();
+        }
 
-            if (memcmp(rawSector.data(), sync.data(), sync.size()) != 0) {
-                printf("Invalid sync\n");
-                return;
+        if (!this->mute) {
+            // Decode Red Book Audio (16bit Stereo 44100Hz)
+            bool channel = true;
+            for (size_t i = 0; i < rawSector.size(); i += 2) {
+                int16_t sample = rawSector[i] | (rawSector[i + 1] << 8);
+
+                if (channel) {
+                    audio.first.push_back(sample);
+                } else {
+                    audio.second.push_back(sample);
+                }
+                channel = !channel;
             }
+        }
+    } else if (trackType == disc::TrackType::DATA && stat.read) {
+        ackMoreData();
 
-            uint8_t minute = rawSector[12];
-            uint8_t second = rawSector[13];
-            uint8_t frame = rawSector[14];
-            uint8_t mode = rawSector[15];
+        if (memcmp(rawSector.data(), sync.data(), sync.size()) != 0) {
+            printf("Invalid sync\n");
+            return;
+        }
 
-            uint8_t file = rawSector[16];
-            uint8_t channel = rawSector[17];
-            auto submode = static_cast<cd::Submode>(rawSector[18]);
-            auto codinginfo = static_cast<cd::Codinginfo>(rawSector[19]);
+        uint8_t minute = rawSector[12];
+        uint8_t second = rawSector[13];
+        uint8_t frame = rawSector[14];
+        uint8_t mode = rawSector[15];
+
+        uint8_t file = rawSector[16];
+        uint8_t channel = rawSector[17];
+        auto submode = static_cast<cd::Submode>(rawSector[18]);
+        auto codinginfo = static_cast<cd::Codinginfo>(rawSector[19]);
+
+        // XA uses Mode2 sectors
+        // Does PSX even support Mode1?
+        if (mode != 2) {
+            printf("Not mode2 (%d instead)\n", mode);
+            return;
+        }
 
-            // XA uses Mode2 sectors
-            // Does PSX even support Mode1?
-            if (mode != 2) {
-                printf("Not mode2 (%d instead)\n", mode);
+        // Only Form2 ?
+        // Does PSX support Form1?
+        // Streaming
+        if (submode.form2 && submode.realtime) {
+            // Filter XA file/channel
+            if (this->mode.xaFilter && (filter.file != file || filter.channel != channel)) {
+                // printf("Mismatch filter\n");
                 return;
             }
 
-            // Only Form2 ?
-            // Does PSX support Form1?
-            // Streaming
-            if (submode.form2 && submode.realtime) {
-                // Filter XA file/channel
-                if (this->mode.xaFilter && (filter.file != file || filter.channel != channel)) {
-                    // printf("Mismatch filter\n");
-                    return;
-                }
-
-                // Only realtime audio
-                if (!submode.audio || !submode.realtime) {
-                    // printf("!audio || !realtime\n");
-                    return;
-                }
+            // Only realtime audio
+            if (!submode.audio || !submode.realtime) {
+                // printf("!audio || !realtime\n");
+                return;
+            }
 
-                if (codinginfo.bits == 1) {
-                    printf("[CDROM] Unsupported 8bit mode for XA\n");
-                    exit(1);
-                }
+            if (codinginfo.bits == 1) {
+                printf("[CDROM] Unsupported 8bit mode for XA\n");
+                exit(1);
+            }
 
-                if (this->mode.xaEnabled && !this->mute) {
-                    auto [left, right] = ADPCM::decodeXA(rawSector.data() + 24, codinginfo);
-                    audio.first.insert(audio.first.end(), left.begin(), left.end());
-                    audio.second.insert(audio.second.end(), right.begin(), right.end());
-                }
+            if (this->mode.xaEnabled && !this->mute) {
+                auto [left, right] = ADPCM::decodeXA(rawSector.data() + 24, codinginfo, xaState);
+                audio.first.insert(audio.first.end(), left.begin(), left.end());
+                audio.second.insert(audio.second.end(), right.begin(), right.end());
+            }
 
-                if (submode.endOfFile) {
-                    printf("End of file\n");
-                    stat.read = false;
-                    return;
-                }
-            } else {
-                // Plain data
+            if (submode.endOfFile) {
+                printf("End of file\n");
+                stat.read = false;
+                return;
             }
+        } else {
+            // Plain data
         }
     }
 }
@@ -180,6 +191,7 @@ uint8_t CDROM::read(uint32_t address) {
     }
     printf("CDROM%d.%d->R    ?????\n", address, status.index);
     sys->state = System::State::pause;
+    sys->cpu->attention = true;
     return 0;
 }
 
@@ -320,6 +332,7 @@ void CDROM::write(uint32_t address, uint8_t data) {
     }
     if (address == 2 && status.index == 1) {  // Interrupt enable
         interruptEnable = data;
+        scheduleInterrupt();
         if (verbose == 2) printf("CDROM: W INTE: 0x%02x\n", data);
         return;
     }
@@ -333,6 +346,7 @@ void CDROM::write(uint32_t address, uint8_t data) {
 
         if (!interruptQueue.empty()) {
             interruptQueue.get();
+            if (!interruptQueue.empty()) scheduleInterrupt();  // Next queued interrupt
         }
         if (verbose == 2) printf("CDROM: W INTF: 0x%02x\n", data);
         return;
@@ -365,6 +379,7 @@ void CDROM::write(uint32_t address, uint8_t data) {
 
     printf("CDROM%d.%d<-W  UNIMPLEMENTED WRITE       0x%02x\n", address, status.index, data);
     sys->state = System::State::pause;
+    sys->cpu->attention = true;
 }
 }  // namespace cdrom
 }  // namespace device
@@ -4,6 +4,8 @@
 #include <memory>
 #include "disc/disc.h"
 #include "fifo.h"
+#include "scheduler.h"
+#include "sound/adpcm.h"
 
 struct System;
 
@@ -161,8 +163,17 @@ class CDROM {
         assert(irq <= 7);
 
         interruptQueue.add(irq);
+        scheduleInterrupt();
     }
 
+    // Interrupts are delivered with small delay after being posted or acknowledged
+    static const int INTERRUPT_DELAY = 300;
+    Scheduler::EventId interruptEvent;
+    Scheduler::EventId sectorEvent;
+    void scheduleInterrupt();
+    // Read next sector if reading or playing, called 75 or 150 times per second
+    void stepSector();
+
     std::string dumpFifo(const fifo<16, uint8_t> f);
 
    public:
@@ -171,15 +182,16 @@ class CDROM {
     uint8_t volumeRightToLeft = 0;
     uint8_t volumeRightToRight = 0;
     std::pair<std::deque<int16_t>, std::deque<int16_t>> audio;
+    ADPCM::XAState xaState;
     std::vector<uint8_t> rawSector;
 
     std::vector<uint8_t> dataBuffer;
-    int dataBufferPointer;  // for DMA
+    int dataBufferPointer = 0;  // for DMA
 
     bool isBufferEmpty();
     uint8_t readByte();
 
-    disc::TrackType trackType;
+    disc::TrackType trackType = disc::TrackType::DATA;
     std::unique_ptr<disc::Disc> disc;
     bool mute = false;
 
@@ -195,6 +207,15 @@ class CDROM {
         postInterrupt(1);
         writeResponse(stat._reg);
     }
+
+    // Disc is not stored, state has to be loaded with the same image inserted
+    template <class Archive>
+    void serialize(Archive& ar) {
+        ar(status, interruptEnable, CDROM_params, CDROM_response, interruptQueue);
+        ar(mode, filter, readSector, seekSector, stat, trackType, mute);
+        ar(volumeLeftToLeft, volumeLeftToRight, volumeRightToLeft, volumeRightToRight, audio, xaState);
+        ar(rawSector, dataBuffer, dataBufferPointer);
+    }
 };
 }  // namespace cdrom
 }  // namespace device
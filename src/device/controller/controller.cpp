@@ -4,6 +4,7 @@
 #include "peripherals/digital_controller.h"
 #include "peripherals/mouse.h"
 #include "peripherals/none.h"
+#include "state/state.h"
 #include "system.h"
 
 namespace device {
@@ -26,7 +27,7 @@ void Controller::handleByte(uint8_t byte) {
         rxData = controller[port]->handle(byte);
         ack = controller[port]->getAck();
         if (ack) {
-            irqTimer = 5;
+            sys->scheduler->schedule(ackEvent, CONTROLLER_ACK_DELAY);
         }
         if (controller[port]->state == 0) deviceSelected = DeviceSelected::None;
     }
@@ -34,31 +35,30 @@ void Controller::handleByte(uint8_t byte) {
         rxData = card[port]->handle(byte);
         ack = card[port]->getAck();
         if (ack) {
-            irqTimer = 3;
+            sys->scheduler->schedule(ackEvent, MEMORY_CARD_ACK_DELAY);
         }
         if (card[port]->state == 0) deviceSelected = DeviceSelected::None;
     }
 }
 
 Controller::Controller(System* sys) : sys(sys) {
-    busToken = bus.listen<Event::Config::Controller>([&](auto) { reload(); });
+    ackEvent = sys->scheduler->addEvent("controller ack", [this] { step(); });
 
     reload();
 
     for (auto i = 0; i < (int)card.size(); i++) {
-        card[i] = std::make_unique<peripherals::MemoryCard>(i + 1);
+        card[i] = std::make_unique<peripherals::MemoryCard>(i + 1, sys->config["debug"]["log"]["memoryCard"]);
     }
 }
 
-Controller::~Controller() { bus.unlistenAll(busToken); }
 void Controller::reload() {
-    auto createDevice = [](int num) -> std::unique_ptr<peripherals::AbstractDevice> {
+    auto createDevice = [this](int num) -> std::unique_ptr<peripherals::AbstractDevice> {
         num += 1;
-        std::string type = config["controller"][std::to_string(num)]["type"];
+        std::string type = sys->config["controller"][std::to_string(num)]["type"];
         if (type == ControllerType::DIGITAL) {
             return std::make_unique<peripherals::DigitalController>(num);
         } else if (type == ControllerType::ANALOG) {
-            return std::make_unique<peripherals::AnalogController>(num);
+            return std::make_unique<peripherals::AnalogController>(num, sys->config["debug"]["log"]["controller"]);
         } else if (type == ControllerType::MOUSE) {
             return std::make_unique<peripherals::Mouse>(num);
         } else {
@@ -72,15 +72,9 @@ void Controller::reload() {
 }
 
 void Controller::step() {
-    if (irqTimer > 0) {
-        if (--irqTimer == 0) {
-            irq = true;
-            ack = false;
-        }
-    }
-    if (irq) {
-        sys->interrupt->trigger(interrupt::CONTROLLER);
-    }
+    irq = true;
+    ack = false;
+    sys->interrupt->trigger(interrupt::CONTROLLER);
 }
 
 uint8_t Controller::read(uint32_t address) {
@@ -133,5 +127,32 @@ void Controller::write(uint32_t address, uint8_t data) {
 void Controller::update() {
     for (auto& ctrl : controller) ctrl->update();
 }
+
+template <class Archive>
+void Controller::serialize(Archive& ar) {
+    ar(deviceSelected, mode, control, baud, irq, rxData, rxPending, ack);
+
+    for (auto& device : controller) {
+        auto type = device->type;
+        ar(type);
+        if constexpr (!Archive::saving) {
+            if (type != device->type) {
+                ar.fail("different controller type");
+                return;
+            }
+        }
+
+        switch (type) {
+            case peripherals::Type::Digital: static_cast<peripherals::DigitalController&>(*device).serialize(ar); break;
+            case peripherals::Type::Analog: static_cast<peripherals::AnalogController&>(*device).serialize(ar); break;
+            case peripherals::Type::Mouse: static_cast<peripherals::Mouse&>(*device).serialize(ar); break;
+            default: device->serialize(ar); break;
+        }
+    }
+    for (auto& memoryCard : card) memoryCard->serialize(ar);
+}
+
+template void Controller::serialize(state::Writer& ar);
+template void Controller::serialize(state::Reader& ar);
 }  // namespace controller
 }  // namespace device
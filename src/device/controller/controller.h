@@ -8,6 +8,7 @@
 #include <string>
 #include "device/device.h"
 #include "peripherals/memory_card.h"
+#include "scheduler.h"
 
 struct System;
 
@@ -17,7 +18,6 @@ namespace controller {
 enum class DeviceSelected { None, Controller, MemoryCard };
 
 class Controller {
-    int busToken;
     System* sys;
 
     DeviceSelected deviceSelected;
@@ -26,7 +26,11 @@ class Controller {
     Reg16 control;
     Reg16 baud;
     bool irq = false;
-    int irqTimer = 0;
+
+    // Delay between byte transfer and /ACK pulse, in system cycles
+    static const int CONTROLLER_ACK_DELAY = 1500;
+    static const int MEMORY_CARD_ACK_DELAY = 900;
+    Scheduler::EventId ackEvent;
 
     void handleByte(uint8_t byte);
 
@@ -47,12 +51,16 @@ class Controller {
     std::array<std::unique_ptr<peripherals::MemoryCard>, 2> card;
 
     Controller(System* sys);
-    ~Controller();
     void reload();
+    // /ACK received, raise interrupt
     void step();
     uint8_t read(uint32_t address);
     void write(uint32_t address, uint8_t data);
     void update();
+
+    // Defined for state::Writer and state::Reader, peripherals are stored with their types
+    template <class Archive>
+    void serialize(Archive& ar);
 };
 }  // namespace controller
 }  // namespace device
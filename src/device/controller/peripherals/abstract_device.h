@@ -18,6 +18,12 @@ struct AbstractDevice {
     // Update key state
     virtual void update();
 
+    // Serialized by Controller according to type
+    template <class Archive>
+    void serialize(Archive& ar) {
+        ar(state);
+    }
+
     virtual ~AbstractDevice();
 };
 };  // namespace peripherals
\ No newline at end of file
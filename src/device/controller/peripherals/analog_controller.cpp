@@ -3,7 +3,7 @@
 #include "input/input_manager.h"
 
 namespace peripherals {
-AnalogController::AnalogController(int port) : DigitalController(Type::Analog, port) { verbose = config["debug"]["log"]["controller"]; }
+AnalogController::AnalogController(int port, int verbose) : DigitalController(Type::Analog, port), verbose(verbose) {}
 
 uint8_t AnalogController::handle(uint8_t byte) {
     if (state == 0) command = Command::None;
@@ -129,7 +129,6 @@ uint8_t AnalogController::handleExitConfiguration(uint8_t byte) {
 }
 
 uint8_t AnalogController::handleSetLed(uint8_t byte) {
-    static uint8_t param;
     switch (state) {
         case 2: state++; return 0x5a;
         case 3:
@@ -166,35 +165,35 @@ uint8_t AnalogController::handleLedStatus(uint8_t byte) {
 }
 
 uint8_t AnalogController::handleUnlockRumble(uint8_t byte) {
-    static uint8_t a, b, c, d, e, f;
     switch (state) {
         case 2: state++; return 0x5a;
         case 3:
-            a = byte;
+            rumbleConfig[0] = byte;
             state++;
             return 0;
         case 4:
-            b = byte;
+            rumbleConfig[1] = byte;
             state++;
             return 0;
         case 5:
-            c = byte;
+            rumbleConfig[2] = byte;
             state++;
             return 0;
         case 6:
-            d = byte;
+            rumbleConfig[3] = byte;
             state++;
             return 0;
         case 7:
-            e = byte;
+            rumbleConfig[4] = byte;
             state++;
             return 0;
         case 8:
-            f = byte;
+            rumbleConfig[5] = byte;
             state = 0;
             analogEnabled = true;  // TODO: Not completely valid, but should be good enough
             if (verbose >= 2)
-                printf("[CONTROLLER%d] Unlock Rumble: 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x\n", port, a, b, c, d, e, f);
+                printf("[CONTROLLER%d] Unlock Rumble: 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x, 0x%02x\n", port, rumbleConfig[0],
+                       rumbleConfig[1], rumbleConfig[2], rumbleConfig[3], rumbleConfig[4], rumbleConfig[5]);
             return 0;
 
         default: return 0xff;
@@ -202,7 +201,6 @@ uint8_t AnalogController::handleUnlockRumble(uint8_t byte) {
 }
 
 uint8_t AnalogController::handleUnknown46(uint8_t byte) {
-    static uint8_t param;
     switch (state) {
         case 2: state++; return 0x5a;
         case 3:
@@ -234,7 +232,6 @@ uint8_t AnalogController::handleUnknown47(uint8_t byte) {
 }
 
 uint8_t AnalogController::handleUnknown4c(uint8_t byte) {
-    static uint8_t param;
     switch (state) {
         case 2: state++; return 0x5a;
         case 3:
@@ -251,26 +248,23 @@ uint8_t AnalogController::handleUnknown4c(uint8_t byte) {
     }
 }
 
+void AnalogController::setAnalogButton(bool pressed) {
+    if (pressed && !analogPressed) {
+        // Toggle analog mode
+        analogEnabled = !analogEnabled;
+        ledEnabled = analogEnabled;
+        resetState();
+        if (verbose >= 1) printf("[CONTROLLER%d] Analog mode %s\n", port, analogEnabled ? "enabled" : "disabled");
+    }
+    analogPressed = pressed;
+}
+
 void AnalogController::update() {
     DigitalController::update();
     auto inputManager = InputManager::getInstance();
     if (inputManager == nullptr) return;
 
-    static bool analogPressed = false;
-
-    if (inputManager->getDigital(path + "analog")) {
-        if (!analogPressed) {
-            analogPressed = true;
-
-            // Toggle analog mode
-            analogEnabled = !analogEnabled;
-            ledEnabled = analogEnabled;
-            resetState();
-            if (verbose >= 1) printf("[CONTROLLER%d] Analog mode %s\n", port, analogEnabled ? "enabled" : "disabled");
-        }
-    } else {
-        analogPressed = false;
-    }
+    setAnalogButton(inputManager->getDigital(path + "analog"));
 
     if (!analogEnabled) {
         buttons.l3 = 0;
@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include "digital_controller.h"
 
 namespace peripherals {
@@ -31,8 +32,12 @@ struct AnalogController : public DigitalController {
     bool analogEnabled = false;
     bool ledEnabled = false;
     bool configurationMode = false;
+    bool analogPressed = false;
 
-    AnalogController(int Port);
+    uint8_t param = 0;                         // First parameter of configuration command
+    std::array<uint8_t, 6> rumbleConfig = {};  // Unlock rumble parameters
+
+    AnalogController(int Port, int verbose);
     uint8_t handle(uint8_t byte) override;
     uint8_t handleReadAnalog(uint8_t byte);
     uint8_t handleEnterConfiguration(uint8_t byte);
@@ -44,5 +49,13 @@ struct AnalogController : public DigitalController {
     uint8_t handleUnknown47(uint8_t byte);
     uint8_t handleUnknown4c(uint8_t byte);
     void update() override;
+    // Analog button toggles analog mode on press
+    void setAnalogButton(bool pressed);
+
+    template <class Archive>
+    void serialize(Archive& ar) {
+        DigitalController::serialize(ar);
+        ar(left, right, command, analogEnabled, ledEnabled, configurationMode, analogPressed, param, rumbleConfig);
+    }
 };
 };  // namespace peripherals
\ No newline at end of file
@@ -27,6 +27,12 @@ void DigitalController::ButtonState::setByName(const std::string& name, bool val
 #undef BUTTON
 }
 
+uint16_t DigitalController::buttonMask(const std::string& name) {
+    ButtonState state(0);
+    state.setByName(name, true);
+    return state._reg;
+}
+
 DigitalController::DigitalController(Type type, int port)
     : AbstractDevice(type, port), buttons(0), path(string_format("controller/%d/", port)) {}
 
@@ -42,7 +42,18 @@ class DigitalController : public AbstractDevice {
 
    public:
     DigitalController(int Port);
+    // Used instead of InputManager, bits are in the order sent to console (select = bit 0, square = bit 15)
+    void setButtons(uint16_t state) { buttons._reg = state; }
+    uint16_t getButtons() const { return buttons._reg; }
+    // Bit of button in setButtons state, 0 for unknown name (eg. "cross", "up")
+    static uint16_t buttonMask(const std::string& name);
     uint8_t handle(uint8_t byte) override;
     void update() override;
+
+    template <class Archive>
+    void serialize(Archive& ar) {
+        AbstractDevice::serialize(ar);
+        ar(buttons._reg);
+    }
 };
 };  // namespace peripherals
\ No newline at end of file
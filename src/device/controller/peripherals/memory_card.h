@@ -30,12 +30,18 @@ struct MemoryCard : public AbstractDevice {
 
     bool dirty = false;
 
-    std::array<uint8_t, 128 * 1024> data;
+    std::array<uint8_t, 128 * 1024> data = {{0}};
 
-    MemoryCard(int port);
+    MemoryCard(int port, int verbose);
     uint8_t handle(uint8_t byte) override;
     uint8_t handleRead(uint8_t byte);
     uint8_t handleWrite(uint8_t byte);
     uint8_t handleId(uint8_t byte);
+
+    template <class Archive>
+    void serialize(Archive& ar) {
+        AbstractDevice::serialize(ar);
+        ar(command, flag, address, checksum, writeStatus, dirty, data);
+    }
 };
 }  // namespace peripherals
\ No newline at end of file
@@ -13,5 +13,11 @@ class Mouse : public AbstractDevice {
     Mouse(int port);
     uint8_t handle(uint8_t byte) override;
     void update() override;
+
+    template <class Archive>
+    void serialize(Archive& ar) {
+        AbstractDevice::serialize(ar);
+        ar(left, right, x, y);
+    }
 };
 };  // namespace peripherals
\ No newline at end of file
@@ -17,6 +17,8 @@ DMA::DMA(System* sys) : sys(sys) {
     dma[4] = std::make_unique<dmaChannel::DMA4Channel>(4, sys, sys->spu.get());
     dma[5] = std::make_unique<dmaChannel::DMAChannel>(5, sys);
     dma[6] = std::make_unique<dmaChannel::DMA6Channel>(6, sys);
+
+    interruptEvent = sys->scheduler->addEvent("dma interrupt", [this] { step(); });
 }
 
 void DMA::step() {
@@ -64,6 +66,7 @@ void DMA::write(uint32_t address, uint8_t data) {
         if (status.getEnableDma(channel)) {
             status.setFlagDma(channel, 1);
             pendingInterrupt = status.calcMasterFlag();
+            if (pendingInterrupt) sys->scheduler->schedule(interruptEvent, INTERRUPT_DELAY);
         }
     }
 }
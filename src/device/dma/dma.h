@@ -2,6 +2,7 @@
 #include <memory>
 #include "device/device.h"
 #include "dma_channel.h"
+#include "scheduler.h"
 
 struct System;
 
@@ -100,7 +101,11 @@ class DMA {
     bool pendingInterrupt = false;
 
    private:
+    // Transfers are instant, interrupt is raised with small delay
+    static const int INTERRUPT_DELAY = 300;
+
     System* sys;
+    Scheduler::EventId interruptEvent;
 
    public:
     std::unique_ptr<dmaChannel::DMAChannel> dma[7];
@@ -109,5 +114,11 @@ class DMA {
     void step();
     uint8_t read(uint32_t address);
     void write(uint32_t address, uint8_t data);
+
+    template <class Archive>
+    void serialize(Archive& ar) {
+        ar(control, status, pendingInterrupt);
+        for (auto& channel : dma) channel->serialize(ar);
+    }
 };
 }  // namespace device::dma
\ No newline at end of file
@@ -4,7 +4,7 @@
 #include "system.h"
 
 namespace device::dma::dmaChannel {
-DMAChannel::DMAChannel(int channel, System* sys) : channel(channel), sys(sys) { verbose = config["debug"]["log"]["dma"]; }
+DMAChannel::DMAChannel(int channel, System* sys) : channel(channel), sys(sys) { verbose = sys->config["debug"]["log"]["dma"]; }
 
 DMAChannel::~DMAChannel() {}
 
@@ -89,5 +89,10 @@ class DMAChannel {
     void step();
     uint8_t read(uint32_t address);
     void write(uint32_t address, uint8_t data);
+
+    template <class Archive>
+    void serialize(Archive& ar) {
+        ar(control, baseAddress, count, irqFlag);
+    }
 };
 }  // namespace device::dma::dmaChannel
@@ -11,4 +11,9 @@ class Expansion2 {
     Expansion2();
     uint8_t read(uint32_t address);
     void write(uint32_t address, uint8_t data);
+
+    template <class Archive>
+    void serialize(Archive& ar) {
+        ar(post);
+    }
 };
\ No newline at end of file
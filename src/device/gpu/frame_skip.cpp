@@ -0,0 +1,68 @@
+#include "frame_skip.h"
+#include <algorithm>
+#include <chrono>
+#include "system.h"
+
+namespace gpu {
+namespace {
+double now() { return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+void average(double& value, double sample) {
+    if (value == 0) {
+        value = sample;
+    } else {
+        value += (sample - value) * 0.05;
+    }
+}
+};  // namespace
+
+FrameSkip::FrameSkip(int frames, bool automatic) : frames(std::max(0, frames)), automatic(automatic), skip(automatic ? 0 : this->frames) {}
+
+double FrameSkip::cost(int skipFrames) const { return (renderedSeconds + skippedSeconds * skipFrames) / (skipFrames + 1); }
+
+bool FrameSkip::beginFrame(System* sys) {
+    presenting = skippedInRow >= skip;
+    skippedInRow = presenting ? 0 : skippedInRow + 1;
+
+    sys->gpu->skipRendering = !presenting;
+    frameStart = now();
+    return presenting;
+}
+
+void FrameSkip::endFrame(System* sys) {
+    double elapsed = now() - frameStart;
+    sys->gpu->skipRendering = false;
+
+    if (!presenting) {
+        average(skippedSeconds, elapsed);
+        skipped++;
+        return;
+    }
+
+    average(renderedSeconds, elapsed);
+    presented++;
+    sys->gpu->flushDisplayArea();
+
+    budgetSeconds = sys->gpu->isNtsc() ? 1.0 / 60.0 : 1.0 / 50.0;
+    if (automatic) {
+        if (skip < frames && cost(skip) > budgetSeconds * SKIP_ABOVE) {
+            skip++;
+        } else if (skip > 0 && cost(skip - 1) < budgetSeconds * PRESENT_BELOW) {
+            skip--;
+        }
+    }
+}
+
+FrameSkip::Stats FrameSkip::getStats() const {
+    Stats stats;
+    stats.frames = frames;
+    stats.automatic = automatic;
+    stats.skip = skip;
+    stats.renderedMs = renderedSeconds * 1000.0;
+    stats.skippedMs = skippedSeconds * 1000.0;
+    stats.budgetMs = budgetSeconds * 1000.0;
+    stats.presented = presented;
+    stats.skipped = skipped;
+    return stats;
+}
+};  // namespace gpu
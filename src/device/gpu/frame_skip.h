@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+
+struct System;
+
+namespace gpu {
+/**
+ * Frame skipping for hosts too slow for the software rasterizer.
+ * Skipped frames are emulated completely (audio stays continuous) but not presented,
+ * primitives drawn during them are rasterized only when something depends on them (see GPU::skipRendering).
+ * Fixed mode presents every (frames + 1)th frame, automatic mode skips up to given frames while emulation is slower than real time.
+ */
+class FrameSkip {
+   public:
+    struct Stats {
+        int frames = 0;
+        bool automatic = false;
+        int skip = 0;             // Frames currently skipped between presented ones
+        double renderedMs = 0;    // Average presented frame
+        double skippedMs = 0;     // Average skipped frame
+        double budgetMs = 0;      // Host frame at real speed
+        uint64_t presented = 0;
+        uint64_t skipped = 0;
+    };
+
+    FrameSkip(int frames, bool automatic);
+
+    // Call before emulating a frame, returns false if the frame won't be presented
+    bool beginFrame(System* sys);
+    // Call after emulating the frame
+    void endFrame(System* sys);
+    Stats getStats() const;
+
+   private:
+    // Automatic mode hysteresis, fraction of frame budget
+    static constexpr double SKIP_ABOVE = 0.95;
+    static constexpr double PRESENT_BELOW = 0.8;
+
+    const int frames;
+    const bool automatic;
+    int skip;
+    int skippedInRow = 0;
+    bool presenting = true;
+    double frameStart = 0;
+
+    // Moving averages
+    double renderedSeconds = 0;
+    double skippedSeconds = 0;
+    double budgetSeconds = 1.0 / 60.0;
+    uint64_t presented = 0;
+    uint64_t skipped = 0;
+
+    // Average emulation time per frame when every (skip + 1)th frame is presented
+    double cost(int skipFrames) const;
+};
+};  // namespace gpu
@@ -1,8 +1,11 @@
 #include "gpu.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
+#include <thread>
 #include "config.h"
 #include "render/render.h"
+#include "render/render_tiles.h"
 #include "utils/logic.h"
 #include "utils/macros.h"
 
@@ -11,18 +14,77 @@ namespace gpu {
 const char* CommandStr[] = {"None",           "FillRectangle",  "Polygon",       "Line",           "Rectangle",
                             "CopyCpuToVram1", "CopyCpuToVram2", "CopyVramToCpu", "CopyVramToVram", "Extra"};
 
-GPU::GPU() {
-    busToken = bus.listen<Event::Config::Graphics>([&](auto) { reload(); });
+namespace {
+// Areas are half-open, right and bottom edges are excluded
+bool isEmpty(const Rect<int>& r) { return r.right <= r.left || r.bottom <= r.top; }
+
+bool overlaps(const Rect<int>& a, const Rect<int>& b) {
+    if (isEmpty(a) || isEmpty(b)) return false;
+    return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+bool contains(const Rect<int>& outer, const Rect<int>& inner) {
+    return inner.left >= outer.left && inner.right <= outer.right && inner.top >= outer.top && inner.bottom <= outer.bottom;
+}
+
+Rect<int> unite(const Rect<int>& a, const Rect<int>& b) {
+    if (isEmpty(a)) return b;
+    if (isEmpty(b)) return a;
+    return {std::min(a.left, b.left), std::min(a.top, b.top), std::max(a.right, b.right), std::max(a.bottom, b.bottom)};
+}
+
+// Transfers wrapping around VRAM edges are treated as touching whole VRAM
+Rect<int> vramArea(int x, int y, int width, int height) {
+    if (x + width > VRAM_WIDTH || y + height > VRAM_HEIGHT) return {0, 0, VRAM_WIDTH, VRAM_HEIGHT};
+    return {x, y, x + width, y + height};
+}
+
+// Texture fetches aren't wrapped, pages reaching past VRAM edge read the following rows
+Rect<int> textureArea(int x, int y, int width, int height) {
+    if (x + width > VRAM_WIDTH) return {0, y, VRAM_WIDTH, std::min(y + height + 1, VRAM_HEIGHT)};
+    return {x, y, x + width, std::min(y + height, VRAM_HEIGHT)};
+}
+
+void setSampledArea(Rect<int>& texture, Rect<int>& clut, int pageX, int pageY, int clutX, int clutY, int bits) {
+    if (bits == 0) return;
+    texture = textureArea(pageX, pageY, bits == 4 ? 64 : bits == 8 ? 128 : 256, 256);
+    if (bits != 16) clut = textureArea(clutX, clutY, bits == 4 ? 16 : 256, 1);
+}
+};  // namespace
+
+void CommandList::add(const DrawCommand& command) {
+    commands.push_back(command);
+    area = unite(area, command.bounds);
+    sources = unite(sources, unite(command.texture, command.clut));
+}
+
+void CommandList::clear() {
+    commands.clear();
+    area = Rect<int>();
+    sources = Rect<int>();
+}
+
+GPU::GPU(const json& config) : config(config) {
     reload();
     reset();
 }
 
-GPU::~GPU() { bus.unlistenAll(busToken); }
+GPU::~GPU() = default;
 
 void GPU::reload() {
     auto mode = config["options"]["graphics"]["rendering_mode"].get<RenderingMode>();
     softwareRendering = (mode & RenderingMode::SOFTWARE) != 0;
     hardwareRendering = (mode & RenderingMode::HARDWARE) != 0;
+
+    // 0 - one per host core
+    int threads = config["options"]["graphics"]["render_threads"];
+    if (threads <= 0) threads = std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 1, MAX_RENDER_THREADS);
+    threads = std::min(threads, MAX_RENDER_THREADS);
+    if (threads != renderThreads) {
+        flushDeferred();
+        tileRenderer.reset();
+        renderThreads = threads;
+    }
 }
 
 void GPU::reset() {
@@ -82,7 +144,7 @@ void GPU::drawPolygon(int16_t x[4], int16_t y[4], RGB c[4], TextureInfo t, bool
         vertices.push_back(v[i]);
     }
     if (softwareRendering) {
-        Render::drawTriangle(this, v);
+        rasterizeTriangle(v);
     }
 
     if (isQuad) {
@@ -100,7 +162,7 @@ void GPU::drawPolygon(int16_t x[4], int16_t y[4], RGB c[4], TextureInfo t, bool
             vertices.push_back(v[i - 1]);
         }
         if (softwareRendering) {
-            Render::drawTriangle(this, v);
+            rasterizeTriangle(v);
         }
     }
 }
@@ -153,10 +215,181 @@ void GPU::drawRectangle(const primitive::Rect& rect) {
     }
 
     if (softwareRendering) {
-        Render::drawRectangle(this, rect);
+        rasterizeRectangle(rect);
+    }
+}
+
+void GPU::rasterizeTriangle(Vertex v[3]) {
+    if (likely(drawsImmediately())) {
+        Render::drawTriangle(this, drawingClip(), v);
+        return;
+    }
+
+    auto p = captureState(Vertex::Type::Polygon);
+    std::copy_n(v, 3, p.v);
+    auto x = std::minmax({v[0].position[0], v[1].position[0], v[2].position[0]});
+    auto y = std::minmax({v[0].position[1], v[1].position[1], v[2].position[1]});
+    p.bounds = clipToDrawingArea(x.first, y.first, x.second + 1, y.second + 1);
+    setSampledArea(p.texture, p.clut, v[0].texpage[0], v[0].texpage[1], v[0].clut[0], v[0].clut[1], v[0].bitcount);
+    submit(p);
+}
+
+void GPU::rasterizeRectangle(const primitive::Rect& rect) {
+    if (likely(drawsImmediately())) {
+        Render::drawRectangle(this, drawingState(), drawingClip(), rect);
+        return;
+    }
+
+    auto p = captureState(Vertex::Type::Rectangle);
+    p.rect = rect;
+    int x = rect.pos.x + drawingOffsetX;
+    int y = rect.pos.y + drawingOffsetY;
+    p.bounds = clipToDrawingArea(x, y, x + rect.size.x, y + rect.size.y);
+    setSampledArea(p.texture, p.clut, rect.texpage.x, rect.texpage.y, rect.clut.x, rect.clut.y, rect.bits);
+    submit(p);
+}
+
+void GPU::rasterizeLine(const int16_t x[2], const int16_t y[2], const RGB c[2]) {
+    if (likely(drawsImmediately())) {
+        Render::drawLine(this, drawingState(), drawingClip(), x, y, c);
+        return;
     }
+
+    auto p = captureState(Vertex::Type::Line);
+    std::copy_n(x, 2, p.x);
+    std::copy_n(y, 2, p.y);
+    std::copy_n(c, 2, p.c);
+    auto px = std::minmax(x[0], x[1]);
+    auto py = std::minmax(y[0], y[1]);
+    p.bounds = clipToDrawingArea(px.first + drawingOffsetX, py.first + drawingOffsetY, px.second + drawingOffsetX + 1,
+                                 py.second + drawingOffsetY + 1);
+    submit(p);
+}
+
+DrawingState GPU::drawingState() const { return {drawingArea, drawingOffsetX, drawingOffsetY, gp0_e1, gp0_e2, gp0_e6}; }
+
+// Pixels rasterizers write, right and bottom edge of drawing area excluded
+Rect<int> GPU::drawingClip() const { return {minDrawingX(0), minDrawingY(0), maxDrawingX(VRAM_WIDTH), maxDrawingY(VRAM_HEIGHT)}; }
+
+DrawCommand GPU::captureState(Vertex::Type type) const {
+    DrawCommand p = {};
+    p.type = type;
+    p.state = drawingState();
+    p.clip = drawingClip();
+    return p;
+}
+
+// Bounds are conservative, rasterizers never write outside of them
+Rect<int> GPU::clipToDrawingArea(int left, int top, int right, int bottom) const {
+    return {std::max({left, (int)drawingArea.left, 0}), std::max({top, (int)drawingArea.top, 0}),
+            std::min({right, drawingArea.right + 1, VRAM_WIDTH}), std::min({bottom, drawingArea.bottom + 1, VRAM_HEIGHT})};
 }
 
+void GPU::submit(const DrawCommand& p) {
+    if (isEmpty(p.bounds)) return;
+
+    // Render to texture, pending primitives have to land before they are sampled
+    beforeVramRead(p.texture);
+    beforeVramRead(p.clut);
+
+    if (skipRendering) {
+        beforeBatchWrite(p.bounds);
+        // Deferred list is rasterized by tiles too, textures it samples must not change under it
+        if (overlaps(p.bounds, deferred.sources)) rasterizeDeferred();
+        deferred.add(p);
+        deferStats.deferred++;
+        return;
+    }
+
+    // Batch keeps order of its own primitives, only textures it samples must not change under it
+    beforeDeferredWrite(p.bounds, false);
+    if (overlaps(p.bounds, batch.sources)) flushBatch();
+    if (renderThreads <= 1) {
+        Render::draw(this, p, p.clip);
+        return;
+    }
+    batch.add(p);
+}
+
+// Every primitive is rasterized with drawing state it was submitted with
+void GPU::rasterize(const std::vector<DrawCommand>& commands) {
+    if (renderThreads <= 1) {
+        for (auto& p : commands) Render::draw(this, p, p.clip);
+        return;
+    }
+
+    if (!tileRenderer) tileRenderer = std::make_unique<TileRenderer>(renderThreads);
+    batchStats.tiles += tileRenderer->draw(this, commands);
+}
+
+// Pending primitives have to be rasterized before VRAM they write is read
+void GPU::beforeVramRead(const Rect<int>& area) {
+    if (overlaps(area, deferred.area)) rasterizeDeferred();
+    if (overlaps(area, batch.area)) flushBatch();
+}
+
+// ... and before VRAM they write or sample is modified
+void GPU::beforeVramWrite(const Rect<int>& area, bool opaque) {
+    beforeDeferredWrite(area, opaque);
+    beforeBatchWrite(area);
+}
+
+// Deferred primitives completely covered by opaque write are dropped instead
+void GPU::beforeDeferredWrite(const Rect<int>& area, bool opaque) {
+    if (overlaps(area, deferred.sources)) {
+        rasterizeDeferred();
+        return;
+    }
+    if (!overlaps(area, deferred.area)) return;
+
+    if (opaque) {
+        auto& commands = deferred.commands;
+        size_t count = commands.size();
+        auto covered = [&](const DrawCommand& p) { return contains(area, p.bounds); };
+        commands.erase(std::remove_if(commands.begin(), commands.end(), covered), commands.end());
+        deferStats.dropped += count - commands.size();
+
+        deferred.area = Rect<int>();
+        for (auto& p : commands) deferred.area = unite(deferred.area, p.bounds);
+        if (!overlaps(area, deferred.area)) return;
+    }
+    rasterizeDeferred();
+}
+
+void GPU::beforeBatchWrite(const Rect<int>& area) {
+    if (overlaps(area, batch.area) || overlaps(area, batch.sources)) flushBatch();
+}
+
+void GPU::rasterizeDeferred() {
+    if (deferred.commands.empty()) return;
+    rasterize(deferred.commands);
+    deferStats.flushed += deferred.commands.size();
+    deferred.clear();
+}
+
+void GPU::flushBatch() {
+    if (batch.commands.empty()) return;
+    rasterize(batch.commands);
+    batchStats.batches++;
+    batchStats.primitives += batch.commands.size();
+    batch.clear();
+}
+
+void GPU::flushDeferred() {
+    rasterizeDeferred();
+    flushBatch();
+}
+
+void GPU::flushDisplayArea() {
+    if (deferred.commands.empty() && batch.commands.empty()) return;
+
+    int width = gp1_08.getHorizontalResoulution();
+    if (gp1_08.colorDepth == GP1_08::ColorDepth::bit24) width = width * 3 / 2 + 1;
+    beforeVramRead(vramArea(displayAreaStartX, displayAreaStartY, width, gp1_08.getVerticalResoulution()));
+}
+
+void GPU::stopRenderThreads() { tileRenderer.reset(); }
+
 void GPU::cmdFillRectangle(uint8_t command) {
     // I'm sorry, but it appears that C++ doesn't have local functions.
     struct mask {
@@ -173,6 +406,9 @@ void GPU::cmdFillRectangle(uint8_t command) {
 
     uint32_t color = to15bit(arguments[0] & 0xffffff);
 
+    // Fill ignores mask bit, covered deferred primitives can be dropped
+    beforeVramWrite({startX, startY, endX, endY}, true);
+
     // Note: not sure if coords should include last column and row
     for (int y = startY; y < endY; y++) {
         for (int x = startX; x < endX; x++) {
@@ -255,7 +491,7 @@ void GPU::cmdLine(LineArgs arg) {
                 vertices.push_back(v);
             }
         }
-        Render::drawLine(this, x, y, c);
+        rasterizeLine(x, y, c);
     }
 
     cmd = Command::None;
@@ -339,6 +575,9 @@ void GPU::cmdCpuToVram1(uint8_t command) {
     endX = startX + MaskCopy::endX(arguments[2] & 0xffff);
     endY = startY + MaskCopy::endY((arguments[2] & 0xffff0000) >> 16);
 
+    bool wraps = endX > VRAM_WIDTH || endY > VRAM_HEIGHT;
+    beforeVramWrite(vramArea(startX, startY, endX - startX, endY - startY), !wraps && !gp0_e6.checkMaskBeforeDraw);
+
     cmd = Command::CopyCpuToVram2;
     argumentCount = 1;
     currentArgument = 0;
@@ -385,6 +624,8 @@ void GPU::cmdVramToCpu(uint8_t command) {
     endX = startX + MaskCopy::endX(arguments[2] & 0xffff);
     endY = startY + MaskCopy::endY((arguments[2] & 0xffff0000) >> 16);
 
+    beforeVramRead(vramArea(startX, startY, endX - startX, endY - startY));
+
     cmd = Command::None;
 }
 
@@ -409,6 +650,9 @@ void GPU::cmdVramToVram(uint8_t command) {
         return;
     }
 
+    beforeVramRead(vramArea(srcX, srcY, width, height));
+    beforeVramWrite(vramArea(dstX, dstY, width, height), false);
+
     for (int y = 0; y < height; y++) {
         for (int x = 0; x < width; x++) {
             uint16_t src = VRAM[(srcY + y) % VRAM_HEIGHT][(srcX + x) % VRAM_WIDTH];
@@ -659,9 +903,9 @@ void GPU::writeGP1(uint32_t data) {
 bool GPU::emulateGpuCycles(int cycles) {
     gpuDot += cycles;
 
-    int newLines = gpuDot / 3413;
+    int newLines = gpuDot / CYCLES_PER_LINE;
     if (newLines == 0) return false;
-    gpuDot %= 3413;
+    gpuDot %= CYCLES_PER_LINE;
     gpuLine += newLines;
 
     if (gpuLine < LINE_VBLANK_START_NTSC - 1) {
@@ -677,6 +921,7 @@ bool GPU::emulateGpuCycles(int cycles) {
     if (gpuLine == LINES_TOTAL_NTSC - 1) {
         gpuLine = 0;
         frames++;
+        flushBatch();  // Frame is complete for frontend
         return true;
     }
     return false;
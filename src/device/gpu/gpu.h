@@ -1,7 +1,9 @@
 #pragma once
 #include <array>
 #include <glm/glm.hpp>
+#include <memory>
 #include <vector>
+#include "config.h"
 #include "primitive.h"
 #include "psx_color.h"
 #include "registers.h"
@@ -10,6 +12,7 @@
 
 struct System;
 class Render;
+class TileRenderer;
 class OpenGL;
 
 namespace gpu {
@@ -21,13 +24,48 @@ const int VRAM_HEIGHT = 512;
 
 const int LINE_VBLANK_START_NTSC = 243;
 const int LINES_TOTAL_NTSC = 263;
+const int CYCLES_PER_LINE = 3413;
+
+// Registers primitive is rasterized with, captured at the time of the command
+struct DrawingState {
+    Rect<int16_t> drawingArea;
+    int16_t drawingOffsetX, drawingOffsetY;
+    GP0_E1 gp0_e1;
+    GP0_E2 gp0_e2;
+    GP0_E6 gp0_e6;
+};
+
+// Primitive waiting in command list (batch rasterized in parallel or deferred by frame skipping)
+struct DrawCommand {
+    Vertex::Type type;
+    Vertex v[3];            // Polygon
+    primitive::Rect rect;   // Rectangle
+    int16_t x[2], y[2];     // Line
+    RGB c[2];
+
+    DrawingState state;
+    Rect<int> clip;     // Drawing area within VRAM, pixels are written only here
+    Rect<int> bounds;   // Written area (conservative)
+    Rect<int> texture;  // Sampled texture page, empty if not textured
+    Rect<int> clut;     // Sampled palette, empty if not paletted
+};
+
+// Commands with union of areas they write and sample
+struct CommandList {
+    std::vector<DrawCommand> commands;
+    Rect<int> area;     // Union of command bounds
+    Rect<int> sources;  // Union of textures and palettes sampled by commands
+
+    void add(const DrawCommand& command);
+    void clear();
+};
 
 class GPU {
     friend struct ::System;
     friend class ::Render;
     friend class ::OpenGL;
 
-    int busToken;
+    const json& config;  // Owned by System
 
     // TODO: Comment private fields
     int startX = 0;
@@ -97,6 +135,13 @@ class GPU {
     bool softwareRendering;
     bool hardwareRendering;
 
+    // Primitives drawn while frames are skipped, rasterized only when VRAM area they write is needed
+    CommandList deferred;
+    // Primitives of current frame since last synchronization point, rasterized by tile renderer
+    CommandList batch;
+    int renderThreads = 1;
+    std::unique_ptr<TileRenderer> tileRenderer;  // Created on first batch
+
     void reset();
     void cmdFillRectangle(uint8_t command);
     void cmdPolygon(PolygonArgs arg);
@@ -110,10 +155,26 @@ class GPU {
     void drawPolygon(int16_t x[4], int16_t y[4], RGB c[4], TextureInfo t, bool isQuad = false, bool textured = false, int flags = 0);
     void drawRectangle(const primitive::Rect& rect);
 
+    void rasterizeTriangle(Vertex v[3]);
+    void rasterizeRectangle(const primitive::Rect& rect);
+    void rasterizeLine(const int16_t x[2], const int16_t y[2], const RGB c[2]);
+    bool drawsImmediately() const { return !skipRendering && renderThreads <= 1 && deferred.commands.empty(); }
+    DrawingState drawingState() const;
+    Rect<int> drawingClip() const;
+    DrawCommand captureState(Vertex::Type type) const;
+    Rect<int> clipToDrawingArea(int left, int top, int right, int bottom) const;
+    void submit(const DrawCommand& command);
+    void rasterize(const std::vector<DrawCommand>& commands);
+    void beforeVramRead(const Rect<int>& area);
+    void beforeVramWrite(const Rect<int>& area, bool opaque);
+    void beforeDeferredWrite(const Rect<int>& area, bool opaque);
+    void beforeBatchWrite(const Rect<int>& area);
+    void rasterizeDeferred();
+    void flushBatch();
+
     void writeGP0(uint32_t data);
     void writeGP1(uint32_t data);
 
-    void reload();
     void maskedWrite(int x, int y, uint16_t value);
 
    public:
@@ -122,8 +183,9 @@ class GPU {
 
     std::array<uint16_t, VRAM_WIDTH * VRAM_HEIGHT> vram{};
 
-    GPU();
+    explicit GPU(const json& config);
     ~GPU();
+    void reload();
     void step();
     bool emulateGpuCycles(int cycles);
     uint32_t read(uint32_t address);
@@ -141,6 +203,48 @@ class GPU {
     std::array<uint16_t, VRAM_WIDTH * VRAM_HEIGHT> prevVram{};
 
     void clear() { vertices.clear(); }
+
+    // Frame skipping, rasterization is deferred until the result is read, copied, partially overwritten or displayed.
+    // Primitives fully covered by a later fill or upload are dropped.
+    bool skipRendering = false;
+    struct DeferStats {
+        uint64_t deferred = 0;  // Primitives drawn while skipping
+        uint64_t dropped = 0;   // Overwritten before they were needed
+        uint64_t flushed = 0;   // Rasterized late because their area was needed
+    } deferStats;
+
+    // Software rendering, primitives between synchronization points are drawn in parallel by 64x32 tiles
+    static const int MAX_RENDER_THREADS = 8;
+    int getRenderThreads() const { return renderThreads; }
+    struct BatchStats {
+        uint64_t batches = 0;     // Rasterized command lists
+        uint64_t primitives = 0;  // Primitives in them
+        uint64_t tiles = 0;       // Non-empty tiles drawn by workers
+    } batchStats;
+
+    // Rasterizes all deferred and batched primitives
+    void flushDeferred();
+    // Rasterizes deferred primitives if displayed area depends on them, call before presenting
+    void flushDisplayArea();
+    // Threads don't survive fork, they are started again with next batch
+    void stopRenderThreads();
+
+    template <class Archive>
+    void serialize(Archive& ar) {
+        ar(startX, startY, endX, endY, currX, currY, gpuReadMode, GPUREAD, GPUSTAT);
+        ar(cmd, command, arguments, currentArgument, argumentCount);
+        ar(gpuLine, gpuDot, odd, frames);
+        ar(gp0_e1, drawingArea, drawingOffsetX, drawingOffsetY, gp0_e6, gp0_e2, gp1_08);
+        ar(irqRequest, displayDisable, dmaDirection, displayAreaStartX, displayAreaStartY);
+        ar(displayRangeX1, displayRangeX2, displayRangeY1, displayRangeY2, textureDisableAllowed);
+        if (Archive::saving) flushDeferred();
+        ar(vram);
+        if (!Archive::saving) {
+            vertices.clear();
+            deferred.clear();
+            batch.clear();
+        }
+    }
 };
 
 }  // namespace gpu
\ No newline at end of file
@@ -1,9 +1,13 @@
 #pragma once
 #include "device/gpu/gpu.h"
 
+// Pixels are written only inside clip (drawing area, or part of it drawn by one thread)
 class Render {
    public:
-    static void drawLine(gpu::GPU* gpu, const int16_t x[2], const int16_t y[2], const RGB c[2]);
-    static void drawTriangle(gpu::GPU* gpu, gpu::Vertex v[3]);
-    static void drawRectangle(gpu::GPU* gpu, const primitive::Rect& rect);
-};
\ No newline at end of file
+    static void drawLine(gpu::GPU* gpu, const gpu::DrawingState& state, const gpu::Rect<int>& clip, const int16_t x[2], const int16_t y[2],
+                         const RGB c[2]);
+    static void drawTriangle(gpu::GPU* gpu, const gpu::Rect<int>& clip, gpu::Vertex v[3]);
+    static void drawRectangle(gpu::GPU* gpu, const gpu::DrawingState& state, const gpu::Rect<int>& clip, const primitive::Rect& rect);
+    // Draws command with drawing state it was submitted with
+    static void draw(gpu::GPU* gpu, const gpu::DrawCommand& command, const gpu::Rect<int>& clip);
+};
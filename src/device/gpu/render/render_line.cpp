@@ -4,11 +4,14 @@
 #undef VRAM
 #define VRAM ((uint16_t(*)[gpu::VRAM_WIDTH])gpu->vram.data())
 
-void Render::drawLine(gpu::GPU* gpu, const int16_t x[2], const int16_t y[2], const RGB c[2]) {
-    int x0 = x[0] + gpu->drawingOffsetX;
-    int y0 = y[0] + gpu->drawingOffsetY;
-    int x1 = x[1] + gpu->drawingOffsetX;
-    int y1 = y[1] + gpu->drawingOffsetY;
+void Render::drawLine(gpu::GPU* gpu, const gpu::DrawingState& state, const gpu::Rect<int>& clip, const int16_t x[2], const int16_t y[2],
+                      const RGB c[2]) {
+    int x0 = x[0] + state.drawingOffsetX;
+    int y0 = y[0] + state.drawingOffsetY;
+    int x1 = x[1] + state.drawingOffsetX;
+    int y1 = y[1] + state.drawingOffsetY;
+
+    auto inside = [&](int x, int y) { return x >= clip.left && x < clip.right && y >= clip.top && y < clip.bottom; };
 
     // Skip rendering when distence between vertices is bigger than 1023x511
     if (abs(x0 - x1) >= 1024) return;
@@ -32,9 +35,9 @@ void Render::drawLine(gpu::GPU* gpu, const int16_t x[2], const int16_t y[2], con
     int _y = y0;
     for (int _x = x0; _x <= x1; _x++) {
         if (steep) {
-            if (gpu->insideDrawingArea(_y, _x)) VRAM[_x][_y] = to15bit(c[0].raw);
+            if (inside(_y, _x)) VRAM[_x][_y] = to15bit(c[0].raw);
         } else {
-            if (gpu->insideDrawingArea(_x, _y)) VRAM[_y][_x] = to15bit(c[0].raw);
+            if (inside(_x, _y)) VRAM[_y][_x] = to15bit(c[0].raw);
         }
         error += derror;
         if (error > dx) {
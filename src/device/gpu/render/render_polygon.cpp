@@ -132,18 +132,18 @@ INLINE void plotPixel(GPU* gpu, const ivec2 p, const ivec3 s, const int area, co
 }
 
 template <ColorDepth bits>
-INLINE void triangle(GPU* gpu, const ivec2 pos[3], const ivec3 color[3], const ivec2 tex[3], const ivec2 texPage, const ivec2 clut,
-                     const int flags, const gpu::GP0_E2 textureWindow, const gpu::GP0_E6 maskSettings) {
+INLINE void triangle(GPU* gpu, const gpu::Rect<int>& clip, const ivec2 pos[3], const ivec3 color[3], const ivec2 tex[3], const ivec2 texPage,
+                     const ivec2 clut, const int flags, const gpu::GP0_E2 textureWindow, const gpu::GP0_E6 maskSettings) {
     const int area = orient2d(pos[0], pos[1], pos[2]);
     if (area == 0) return;
 
-    const ivec2 min = ivec2(                                         //
-        gpu->minDrawingX(std::min({pos[0].x, pos[1].x, pos[2].x})),  //
-        gpu->minDrawingY(std::min({pos[0].y, pos[1].y, pos[2].y}))   //
+    const ivec2 min = ivec2(                                            //
+        std::max(clip.left, std::min({pos[0].x, pos[1].x, pos[2].x})),  //
+        std::max(clip.top, std::min({pos[0].y, pos[1].y, pos[2].y}))    //
     );
-    const ivec2 max = ivec2(                                         //
-        gpu->maxDrawingX(std::max({pos[0].x, pos[1].x, pos[2].x})),  //
-        gpu->maxDrawingY(std::max({pos[0].y, pos[1].y, pos[2].y}))   //
+    const ivec2 max = ivec2(                                             //
+        std::min(clip.right, std::max({pos[0].x, pos[1].x, pos[2].x})),  //
+        std::min(clip.bottom, std::max({pos[0].y, pos[1].y, pos[2].y}))  //
     );
 
     // https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
@@ -182,7 +182,7 @@ INLINE void triangle(GPU* gpu, const ivec2 pos[3], const ivec3 color[3], const i
 }
 
 // TODO: Render in batches
-void Render::drawTriangle(GPU* gpu, Vertex v[3]) {
+void Render::drawTriangle(GPU* gpu, const gpu::Rect<int>& clip, Vertex v[3]) {
     ivec2 pos[3];
     ivec3 color[3];
     ivec2 texcoord[3];
@@ -218,11 +218,11 @@ void Render::drawTriangle(GPU* gpu, Vertex v[3]) {
     }
 
     if (bits == 0)
-        triangle<ColorDepth::NONE>(gpu, pos, color, texcoord, texpage, clut, flags, textureWindow, maskSettings);
+        triangle<ColorDepth::NONE>(gpu, clip, pos, color, texcoord, texpage, clut, flags, textureWindow, maskSettings);
     else if (bits == 4)
-        triangle<ColorDepth::BIT_4>(gpu, pos, color, texcoord, texpage, clut, flags, textureWindow, maskSettings);
+        triangle<ColorDepth::BIT_4>(gpu, clip, pos, color, texcoord, texpage, clut, flags, textureWindow, maskSettings);
     else if (bits == 8)
-        triangle<ColorDepth::BIT_8>(gpu, pos, color, texcoord, texpage, clut, flags, textureWindow, maskSettings);
+        triangle<ColorDepth::BIT_8>(gpu, clip, pos, color, texcoord, texpage, clut, flags, textureWindow, maskSettings);
     else if (bits == 16)
-        triangle<ColorDepth::BIT_16>(gpu, pos, color, texcoord, texpage, clut, flags, textureWindow, maskSettings);
+        triangle<ColorDepth::BIT_16>(gpu, clip, pos, color, texcoord, texpage, clut, flags, textureWindow, maskSettings);
 }
\ No newline at end of file
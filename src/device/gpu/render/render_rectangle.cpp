@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "../primitive.h"
 #include "render.h"
 #include "texture_utils.h"
@@ -26,47 +27,57 @@ INLINE glm::uvec2 calculateTexel(glm::ivec2 tex, const gpu::GP0_E2 textureWindow
 }
 
 template <ColorDepth bits>
-INLINE void rectangle(GPU* gpu, const primitive::Rect& rect) {
+INLINE void rectangle(GPU* gpu, const gpu::DrawingState& state, const gpu::Rect<int>& clip, const primitive::Rect& rect) {
     // Extract common GPU state
     using Transparency = gpu::GP0_E1::SemiTransparency;
-    const auto transparency = gpu->gp0_e1.semiTransparency;
-    const bool checkMaskBeforeDraw = gpu->gp0_e6.checkMaskBeforeDraw;
-    const bool setMaskWhileDrawing = gpu->gp0_e6.setMaskWhileDrawing;
-    const auto textureWindow = gpu->gp0_e2;
+    const auto transparency = state.gp0_e1.semiTransparency;
+    const bool checkMaskBeforeDraw = state.gp0_e6.checkMaskBeforeDraw;
+    const bool setMaskWhileDrawing = state.gp0_e6.setMaskWhileDrawing;
+    const auto textureWindow = state.gp0_e2;
     const bool isBlended = !rect.isRawTexture;
     constexpr bool isTextured = bits != ColorDepth::NONE;
 
-    const ivec2 pos(                       //
-        rect.pos.x + gpu->drawingOffsetX,  //
-        rect.pos.y + gpu->drawingOffsetY   //
+    const ivec2 pos(                        //
+        rect.pos.x + state.drawingOffsetX,  //
+        rect.pos.y + state.drawingOffsetY   //
     );
-    const ivec2 min(              //
-        gpu->minDrawingX(pos.x),  //
-        gpu->minDrawingY(pos.y)   //
+    // Texture coordinates start at the drawing area edge, clip can cut the rectangle further
+    const ivec2 start(                                      //
+        std::max({pos.x, (int)state.drawingArea.left, 0}),  //
+        std::max({pos.y, (int)state.drawingArea.top, 0})    //
     );
-    const ivec2 max(                            //
-        gpu->maxDrawingX(pos.x + rect.size.x),  //
-        gpu->maxDrawingY(pos.y + rect.size.y)   //
+    const ivec2 min(                   //
+        std::max(start.x, clip.left),  //
+        std::max(start.y, clip.top)    //
+    );
+    const ivec2 max(                                //
+        std::min(clip.right, pos.x + rect.size.x),  //
+        std::min(clip.bottom, pos.y + rect.size.y)  //
     );
 
-    const ivec2 uv(                   //
-        rect.uv.x + (min.x - pos.x),  // Add offset if part of rectange was cut off
-        rect.uv.y + (min.y - pos.y)   //
+    const ivec2 uv(                     //
+        rect.uv.x + (start.x - pos.x),  // Add offset if part of rectange was cut off
+        rect.uv.y + (start.y - pos.y)   //
     );
     int uStep = 1, vStep = 1;
 
     // Texture flipping
     // TODO: Not tested!
-    if (gpu->gp0_e1.texturedRectangleXFlip) {
+    if (state.gp0_e1.texturedRectangleXFlip) {
         uStep = -1;
     }
-    if (gpu->gp0_e1.texturedRectangleYFlip) {
+    if (state.gp0_e1.texturedRectangleYFlip) {
         vStep = -1;
     }
 
+    const ivec2 uvMin(                     //
+        uv.x + (min.x - start.x) * uStep,  //
+        uv.y + (min.y - start.y) * vStep   //
+    );
+
     int x, y, u, v;
-    for (y = min.y, v = uv.y; y < max.y; y++, v += vStep) {
-        for (x = min.x, u = uv.x; x < max.x; x++, u += uStep) {
+    for (y = min.y, v = uvMin.y; y < max.y; y++, v += vStep) {
+        for (x = min.x, u = uvMin.x; x < max.x; x++, u += uStep) {
             if (unlikely(checkMaskBeforeDraw)) {
                 PSXColor bg = VRAM[y][x];
                 if (bg.k) continue;
@@ -102,14 +113,14 @@ INLINE void rectangle(GPU* gpu, const primitive::Rect& rect) {
         }
     }
 }
-void Render::drawRectangle(gpu::GPU* gpu, const primitive::Rect& rect) {
+void Render::drawRectangle(gpu::GPU* gpu, const gpu::DrawingState& state, const gpu::Rect<int>& clip, const primitive::Rect& rect) {
     if (rect.bits == 0) {
-        rectangle<ColorDepth::NONE>(gpu, rect);
+        rectangle<ColorDepth::NONE>(gpu, state, clip, rect);
     } else if (rect.bits == 4) {
-        rectangle<ColorDepth::BIT_4>(gpu, rect);
+        rectangle<ColorDepth::BIT_4>(gpu, state, clip, rect);
     } else if (rect.bits == 8) {
-        rectangle<ColorDepth::BIT_8>(gpu, rect);
+        rectangle<ColorDepth::BIT_8>(gpu, state, clip, rect);
     } else if (rect.bits == 16) {
-        rectangle<ColorDepth::BIT_16>(gpu, rect);
+        rectangle<ColorDepth::BIT_16>(gpu, state, clip, rect);
     }
 }
\ No newline at end of file
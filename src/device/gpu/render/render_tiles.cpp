@@ -0,0 +1,97 @@
+#include "render_tiles.h"
+#include <algorithm>
+#include "render.h"
+
+void Render::draw(gpu::GPU* gpu, const gpu::DrawCommand& command, const gpu::Rect<int>& clip) {
+    if (command.type == gpu::Vertex::Type::Polygon) {
+        gpu::Vertex v[3] = {command.v[0], command.v[1], command.v[2]};
+        drawTriangle(gpu, clip, v);
+    } else if (command.type == gpu::Vertex::Type::Rectangle) {
+        drawRectangle(gpu, command.state, clip, command.rect);
+    } else if (command.type == gpu::Vertex::Type::Line) {
+        drawLine(gpu, command.state, clip, command.x, command.y, command.c);
+    }
+}
+
+TileRenderer::TileRenderer(int threads) {
+    for (int i = 1; i < threads; i++) workers.emplace_back([this] { workerLoop(); });
+}
+
+TileRenderer::~TileRenderer() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+int TileRenderer::draw(gpu::GPU* gpu, const std::vector<gpu::DrawCommand>& commands) {
+    // Bounds are clipped to VRAM and never empty
+    activeTiles.clear();
+    for (uint32_t i = 0; i < commands.size(); i++) {
+        const auto& bounds = commands[i].bounds;
+        for (int y = bounds.top / TILE_HEIGHT; y <= (bounds.bottom - 1) / TILE_HEIGHT; y++) {
+            for (int x = bounds.left / TILE_WIDTH; x <= (bounds.right - 1) / TILE_WIDTH; x++) {
+                int tile = y * TILES_X + x;
+                if (bins[tile].empty()) activeTiles.push_back(tile);
+                bins[tile].push_back(i);
+            }
+        }
+    }
+
+    this->gpu = gpu;
+    this->commands = &commands;
+    nextTile = 0;
+
+    // Waking workers costs more than a single tile
+    if (workers.empty() || activeTiles.size() == 1) {
+        drawTiles();
+    } else {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            working = static_cast<int>(workers.size());
+            generation++;
+        }
+        wake.notify_all();
+        drawTiles();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return working == 0; });
+    }
+
+    for (int tile : activeTiles) bins[tile].clear();
+    return static_cast<int>(activeTiles.size());
+}
+
+void TileRenderer::workerLoop() {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || generation != seen; });
+            if (quit) return;
+            seen = generation;
+        }
+
+        drawTiles();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (--working == 0) done.notify_one();
+    }
+}
+
+void TileRenderer::drawTiles() {
+    for (size_t i = nextTile++; i < activeTiles.size(); i = nextTile++) drawTile(activeTiles[i]);
+}
+
+void TileRenderer::drawTile(int tile) {
+    int left = (tile % TILES_X) * TILE_WIDTH;
+    int top = (tile / TILES_X) * TILE_HEIGHT;
+    for (uint32_t i : bins[tile]) {
+        const auto& command = (*commands)[i];
+        gpu::Rect<int> clip = {std::max(left, command.clip.left), std::max(top, command.clip.top),
+                               std::min(left + TILE_WIDTH, command.clip.right), std::min(top + TILE_HEIGHT, command.clip.bottom)};
+        Render::draw(gpu, command, clip);
+    }
+}
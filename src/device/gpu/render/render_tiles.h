@@ -0,0 +1,50 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "device/gpu/gpu.h"
+
+/**
+ * Rasterizes command list on worker threads.
+ * VRAM is split into 64x32 tiles, every tile gets commands touching it in submission order and is drawn by a single thread,
+ * so semi-transparency and mask bit see the same pixels as with serial rendering.
+ * Commands of one list never sample VRAM written by the list or write VRAM sampled by it,
+ * GPU rasterizes the batch or deferred list before such command (see GPU::submit).
+ */
+class TileRenderer {
+   public:
+    static const int TILE_WIDTH = 64;
+    static const int TILE_HEIGHT = 32;
+
+    // Calling thread draws tiles too, threads - 1 workers are started
+    explicit TileRenderer(int threads);
+    ~TileRenderer();
+
+    // Returns number of tiles drawn
+    int draw(gpu::GPU* gpu, const std::vector<gpu::DrawCommand>& commands);
+
+   private:
+    static const int TILES_X = gpu::VRAM_WIDTH / TILE_WIDTH;
+    static const int TILES_Y = gpu::VRAM_HEIGHT / TILE_HEIGHT;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    bool quit = false;
+    uint64_t generation = 0;  // Incremented for every list
+    int working = 0;          // Workers that haven't finished current list
+
+    // Current list, read-only while workers run
+    gpu::GPU* gpu = nullptr;
+    const std::vector<gpu::DrawCommand>* commands = nullptr;
+    std::array<std::vector<uint32_t>, TILES_X * TILES_Y> bins;  // Command indices per tile
+    std::vector<int> activeTiles;
+    std::atomic<size_t> nextTile{0};
+
+    void workerLoop();
+    void drawTiles();
+    void drawTile(int tile);
+};
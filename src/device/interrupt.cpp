@@ -51,6 +51,7 @@ std::string Interrupt::getStatus() {
 void Interrupt::step() {
     // notify cop0
     sys->cpu->cop0.cause.interruptPending = interruptPending() ? 4 : 0;
+    sys->cpu->updateInterrupts();
 }
 
 uint8_t Interrupt::read(uint32_t address) {
@@ -54,6 +54,11 @@ class Interrupt {
     uint8_t read(uint32_t address);
     void write(uint32_t address, uint8_t data);
 
+    template <class Archive>
+    void serialize(Archive& ar) {
+        ar(status, mask);
+    }
+
     void trigger(interrupt::IrqNumber irq);
     bool interruptPending();
     std::string getMask();
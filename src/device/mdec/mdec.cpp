@@ -6,12 +6,11 @@
 
 namespace mdec {
 
-MDEC::MDEC() { reset(); }
+MDEC::MDEC(int verbose) : verbose(verbose) { reset(); }
 
 void MDEC::step() {}
 
 void MDEC::reset() {
-    verbose = config["debug"]["log"]["mdec"];
     command._reg = 0;
     status._reg = 0x80040000;
 
@@ -20,7 +19,6 @@ void MDEC::reset() {
     outputPtr = 0;
 }
 
-int part = 0;
 uint32_t MDEC::read(uint32_t address) {
     if (address < 4) {
         // 0:  r B G R
@@ -50,13 +50,14 @@ class MDEC {
     Reg32 _control;
 
     Commands cmd;
-    std::array<uint8_t, 64> luminanceQuantTable;
-    std::array<uint8_t, 64> colorQuantTable;
-    std::array<int16_t, 64> idctTable;
+    std::array<uint8_t, 64> luminanceQuantTable = {{0}};
+    std::array<uint8_t, 64> colorQuantTable = {{0}};
+    std::array<int16_t, 64> idctTable = {{0}};
 
     bool color = false;  // 0 - luminance only, 1 - luminance and color
     int paramCount = 0;
     int cnt = 0;
+    int part = 0;  // 24bit output is read in 3 word cycle
 
     void reset();
 
@@ -65,6 +66,9 @@ class MDEC {
     size_t outputPtr;
 
     // Algorithm
+    std::array<int16_t, 64> crblk = {{0}};
+    std::array<int16_t, 64> cbblk = {{0}};
+    std::array<int16_t, 64> yblk[4] = {{0}};
 
     void decodeMacroblocks();
     void yuvToRgb(decodedBlock& output, int blockX, int blockY);
@@ -73,10 +77,16 @@ class MDEC {
     void idct(std::array<int16_t, 64>& src);
 
    public:
-    MDEC();
+    explicit MDEC(int verbose);
     void step();
     uint32_t read(uint32_t address);
     void handleCommand(uint8_t cmd, uint32_t data);
     void write(uint32_t address, uint32_t data);
+
+    template <class Archive>
+    void serialize(Archive& ar) {
+        ar(command, data, status, _control, cmd, luminanceQuantTable, colorQuantTable, idctTable);
+        ar(color, paramCount, cnt, part, input, output, outputPtr);
+    }
 };
 };  // namespace mdec
\ No newline at end of file
@@ -13,4 +13,9 @@ class Serial {
     void step();
     uint8_t read(uint32_t address);
     void write(uint32_t address, uint8_t data);
+
+    template <class Archive>
+    void serialize(Archive& ar) {
+        ar(status, baud);
+    }
 };
\ No newline at end of file
@@ -93,8 +93,6 @@ void SPU::step(device::cdrom::CDROM* cdrom) {
     sumRight *= mainVolume.getRight();
 
     if (!forceReverbOff && control.masterReverb) {
-        static float reverbLeft = 0.f, reverbRight = 0.f;
-        static int reverbCounter = 0;
         if (reverbCounter++ % 2 == 0) {
             std::tie(reverbLeft, reverbRight) = doReverb(this, std::make_tuple(sumReverbLeft, sumReverbRight));
         }
@@ -262,53 +260,47 @@ uint8_t SPU::read(uint32_t address) {
     }
 
     if (address >= 0x1F801D90 && address <= 0x1F801D93) {  // Pitch modulation enable flags
-        static Reg32 pitchModulation;
-
         if (address == 0x1F801D90) {
-            pitchModulation._reg = 0;
+            pitchModulationRead._reg = 0;
             for (int v = 1; v < VOICE_COUNT; v++) {
-                pitchModulation.setBit(v, voices[v].pitchModulation);
+                pitchModulationRead.setBit(v, voices[v].pitchModulation);
             }
         }
 
-        return pitchModulation.read(address - 0x1F801D90);
+        return pitchModulationRead.read(address - 0x1F801D90);
     }
 
     if (address >= 0x1f801d9c && address <= 0x1f801d9f) {  // Voice ON/OFF status (ENDX)
-        static Reg32 status;
         if (address == 0x1f801d9c) {
-            status._reg = 0;
+            statusRead._reg = 0;
             for (int v = 0; v < VOICE_COUNT; v++) {
-                status.setBit(v, voices[v].loopEnd);
+                statusRead.setBit(v, voices[v].loopEnd);
             }
         }
 
-        return status._byte[address - 0x1f801d9c];
+        return statusRead._byte[address - 0x1f801d9c];
     }
 
     if (address >= 0x1F801D94 && address <= 0x1F801D97) {  // Voice noise mode
-        static Reg32 noiseEnabled;
-
         if (address == 0x1F801D94) {
-            noiseEnabled._reg = 0;
+            noiseEnabledRead._reg = 0;
             for (int v = 0; v < VOICE_COUNT; v++) {
-                noiseEnabled.setBit(v, voices[v].mode == Voice::Mode::Noise);
+                noiseEnabledRead.setBit(v, voices[v].mode == Voice::Mode::Noise);
             }
         }
 
-        return noiseEnabled.read(address - 0x1F801D94);
+        return noiseEnabledRead.read(address - 0x1F801D94);
     }
 
     if (address >= 0x1f801d98 && address <= 0x1f801d9b) {  // Voice Reverb
-        static Reg32 reverb;
         if (address == 0x1f801d98) {
-            reverb._reg = 0;
+            reverbRead._reg = 0;
             for (int v = 0; v < VOICE_COUNT; v++) {
-                reverb.setBit(v, voices[v].reverb);
+                reverbRead.setBit(v, voices[v].reverb);
             }
         }
 
-        return reverb.read(address - 0x1f801d98);
+        return reverbRead.read(address - 0x1f801d98);
     }
 
     if (address >= 0x1F801DA2 && address <= 0x1F801DA3) {  // Reverb Work area start
@@ -381,36 +373,32 @@ void SPU::write(uint32_t address, uint8_t data) {
     }
 
     if (address >= 0x1F801D90 && address <= 0x1F801D93) {  // Pitch modulation enable flags
-        static Reg32 pitchModulation;
-
-        pitchModulation.write(address - 0x1F801D90, data);
+        pitchModulationWrite.write(address - 0x1F801D90, data);
         if (address == 0x1F801D93) {
             for (int v = 1; v < VOICE_COUNT; v++) {
-                voices[v].pitchModulation = pitchModulation.getBit(v);
+                voices[v].pitchModulation = pitchModulationWrite.getBit(v);
             }
         }
         return;
     }
 
     if (address >= 0x1F801D94 && address <= 0x1F801D97) {  // Voice noise mode
-        static Reg32 noiseEnabled;
-        noiseEnabled.write(address - 0x1F801D94, data);
+        noiseEnabledWrite.write(address - 0x1F801D94, data);
 
         if (address == 0x1F801D97) {
             for (int v = 0; v < VOICE_COUNT; v++) {
-                voices[v].mode = noiseEnabled.getBit(v) ? Voice::Mode::Noise : Voice::Mode::ADSR;
+                voices[v].mode = noiseEnabledWrite.getBit(v) ? Voice::Mode::Noise : Voice::Mode::ADSR;
             }
         }
         return;
     }
 
     if (address >= 0x1f801d98 && address <= 0x1f801d9b) {  // Voice Reverb
-        static Reg32 reverb;
-        reverb.write(address - 0x1f801d98, data);
+        reverbWrite.write(address - 0x1f801d98, data);
 
         if (address == 0x1f801d9b) {
             for (int v = 0; v < VOICE_COUNT; v++) {
-                voices[v].reverb = reverb.getBit(v);
+                voices[v].reverb = reverbWrite.getBit(v);
             }
         }
         return;
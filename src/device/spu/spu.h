@@ -27,7 +27,7 @@ struct SPU {
 
     Reg16 irqAddress;
     Reg16 dataAddress;
-    uint32_t currentDataAddress;
+    uint32_t currentDataAddress = 0;
     DataTransferControl dataTransferControl;
     Control control;
     Reg16 SPUSTAT;
@@ -39,6 +39,12 @@ struct SPU {
     Reg32 _keyOn;
     Reg32 _keyOff;
 
+    // Voice flags are packed in 32bit registers accessed byte by byte, partial values are kept here
+    Reg32 pitchModulationRead, pitchModulationWrite;
+    Reg32 noiseEnabledRead, noiseEnabledWrite;
+    Reg32 reverbRead, reverbWrite;
+    Reg32 statusRead;
+
     std::array<uint8_t, RAM_SIZE> ram;
 
     bool forceReverbOff = false;           // Debug use
@@ -46,7 +52,10 @@ struct SPU {
     bool forcePitchModulationOff = false;  // Debug use
     Reg16 reverbBase;
     std::array<Reg16, 32> reverbRegisters;
-    uint32_t reverbCurrentAddress;
+    uint32_t reverbCurrentAddress = 0;
+    // Reverb is calculated at half of sample rate, last output is mixed with every sample
+    int reverbCounter = 0;
+    float reverbLeft = 0.f, reverbRight = 0.f;
 
     bool bufferReady = false;
     size_t audioBufferPos;
@@ -66,5 +75,15 @@ struct SPU {
     void memoryWrite16(uint32_t address, uint16_t data);
 
     void dumpRam();
+
+    template <class Archive>
+    void serialize(Archive& ar) {
+        ar(voices, mainVolume, cdVolume, extVolume, reverbVolume);
+        ar(irqAddress, dataAddress, currentDataAddress, dataTransferControl, control, SPUSTAT, captureBufferIndex);
+        ar(noise, _keyOn, _keyOff);
+        ar(pitchModulationRead, pitchModulationWrite, noiseEnabledRead, noiseEnabledWrite, reverbRead, reverbWrite, statusRead);
+        ar(ram, reverbBase, reverbRegisters, reverbCurrentAddress, reverbCounter, reverbLeft, reverbRight);
+        ar(bufferReady, audioBufferPos, audioBuffer);
+    }
 };
 }  // namespace spu
\ No newline at end of file
@@ -21,6 +21,8 @@ Voice::Voice() {
     reverb = false;
     adsrWaitCycles = 0;
     loadRepeatAddress = false;
+    flagsParsed = false;
+    sample = 0;
 
     prevSample[0] = prevSample[1] = 0;
 }
@@ -52,5 +52,13 @@ struct Voice {
 
     void keyOn();
     void keyOff();
+
+    template <class Archive>
+    void serialize(Archive& ar) {
+        ar(volume, sampleRate, startAddress, adsr, adsrVolume, repeatAddress, ignoreLoadRepeatAddress);
+        ar(currentAddress, counter, state, mode, pitchModulation, reverb);
+        ar(adsrWaitCycles, loopEnd, loadRepeatAddress, flagsParsed, sample, prevSample);
+        ar(decodedSamples, prevDecodedSamples);
+    }
 };
 }  // namespace spu
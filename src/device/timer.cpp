@@ -1,61 +1,56 @@
 #include "timer.h"
+#include <algorithm>
 #include "system.h"
+#include "utils/string.h"
 
 using namespace timer;
 
-Timer::Timer(System* sys, int which) : which(which), sys(sys) {}
+Timer::Timer(System* sys, int which) : which(which), sys(sys) {
+    event = sys->scheduler->addEvent(string_format("timer%d", which), [this] {
+        update();
+        scheduleIrq();
+    });
+}
 
-void Timer::step(int cycles) {
-    if (paused) return;
-    cnt += cycles;
-
-    uint32_t tval = current._reg;
-    if (which == 0) {
-        auto clock = static_cast<CounterMode::ClockSource0>(mode.clockSource & 1);
-        using modes = CounterMode::ClockSource0;
-
-        if (clock == modes::dotClock) {
-            tval += cnt / 6;
-            cnt %= 6;
-        } else {  // System Clock
-            tval += (int)(cnt / 1.5f);
-            cnt %= (int)1.5f;
-        }
-    } else if (which == 1) {
-        auto clock = static_cast<CounterMode::ClockSource1>(mode.clockSource & 1);
-        using modes = CounterMode::ClockSource1;
-
-        if (clock == modes::hblank) {
-            tval += cnt / 3413;
-            cnt %= 3413;
-        } else {  // System Clock
-            tval += (int)(cnt / 1.5f);
-            cnt %= (int)1.5f;
-        }
-    } else if (which == 2) {
-        auto clock = static_cast<CounterMode::ClockSource2>((mode.clockSource >> 1) & 1);
-        using modes = CounterMode::ClockSource2;
-
-        if (clock == modes::systemClock_8) {
-            tval += (int)(cnt / (8 * 1.5f));
-            cnt %= (int)(8 * 1.5f);
-        } else {  // System Clock
-            tval += (int)(cnt * 1.5f);
-            cnt %= (int)1.5f;
-        }
+std::pair<uint32_t, uint32_t> Timer::getClockRatio() const {
+    if (which == 0 && static_cast<CounterMode::ClockSource0>(mode.clockSource & 1) == CounterMode::ClockSource0::dotClock) {
+        return {1, 6};
+    }
+    if (which == 1 && static_cast<CounterMode::ClockSource1>(mode.clockSource & 1) == CounterMode::ClockSource1::hblank) {
+        return {1, gpu::CYCLES_PER_LINE};
+    }
+    if (which == 2 && static_cast<CounterMode::ClockSource2>((mode.clockSource >> 1) & 1) == CounterMode::ClockSource2::systemClock_8) {
+        return {1, 12};
     }
+    return {2, 3};  // System Clock
+}
+
+void Timer::update() {
+    uint64_t now = sys->scheduler->getTimestamp();
+    step(now - lastUpdate);
+    lastUpdate = now;
+}
+
+void Timer::step(uint64_t cycles) {
+    if (paused) return;
+
+    auto [num, den] = getClockRatio();
+    uint64_t clock = cnt + cycles * num;
+    cnt = clock % den;
+
+    uint64_t tval = current._reg + clock / den;
 
     bool possibleIrq = false;
 
     if (tval >= target._reg) {
         mode.reachedTarget = true;
-        if (mode.resetToZero == CounterMode::ResetToZero::whenTarget) tval = 0;
+        if (mode.resetToZero == CounterMode::ResetToZero::whenTarget) tval = target._reg == 0 ? 0 : tval % target._reg;
         if (mode.irqWhenTarget) possibleIrq = true;
     }
 
     if (tval >= 0xffff) {
         mode.reachedFFFF = true;
-        if (mode.resetToZero == CounterMode::ResetToZero::whenFFFF) tval = 0;
+        if (mode.resetToZero == CounterMode::ResetToZero::whenFFFF) tval %= 0xffff;
         if (mode.irqWhenFFFF) possibleIrq = true;
     }
 
@@ -64,6 +59,42 @@ void Timer::step(int cycles) {
     current._reg = (uint16_t)tval;
 }
 
+void Timer::scheduleIrq() {
+    bool irqPossible = mode.irqWhenTarget || mode.irqWhenFFFF;
+    if (mode.irqRepeatMode == CounterMode::IrqRepeatMode::oneShot && oneShotIrqOccured) irqPossible = false;
+    if (paused || !irqPossible) {
+        sys->scheduler->cancel(event);
+        return;
+    }
+
+    // Counter ticks to nearest target or 0xffff
+    uint32_t value = current._reg;
+    uint32_t ticks = 0xffff - value;
+    if (mode.irqWhenTarget) {
+        ticks = target._reg > value ? std::min<uint32_t>(ticks, target._reg - value) : ticks + target._reg;
+    }
+    if (ticks == 0) ticks = 1;
+
+    auto [num, den] = getClockRatio();
+    uint64_t cycles = (static_cast<uint64_t>(ticks) * den - cnt + num - 1) / num;
+    sys->scheduler->schedule(event, std::max<uint64_t>(cycles, 1));
+}
+
+void Timer::vblank() {
+    if (which != 1 || !mode.syncEnabled) return;
+
+    update();
+    auto mode1 = static_cast<timer::CounterMode::SyncMode1>(mode.syncMode);
+    using modes = timer::CounterMode::SyncMode1;
+    if (mode1 == modes::resetAtVblank || mode1 == modes::resetAtVblankAndPauseOutside) {
+        current._reg = 0;
+    } else if (mode1 == modes::pauseUntilVblankAndFreerun) {
+        paused = false;
+        mode.syncEnabled = false;
+    }
+    scheduleIrq();
+}
+
 void Timer::checkIrq() {
     if (mode.irqPulseMode == CounterMode::IrqPulseMode::toggle) {
         mode.interruptRequest = !mode.interruptRequest;
@@ -81,6 +112,7 @@ void Timer::checkIrq() {
 }
 
 uint8_t Timer::read(uint32_t address) {
+    update();
     if (address < 2) {
         return current.read(address);
     }
@@ -99,6 +131,7 @@ uint8_t Timer::read(uint32_t address) {
 }
 
 void Timer::write(uint32_t address, uint8_t data) {
+    update();
     if (address < 2) {
         current.write(address, data);
     } else if (address >= 4 && address < 6) {
@@ -136,4 +169,5 @@ void Timer::write(uint32_t address, uint8_t data) {
     } else if (address >= 8 && address < 10) {
         target.write(address - 8, data);
     }
+    scheduleIrq();
 }
@@ -1,7 +1,9 @@
 #pragma once
 #include <cassert>
+#include <utility>
 #include "device.h"
 #include "interrupt.h"
+#include "scheduler.h"
 
 namespace timer {
 union CounterMode {
@@ -77,11 +79,16 @@ class Timer {
     bool paused = false;
 
    private:
-    uint32_t cnt = 0;
+    uint32_t cnt = 0;  // Remainder of clock division
     bool oneShotIrqOccured = false;
 
     System* sys;
+    Scheduler::EventId event;
+    uint64_t lastUpdate = 0;
 
+    // Counter increments per system cycle (numerator, denominator)
+    std::pair<uint32_t, uint32_t> getClockRatio() const;
+    void step(uint64_t cycles);
     void checkIrq();
     interrupt::IrqNumber mapIrqNumber() const {
         if (which == 0) return interrupt::TIMER0;
@@ -93,8 +100,16 @@ class Timer {
 
    public:
     Timer(System* sys, int which);
-    void step() { step(1); }
-    void step(int cycles);
+    // Counter is updated lazily - on register access and when interrupt is due
+    void update();
+    void scheduleIrq();
+    // Called for every line in vblank
+    void vblank();
     uint8_t read(uint32_t address);
     void write(uint32_t address, uint8_t data);
+
+    template <class Archive>
+    void serialize(Archive& ar) {
+        ar(current, mode, target, paused, cnt, oneShotIrqOccured, lastUpdate);
+    }
 };
\ No newline at end of file
@@ -19,5 +19,8 @@ struct Disc {
     virtual Position getTrackStart(int track) const = 0;
     virtual Position getTrackLength(int track) const = 0;
     virtual Position getDiskSize() const = 0;
+
+    // Open image files again in forked process, inherited descriptors share seek position with parent
+    virtual void reopen() {}
 };
 }  // namespace disc
\ No newline at end of file
@@ -106,6 +106,16 @@ Sector Chd::read(Position pos) {
     return std::make_pair(data, type);
 }
 
+void Chd::reopen() {
+    chd_file* file;
+    if (chd_open(path.c_str(), CHD_OPEN_READ, nullptr, &file) != CHDERR_NONE) {
+        printf("[CHD] Unable to reopen file %s\n", path.c_str());
+        return;
+    }
+    chd_close(chdFile);
+    chdFile = file;
+}
+
 std::string Chd::getFile() const { return path; }
 
 size_t Chd::getTrackCount() const { return tracks.size(); }
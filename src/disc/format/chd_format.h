@@ -14,6 +14,7 @@ struct Chd : public Disc {
     ~Chd() override;
 
     Sector read(Position pos) override;
+    void reopen() override;
 
     std::string getFile() const override;
     size_t getTrackCount() const override;
@@ -74,6 +74,9 @@ disc::Sector Cue::read(Position pos) {
     return std::make_pair(buffer, type);
 }
 
+// Files are opened again on first read
+void Cue::reopen() { files.clear(); }
+
 std::unique_ptr<Cue> Cue::fromBin(const char* file) {
     auto size = getFileSize(file);
     if (size == 0) {
@@ -25,6 +25,7 @@ struct Cue : public Disc {
     int getTrackByPosition(Position pos) const override;
 
     disc::Sector read(Position pos) override;
+    void reopen() override;
 
    private:
     std::unordered_map<std::string, std::shared_ptr<FILE>> files;
@@ -0,0 +1,208 @@
+#include "fastmem.h"
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include "system.h"
+#include "utils/macros.h"
+
+#ifdef FASTMEM_AVAILABLE
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+// Accessor arguments (System*, address, [data], base) are left untouched until the access,
+// so faulting accessor can be replaced with tail call to the slow path.
+asm(R"(
+    .text
+    .globl fastmemRead8, fastmemRead16, fastmemRead32, fastmemWrite8, fastmemWrite16, fastmemWrite32
+    .hidden fastmemRead8, fastmemRead16, fastmemRead32, fastmemWrite8, fastmemWrite16, fastmemWrite32
+    .globl fastmemRead8Access, fastmemRead16Access, fastmemRead32Access
+    .globl fastmemWrite8Access, fastmemWrite16Access, fastmemWrite32Access
+    .hidden fastmemRead8Access, fastmemRead16Access, fastmemRead32Access
+    .hidden fastmemWrite8Access, fastmemWrite16Access, fastmemWrite32Access
+
+fastmemRead8:
+    movl %esi, %eax
+fastmemRead8Access:
+    movzbl (%rdx, %rax), %eax
+    ret
+
+fastmemRead16:
+    movl %esi, %eax
+fastmemRead16Access:
+    movzwl (%rdx, %rax), %eax
+    ret
+
+fastmemRead32:
+    movl %esi, %eax
+fastmemRead32Access:
+    movl (%rdx, %rax), %eax
+    ret
+
+fastmemWrite8:
+    movl %esi, %eax
+fastmemWrite8Access:
+    movb %dl, (%rcx, %rax)
+    ret
+
+fastmemWrite16:
+    movl %esi, %eax
+fastmemWrite16Access:
+    movw %dx, (%rcx, %rax)
+    ret
+
+fastmemWrite32:
+    movl %esi, %eax
+fastmemWrite32Access:
+    movl %edx, (%rcx, %rax)
+    ret
+)");
+
+extern "C" {
+extern const uint8_t fastmemRead8Access[], fastmemRead16Access[], fastmemRead32Access[];
+extern const uint8_t fastmemWrite8Access[], fastmemWrite16Access[], fastmemWrite32Access[];
+}
+#endif
+
+namespace fastmem {
+#ifdef FASTMEM_AVAILABLE
+namespace {
+template <typename T>
+T readSlow(System* sys, uint32_t address) {
+    return sys->readSlow<T>(address);
+}
+
+template <typename T>
+void writeSlow(System* sys, uint32_t address, T data) {
+    sys->writeSlow<T>(address, data);
+}
+
+struct AccessSite {
+    const void* access;
+    const void* slowPath;
+};
+
+const AccessSite sites[] = {
+    {fastmemRead8Access, reinterpret_cast<const void*>(&readSlow<uint8_t>)},
+    {fastmemRead16Access, reinterpret_cast<const void*>(&readSlow<uint16_t>)},
+    {fastmemRead32Access, reinterpret_cast<const void*>(&readSlow<uint32_t>)},
+    {fastmemWrite8Access, reinterpret_cast<const void*>(&writeSlow<uint8_t>)},
+    {fastmemWrite16Access, reinterpret_cast<const void*>(&writeSlow<uint16_t>)},
+    {fastmemWrite32Access, reinterpret_cast<const void*>(&writeSlow<uint32_t>)},
+};
+
+struct sigaction previousHandler;
+
+void faultHandler(int sig, siginfo_t* info, void* context) {
+    auto& rip = static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_RIP];
+    for (const auto& site : sites) {
+        if (rip == reinterpret_cast<greg_t>(site.access)) {
+            rip = reinterpret_cast<greg_t>(site.slowPath);
+            return;
+        }
+    }
+
+    // Not a guest memory access
+    if (previousHandler.sa_flags & SA_SIGINFO) {
+        previousHandler.sa_sigaction(sig, info, context);
+    } else if (previousHandler.sa_handler == SIG_DFL || previousHandler.sa_handler == SIG_IGN) {
+        signal(sig, SIG_DFL);  // Instruction will fault again and crash
+    } else {
+        previousHandler.sa_handler(sig);
+    }
+}
+
+void installFaultHandler() {
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+        struct sigaction action = {};
+        action.sa_sigaction = faultHandler;
+        action.sa_flags = SA_SIGINFO | SA_NODEFER;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGSEGV, &action, &previousHandler);
+    });
+}
+
+uint8_t* reserve(size_t size) {
+    void* ptr = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : static_cast<uint8_t*>(ptr);
+}
+};  // namespace
+
+Fastmem::Fastmem(size_t size) : size(size) {
+    fd = memfd_create("avocado", 0);
+    if (fd < 0 || ftruncate(fd, size) != 0) {
+        printf("[FASTMEM] Unable to create shared memory\n");
+        return;
+    }
+
+    base = reserve(WINDOW_SIZE);
+    emptyBase = reserve(WINDOW_SIZE);
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == nullptr || emptyBase == nullptr || ptr == MAP_FAILED) {
+        printf("[FASTMEM] Unable to reserve address space\n");
+        return;
+    }
+
+    installFaultHandler();
+    memory = static_cast<uint8_t*>(ptr);
+}
+
+Fastmem::~Fastmem() {
+    if (memory != nullptr) munmap(memory, size);
+    if (base != nullptr) munmap(base, WINDOW_SIZE);
+    if (emptyBase != nullptr) munmap(emptyBase, WINDOW_SIZE);
+    if (fd >= 0) close(fd);
+}
+
+bool Fastmem::map(uint32_t address, size_t offset, size_t size, bool writable) {
+    int prot = PROT_READ | (writable ? PROT_WRITE : 0);
+    return mmap(base + address, size, prot, MAP_SHARED | MAP_FIXED, fd, offset) != MAP_FAILED;
+}
+
+void Fastmem::setWriteProtection(uint32_t address, size_t size, bool protect) {
+    mprotect(base + address, size, PROT_READ | (protect ? 0 : PROT_WRITE));
+}
+
+bool Fastmem::unshare() {
+    int newFd = memfd_create("avocado", 0);
+    if (newFd < 0 || ftruncate(newFd, size) != 0) {
+        if (newFd >= 0) close(newFd);
+        return false;
+    }
+
+    void* copy = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, newFd, 0);
+    if (copy == MAP_FAILED) {
+        close(newFd);
+        return false;
+    }
+    memcpy(copy, memory, size);
+    munmap(copy, size);
+
+    if (mmap(memory, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, newFd, 0) == MAP_FAILED) {
+        close(newFd);
+        return false;
+    }
+    close(fd);
+    fd = newFd;
+    return true;
+}
+#else
+Fastmem::Fastmem(size_t size) { UNUSED(size); }
+Fastmem::~Fastmem() = default;
+bool Fastmem::map(uint32_t address, size_t offset, size_t size, bool writable) {
+    UNUSED(address);
+    UNUSED(offset);
+    UNUSED(size);
+    UNUSED(writable);
+    return false;
+}
+void Fastmem::setWriteProtection(uint32_t address, size_t size, bool protect) {
+    UNUSED(address);
+    UNUSED(size);
+    UNUSED(protect);
+}
+bool Fastmem::unshare() { return false; }
+#endif
+};  // namespace fastmem
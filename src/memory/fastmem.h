@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// See ENABLE_FASTMEM in system.h
+#if defined(ENABLE_FASTMEM) && defined(__linux__) && defined(__x86_64__)
+#define FASTMEM_AVAILABLE
+#endif
+
+struct System;
+
+namespace fastmem {
+/**
+ * Shared memory block mapped into 4GB host window, guest address + base = host address.
+ * RAM mirrors are mapped multiple times, so RAM access is a single host load or store.
+ * Everything that is not mapped (IO, protected pages) faults, SIGSEGV handler
+ * redirects faulting accessor to System::readSlow/writeSlow.
+ */
+class Fastmem {
+   public:
+    Fastmem(size_t size);
+    ~Fastmem();
+
+    bool isValid() const { return memory != nullptr; }
+
+    // Backing storage, always writable
+    uint8_t* getMemory() const { return memory; }
+    // Window with all mapped regions
+    uint8_t* getBase() const { return base; }
+    // Window with nothing mapped, used for writes when cache is isolated
+    uint8_t* getEmptyBase() const { return emptyBase; }
+
+    // Map size bytes of memory at offset to guest address
+    bool map(uint32_t address, size_t offset, size_t size, bool writable);
+    // Writes to protected pages fault (size and address must be aligned to host page)
+    void setWriteProtection(uint32_t address, size_t size, bool protect);
+    // Move contents to new private shared memory (forked process would share it with parent otherwise),
+    // backing storage stays at the same address, window mappings have to be created again
+    bool unshare();
+
+   private:
+    static const size_t WINDOW_SIZE = 0x100000000;
+
+    int fd = -1;
+    size_t size = 0;
+    uint8_t* memory = nullptr;
+    uint8_t* base = nullptr;
+    uint8_t* emptyBase = nullptr;
+};
+
+#ifdef FASTMEM_AVAILABLE
+extern "C" {
+// Accessors used by System, implemented in assembly so fault handler can recognize them
+uint8_t fastmemRead8(System* sys, uint32_t address, uint8_t* base);
+uint16_t fastmemRead16(System* sys, uint32_t address, uint8_t* base);
+uint32_t fastmemRead32(System* sys, uint32_t address, uint8_t* base);
+void fastmemWrite8(System* sys, uint32_t address, uint8_t data, uint8_t* base);
+void fastmemWrite16(System* sys, uint32_t address, uint16_t data, uint8_t* base);
+void fastmemWrite32(System* sys, uint32_t address, uint32_t data, uint8_t* base);
+}
+
+template <typename T>
+T read(System* sys, uint32_t address, uint8_t* base) {
+    if (sizeof(T) == 1) return fastmemRead8(sys, address, base);
+    if (sizeof(T) == 2) return fastmemRead16(sys, address, base);
+    return fastmemRead32(sys, address, base);
+}
+
+template <typename T>
+void write(System* sys, uint32_t address, T data, uint8_t* base) {
+    if (sizeof(T) == 1) return fastmemWrite8(sys, address, data, base);
+    if (sizeof(T) == 2) return fastmemWrite16(sys, address, data, base);
+    return fastmemWrite32(sys, address, data, base);
+}
+#endif
+};  // namespace fastmem
@@ -1,45 +1,385 @@
-#include <cassert>
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <iostream>
 #include <memory>
+#include <sstream>
 #include <string>
-#include "mips.h"
+#include <vector>
+#include "config.h"
+#include "device/gpu/frame_skip.h"
+#include "state/movie.h"
+#include "state/rewind.h"
+#include "state/run_ahead.h"
+#include "system.h"
 #include "utils/file.h"
+#include "utils/loader.h"
 
-int main(int argc, char **argv) {
-    if (argc < 2) {
-        printf("usage: Avocado psx.exe\n");
-        return 1;
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/wait.h>
+#include <unistd.h>
+#define SERVER_AVAILABLE
+#endif
+
+namespace {
+// Single run, in server mode every line of stdin is a separate job
+struct Job {
+    std::string output;
+    int frames = 0;
+    double seconds = 0;
+    int rewindMb = 0;
+    int runAhead = 0;
+    int frameSkip = 0;
+    bool frameSkipAuto = false;
+    double cpuMultiplier = 0;  // 0 - from config
+    std::string replay;  // Movie
+    std::string script;
+    std::string record;
+};
+
+struct Options {
+    std::string file;
+    std::string bios;
+    Job job;
+    bool server = false;
+    int jobs = 1;
+    int warmup = 0;
+};
+
+void printUsage() {
+    printf(
+        "usage: avocado [options] file\n"
+        "  Boots BIOS with disc image (cue, bin, iso, img, chd), exe or psf and reports emulation speed as JSON\n"
+        "  --bios path     BIOS image (default: bios from config.json)\n"
+        "  --frames n      Stop after n frames (default: 600)\n"
+        "  --seconds n     Stop after n seconds of host time\n"
+        "  --output path   Write report to file instead of stdout\n"
+        "  --rewind mb     Capture rewind states every frame within given memory budget and report their cost\n"
+        "  --run-ahead n   Run n frames ahead after every frame and report frame time headroom\n"
+        "  --frameskip n   Present every (n + 1)th frame, rasterize skipped frames only where needed\n"
+        "  --auto-frameskip n  Skip up to n frames while emulation is slower than real time\n"
+        "  --cpu-multiplier x  Run x times more CPU instructions per emulated second, devices keep their timing\n"
+        "  --replay path   Replay input movie (starts from the state it was recorded from)\n"
+        "  --script path   Replay input script, eg. \"600 press start\" and \"700 hold right 120\" lines\n"
+        "  --record path   Record input movie, with --script converts script to movie\n"
+        "\n"
+        "  --server        Boot once, then fork worker for every line of stdin, lines contain job options\n"
+        "                  (--frames, --seconds, --output, --rewind, --run-ahead, --frameskip, --auto-frameskip,\n"
+        "                  --cpu-multiplier, --replay, --script, --record), children share untouched memory copy-on-write\n"
+        "  --jobs n        Number of workers running at once (default: 1)\n"
+        "  --warmup n      Frames emulated before first fork, eg. disc boot (default: 0)\n");
+}
+
+// Returns number of consumed arguments, 0 if arg is not a job option
+int parseJobArgument(const std::vector<std::string>& args, size_t i, Job& job) {
+    if (i + 1 >= args.size()) return 0;
+    if (args[i] == "--frames") {
+        job.frames = std::max(0, atoi(args[i + 1].c_str()));
+    } else if (args[i] == "--seconds") {
+        job.seconds = std::max(0.0, atof(args[i + 1].c_str()));
+    } else if (args[i] == "--output") {
+        job.output = args[i + 1];
+    } else if (args[i] == "--rewind") {
+        job.rewindMb = std::max(0, atoi(args[i + 1].c_str()));
+    } else if (args[i] == "--run-ahead") {
+        job.runAhead = std::max(0, atoi(args[i + 1].c_str()));
+    } else if (args[i] == "--frameskip" || args[i] == "--auto-frameskip") {
+        job.frameSkip = std::max(0, atoi(args[i + 1].c_str()));
+        job.frameSkipAuto = args[i] == "--auto-frameskip";
+    } else if (args[i] == "--cpu-multiplier") {
+        job.cpuMultiplier = std::max(0.0, atof(args[i + 1].c_str()));
+    } else if (args[i] == "--replay") {
+        job.replay = args[i + 1];
+    } else if (args[i] == "--script") {
+        job.script = args[i + 1];
+    } else if (args[i] == "--record") {
+        job.record = args[i + 1];
+    } else {
+        return 0;
+    }
+    return 2;
+}
+
+void setDefaults(Job& job) {
+    if (job.frames == 0 && job.seconds == 0) job.frames = 600;
+}
+
+bool parseArguments(int argc, char** argv, Options& options) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    for (size_t i = 0; i < args.size(); i++) {
+        const std::string& arg = args[i];
+        bool hasValue = i + 1 < args.size();
+        if (int consumed = parseJobArgument(args, i, options.job)) {
+            i += consumed - 1;
+        } else if (arg == "--bios" && hasValue) {
+            options.bios = args[++i];
+        } else if (arg == "--server") {
+            options.server = true;
+        } else if (arg == "--jobs" && hasValue) {
+            options.jobs = std::max(1, atoi(args[++i].c_str()));
+        } else if (arg == "--warmup" && hasValue) {
+            options.warmup = std::max(0, atoi(args[++i].c_str()));
+        } else if (arg.rfind("--", 0) == 0 || !options.file.empty()) {
+            return false;
+        } else {
+            options.file = arg;
+        }
+    }
+    setDefaults(options.job);
+    return !options.file.empty();
+}
+
+bool parseJob(const std::string& line, Job& job) {
+    std::vector<std::string> args;
+    std::istringstream stream(line);
+    for (std::string arg; stream >> arg;) args.push_back(arg);
+
+    for (size_t i = 0; i < args.size(); i++) {
+        int consumed = parseJobArgument(args, i, job);
+        if (consumed == 0) return false;
+        i += consumed - 1;
+    }
+    setDefaults(job);
+    return true;
+}
+
+// FNV-1a of RAM and VRAM, equal for runs with identical results
+uint64_t hashMemory(System* sys) {
+    uint64_t hash = 0xcbf29ce484222325;
+    auto add = [&](const void* data, size_t size) {
+        auto bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 0x100000001b3;
+    };
+    add(sys->ram, System::RAM_SIZE);
+    add(sys->gpu->vram.data(), sys->gpu->vram.size() * sizeof(uint16_t));
+    return hash;
+}
+
+// Runs from current state and writes the report, returns process exit code
+int run(System* sys, const std::string& file, const Job& job, bool compact) {
+    state::Movie replay, record;
+    if (!job.replay.empty() || !job.script.empty()) {
+        bool loaded = job.replay.empty() ? replay.loadScript(job.script) : replay.load(job.replay);
+        if (!loaded || !replay.startReplay(sys)) return 1;
+    }
+    if (!job.record.empty()) record.startRecording(sys);
+
+    if (job.cpuMultiplier != 0) sys->scheduler->setCpuMultiplier(job.cpuMultiplier);
+
+    // Time spent booting exe and psf files is not measured
+    sys->scheduler->profiling = true;
+    uint64_t startTimestamp = sys->scheduler->getTimestamp();
+
+    std::unique_ptr<state::Rewind> rewind;
+    if (job.rewindMb != 0) rewind = std::make_unique<state::Rewind>(static_cast<size_t>(job.rewindMb) * 1024 * 1024);
+
+    // Always active, headroom shows whether automatic mode would enable it
+    std::unique_ptr<state::RunAhead> runAhead;
+    if (job.runAhead != 0) runAhead = std::make_unique<state::RunAhead>(job.runAhead, false);
+
+    // Presented frames are rasterized as usual, skipped ones only where emulated program depends on the result
+    std::unique_ptr<gpu::FrameSkip> frameSkip;
+    if (job.frameSkip != 0) frameSkip = std::make_unique<gpu::FrameSkip>(job.frameSkip, job.frameSkipAuto);
+
+    int frames = 0;
+    double seconds = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (sys->state == System::State::run) {
+        if (job.frames != 0 && frames >= job.frames) break;
+        if (job.seconds != 0 && seconds >= job.seconds) break;
+
+        replay.update(sys);
+        record.update(sys);
+        bool present = !frameSkip || frameSkip->beginFrame(sys);
+        if (runAhead && present) {
+            runAhead->runFrame(sys);
+            runAhead->restore(sys);
+        } else {
+            sys->emulateFrame();
+        }
+        if (frameSkip) frameSkip->endFrame(sys);
+        if (rewind) rewind->frameEmulated(sys);
+        frames++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
     }
-    std::unique_ptr<mips::CPU> cpu = std::make_unique<mips::CPU>();
 
-    if (!cpu->loadBios("SCPH1001.BIN")) {
+    double emulatedSeconds = (sys->scheduler->getTimestamp() - startTimestamp) / static_cast<double>(System::SYSTEM_CLOCK);
+    // No frames were run (--frames 0 or halted system), JSON can't hold inf or NaN
+    auto perSecond = [&](double value) { return seconds > 0 ? value / seconds : 0.0; };
+
+    json subsystems = json::object();
+    subsystems["cpu"] = {{"seconds", sys->cpuSeconds}, {"percent", 100.0 * perSecond(sys->cpuSeconds)}};
+    for (auto& event : sys->scheduler->getStats()) {
+        subsystems[event.name] = {
+            {"calls", event.calls},
+            {"seconds", event.seconds},
+            {"percent", 100.0 * perSecond(event.seconds)},
+        };
+    }
+
+    if (!job.record.empty() && !record.save(job.record)) return 1;
+
+    // Skipping frames doesn't change emulation, hash matches the run without it
+    sys->gpu->flushDeferred();
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(hashMemory(sys)));
+
+    json report = {
+        {"file", getFilenameExt(file)},
+        {"frames", frames},
+        {"seconds", seconds},
+        {"emulatedSeconds", emulatedSeconds},
+        {"fps", perSecond(frames)},
+        {"speed", perSecond(emulatedSeconds)},  // 1.0 - real hardware speed
+        {"halted", sys->state != System::State::run},
+        {"cpu", {{"multiplier", sys->scheduler->getCpuMultiplier()}, {"mips", sys->scheduler->getInstructionRate() / 1e6}}},
+        {"render",
+         {{"threads", sys->gpu->getRenderThreads()},
+          {"batches", sys->gpu->batchStats.batches},
+          {"primitives", sys->gpu->batchStats.primitives},
+          {"tiles", sys->gpu->batchStats.tiles}}},
+        {"subsystems", subsystems},
+        {"hash", hash},
+    };
+
+    if (!job.replay.empty() || !job.script.empty()) {
+        report["movie"] = {{"frames", replay.getLength()}, {"replayed", replay.getFrame()}};
+    }
+
+    if (rewind) {
+        auto stats = rewind->getStats();
+        report["rewind"] = {
+            {"entries", stats.entries},
+            {"memoryUsed", stats.memoryUsed},
+            {"memoryBudget", stats.memoryBudget},
+            {"captured", stats.captured},
+            {"dropped", stats.dropped},
+            {"compressionRatio", stats.compressionRatio},
+            {"captureMs", stats.captureMs},
+            {"compressMs", stats.compressMs},
+            {"percent", 100.0 * perSecond(stats.captured * stats.captureMs / 1000.0)},  // Of emulation thread time
+        };
+    }
+
+    if (runAhead) {
+        auto stats = runAhead->getStats();
+        report["runAhead"] = {
+            {"frames", stats.frames},
+            {"frameMs", stats.frameMs},
+            {"snapshotMs", stats.snapshotMs},
+            {"budgetMs", stats.budgetMs},
+            {"headroom", stats.headroom},
+        };
+    }
+
+    if (frameSkip) {
+        auto stats = frameSkip->getStats();
+        auto& primitives = sys->gpu->deferStats;
+        report["frameSkip"] = {
+            {"frames", stats.frames},
+            {"automatic", stats.automatic},
+            {"skip", stats.skip},
+            {"presented", stats.presented},
+            {"skipped", stats.skipped},
+            {"renderedMs", stats.renderedMs},
+            {"skippedMs", stats.skippedMs},
+            {"budgetMs", stats.budgetMs},
+            {"primitives", {{"deferred", primitives.deferred}, {"dropped", primitives.dropped}, {"flushed", primitives.flushed}}},
+        };
+    }
+
+    // Workers share stdout, one line per report keeps them apart
+    std::string text = compact ? report.dump() : report.dump(4);
+    if (job.output.empty()) {
+        printf("%s\n", text.c_str());
+    } else if (!putFileContents(job.output, text)) {
+        printf("Cannot write %s\n", job.output.c_str());
         return 1;
     }
+    return 0;
+}
+
+#ifdef SERVER_AVAILABLE
+// Parent stays at booted state and is never run, every job starts from the same snapshot
+int serve(System* sys, const Options& options) {
+    for (int i = 0; i < options.warmup && sys->state == System::State::run; i++) sys->emulateFrame();
+    sys->gpu->stopRenderThreads();  // Workers start their own
+
+    int running = 0;
+    int failed = 0;
+    auto waitForWorker = [&] {
+        int status;
+        if (wait(&status) < 0) return;
+        running--;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed++;
+    };
 
-    // Breakpoint on BIOS Shell execution
-    cpu->breakpoints.emplace(0x80030000, mips::CPU::Breakpoint(true));
+    for (std::string line; std::getline(std::cin, line);) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
 
-    cpu->biosLog = false;
-    cpu->debugOutput = false;
+        Job job;
+        if (!parseJob(line, job)) {
+            printf("Invalid job: %s\n", line.c_str());
+            failed++;
+            continue;
+        }
 
-    // Emulate BIOS to GUI breakpoint
-    while (cpu->state == mips::CPU::State::run) {
-        cpu->emulateFrame();
+        if (running >= options.jobs) waitForWorker();
+
+        fflush(stdout);  // Buffered output would be written by child as well
+        pid_t pid = fork();
+        if (pid < 0) {
+            printf("Cannot fork worker\n");
+            failed++;
+            break;
+        }
+        if (pid == 0) {
+            int code = 1;
+            if (sys->unshareMemory()) {
+                if (sys->cdrom->disc) sys->cdrom->disc->reopen();
+                code = run(sys, options.file, job, true);
+            }
+            fflush(stdout);
+            _exit(code);
+        }
+        running++;
     }
 
-    if (!cpu->loadExeFile(argv[1])) {
-        printf("Cannot load %s\n", argv[1]);
+    while (running > 0) waitForWorker();
+    return failed == 0 ? 0 : 1;
+}
+#endif
+};  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage();
         return 1;
     }
-    printf("File %s loaded\n", getFilenameExt(argv[1]).c_str());
 
-    cpu->state = mips::CPU::State::run;
-    cpu->debugOutput = false;
-    cpu->setPC(cpu->readMemory32(0x1f000000));
+    if (!getFileContents(CONFIG_NAME).empty()) loadConfigFile(CONFIG_NAME);
+    config["debug"]["log"]["system"] = 0;
+    if (options.bios.empty()) options.bios = config["bios"];
 
-    while (cpu->state == mips::CPU::State::run) {
-        cpu->emulateFrame();
+    auto sys = std::make_unique<System>();
+    if (options.bios.empty() || !sys->loadBios(options.bios)) {
+        printf("No BIOS, use --bios or set it in %s\n", CONFIG_NAME);
+        return 1;
+    }
+    if (!loadFile(sys.get(), options.file)) {
+        printf("Cannot load %s\n", options.file.c_str());
+        return 1;
     }
 
-    return 0;
+    if (options.server) {
+#ifdef SERVER_AVAILABLE
+        return serve(sys.get(), options);
+#else
+        printf("Server mode is not available on this platform\n");
+        return 1;
+#endif
+    }
+    return run(sys.get(), options.file, options.job, false);
 }
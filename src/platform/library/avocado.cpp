@@ -0,0 +1,231 @@
+#include "avocado.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "config.h"
+#include "device/controller/peripherals/analog_controller.h"
+#include "system.h"
+#include "utils/loader.h"
+
+namespace {
+struct Instance {
+    std::unique_ptr<System> sys;
+    int16_t* audio = nullptr;  // Destination of current step
+    int audioSamples = 0;
+};
+
+// Displayed part of VRAM converted to 0xAABBGGRR
+void copyDisplay(gpu::GPU* gpu, uint32_t* output, int& width, int& height) {
+    width = std::min(gpu->gp1_08.getHorizontalResoulution(), AVOCADO_FRAMEBUFFER_WIDTH);
+    height = std::min(gpu->gp1_08.getVerticalResoulution(), AVOCADO_FRAMEBUFFER_HEIGHT);
+
+    for (int y = 0; y < height; y++) {
+        uint32_t* dst = output + y * AVOCADO_FRAMEBUFFER_WIDTH;
+        if (gpu->displayDisable) {
+            std::fill(dst, dst + width, 0xff000000);
+            continue;
+        }
+
+        int vy = (gpu->displayAreaStartY + y) % gpu::VRAM_HEIGHT;
+        const uint16_t* row = &gpu->vram[vy * gpu::VRAM_WIDTH];
+        if (gpu->gp1_08.colorDepth == gpu::GP1_08::ColorDepth::bit24) {
+            // Pixels are packed as 3 bytes, display start is given in 16bit units
+            auto bytes = reinterpret_cast<const uint8_t*>(row);
+            const int rowBytes = gpu::VRAM_WIDTH * 2;
+            for (int x = 0, offset = gpu->displayAreaStartX * 2; x < width; x++, offset += 3) {
+                uint32_t r = bytes[offset % rowBytes];
+                uint32_t g = bytes[(offset + 1) % rowBytes];
+                uint32_t b = bytes[(offset + 2) % rowBytes];
+                dst[x] = 0xff000000 | (b << 16) | (g << 8) | r;
+            }
+        } else {
+            for (int x = 0; x < width; x++) {
+                uint16_t pixel = row[(gpu->displayAreaStartX + x) % gpu::VRAM_WIDTH];
+                uint32_t r = pixel & 0x1f;
+                uint32_t g = (pixel >> 5) & 0x1f;
+                uint32_t b = (pixel >> 10) & 0x1f;
+                r = (r << 3) | (r >> 2);
+                g = (g << 3) | (g >> 2);
+                b = (b << 3) | (b >> 2);
+                dst[x] = 0xff000000 | (b << 16) | (g << 8) | r;
+            }
+        }
+    }
+}
+
+void applyPad(System* sys, int port, const avocado_pad& pad) {
+    auto device = sys->controller->controller[port].get();
+    if (auto digital = dynamic_cast<peripherals::DigitalController*>(device)) {
+        digital->setButtons(pad.buttons);
+    }
+    if (auto analog = dynamic_cast<peripherals::AnalogController*>(device)) {
+        analog->left.x = pad.left_x;
+        analog->left.y = pad.left_y;
+        analog->right.x = pad.right_x;
+        analog->right.y = pad.right_y;
+    }
+}
+};  // namespace
+
+struct avocado_batch {
+    std::vector<Instance> instances;
+
+    // Arguments of current task, read by all workers
+    const avocado_pad* pads = nullptr;
+    uint32_t* framebuffers = nullptr;
+    int16_t* audio = nullptr;
+    avocado_frame_info* info = nullptr;
+    const char* path = nullptr;
+    std::atomic<int> failed{0};
+
+    // Thread pool, calling thread takes instances as well
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable started, finished;
+    void (*task)(avocado_batch* batch, int index) = nullptr;
+    uint64_t generation = 0;
+    int pending = 0;  // Workers still running current task
+    std::atomic<int> next{0};
+    bool quit = false;
+
+    void work() {
+        for (int i; (i = next.fetch_add(1)) < static_cast<int>(instances.size());) task(this, i);
+    }
+
+    void workerLoop() {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                started.wait(lock, [&] { return quit || generation != seen; });
+                if (quit) return;
+                seen = generation;
+            }
+            work();
+            std::unique_lock<std::mutex> lock(mutex);
+            if (--pending == 0) finished.notify_one();
+        }
+    }
+
+    void run(void (*newTask)(avocado_batch* batch, int index)) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            task = newTask;
+            next = 0;
+            pending = static_cast<int>(workers.size());
+            generation++;
+        }
+        started.notify_all();
+        work();
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return pending == 0; });
+    }
+
+    ~avocado_batch() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            quit = true;
+        }
+        started.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+};
+
+namespace {
+void loadInstance(avocado_batch* batch, int index) {
+    if (!loadFile(batch->instances[index].sys.get(), batch->path)) batch->failed++;
+}
+
+void stepInstance(avocado_batch* batch, int index) {
+    Instance& instance = batch->instances[index];
+    System* sys = instance.sys.get();
+
+    if (batch->pads != nullptr) {
+        for (int port = 0; port < AVOCADO_PORTS; port++) applyPad(sys, port, batch->pads[index * AVOCADO_PORTS + port]);
+    }
+
+    instance.audio = batch->audio != nullptr ? batch->audio + static_cast<size_t>(index) * AVOCADO_AUDIO_CAPACITY : nullptr;
+    instance.audioSamples = 0;
+    if (sys->state == System::State::run) sys->emulateFrame();
+
+    int width = 0, height = 0;
+    if (batch->framebuffers != nullptr) {
+        uint32_t* framebuffer = batch->framebuffers + static_cast<size_t>(index) * AVOCADO_FRAMEBUFFER_WIDTH * AVOCADO_FRAMEBUFFER_HEIGHT;
+        copyDisplay(sys->gpu.get(), framebuffer, width, height);
+    }
+    if (batch->info != nullptr) {
+        auto& info = batch->info[index];
+        info.width = width;
+        info.height = height;
+        info.audio_samples = instance.audioSamples;
+        info.running = sys->state == System::State::run;
+    }
+}
+};  // namespace
+
+avocado_batch* avocado_create(int count, const char* bios, const char* options, int threads) {
+    if (count <= 0 || bios == nullptr) return nullptr;
+
+    json instanceConfig = defaultConfig;
+    if (options != nullptr) {
+        try {
+            instanceConfig.merge_patch(json::parse(options));
+        } catch (json::exception& e) {
+            printf("[AVOCADO] Invalid options: %s\n", e.what());
+            return nullptr;
+        }
+    }
+    // Display is read from VRAM
+    instanceConfig["options"]["graphics"]["rendering_mode"] = RenderingMode::SOFTWARE;
+    instanceConfig["debug"]["log"]["system"] = 0;
+    // Instances are already stepped in parallel, tiled rendering would start threads for each of them
+    instanceConfig["options"]["graphics"]["render_threads"] = 1;
+
+    auto batch = std::make_unique<avocado_batch>();
+    batch->instances.resize(count);
+    for (auto& instance : batch->instances) {
+        instance.sys = std::make_unique<System>(instanceConfig);
+        if (!instance.sys->loadBios(bios)) return nullptr;
+
+        Instance* self = &instance;
+        instance.sys->audioCallback = [self](const int16_t* samples, size_t size) {
+            if (self->audio == nullptr) return;
+            size_t n = std::min(size, static_cast<size_t>(AVOCADO_AUDIO_CAPACITY - self->audioSamples));
+            std::copy(samples, samples + n, self->audio + self->audioSamples);
+            self->audioSamples += static_cast<int>(n);
+        };
+    }
+
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, count);
+    for (int i = 1; i < threads; i++) {
+        batch->workers.emplace_back([b = batch.get()] { b->workerLoop(); });
+    }
+    return batch.release();
+}
+
+void avocado_destroy(avocado_batch* batch) { delete batch; }
+
+int avocado_count(const avocado_batch* batch) { return static_cast<int>(batch->instances.size()); }
+
+int avocado_load(avocado_batch* batch, const char* path) {
+    batch->path = path;
+    batch->failed = 0;
+    batch->run(loadInstance);
+    return batch->failed == 0 ? 0 : -1;
+}
+
+int avocado_step(avocado_batch* batch, const avocado_pad* pads, uint32_t* framebuffers, int16_t* audio, avocado_frame_info* info) {
+    batch->pads = pads;
+    batch->framebuffers = framebuffers;
+    batch->audio = audio;
+    batch->info = info;
+    batch->run(stepInstance);
+
+    int running = 0;
+    for (auto& instance : batch->instances) running += instance.sys->state == System::State::run;
+    return running;
+}
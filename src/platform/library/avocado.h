@@ -0,0 +1,71 @@
+#pragma once
+/**
+ * C interface for driving many emulator instances from other languages (test runners, agent training).
+ * All instances of a batch are stepped one frame at the same time on a thread pool,
+ * outputs are written into caller provided buffers, no allocations are done after avocado_create.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#define AVOCADO_API __declspec(dllexport)
+#else
+#define AVOCADO_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Framebuffer of every instance, displayed area is written to top left corner, rest is left untouched
+#define AVOCADO_FRAMEBUFFER_WIDTH 640
+#define AVOCADO_FRAMEBUFFER_HEIGHT 480
+// Interleaved stereo 16bit samples at 44100Hz per instance (one PAL frame fits), excess is dropped
+#define AVOCADO_AUDIO_CAPACITY 2048
+
+#define AVOCADO_PORTS 2
+
+typedef struct avocado_batch avocado_batch;
+
+typedef struct {
+    uint16_t buttons;  // Pressed buttons, bit 0 - select ... bit 15 - square (order used by console)
+
+    // Analog controller only, 0x00 - left/up, 0x80 - center, 0xff - right/down
+    uint8_t left_x, left_y;
+    uint8_t right_x, right_y;
+} avocado_pad;
+
+typedef struct {
+    int32_t width, height;  // Displayed area written to framebuffer
+    int32_t audio_samples;  // Number of int16_t values written to audio buffer
+    int32_t running;        // 0 if instance was halted (it is not stepped anymore)
+} avocado_frame_info;
+
+/**
+ * Creates count instances with given BIOS image.
+ * options - JSON merged into default configuration (same format as config.json), can be NULL
+ * threads - thread pool size (calling thread included), 0 for number of cores
+ * Instances render on the thread that steps them, options.graphics.render_threads is ignored.
+ * Returns NULL on failure.
+ */
+AVOCADO_API avocado_batch* avocado_create(int count, const char* bios, const char* options, int threads);
+AVOCADO_API void avocado_destroy(avocado_batch* batch);
+AVOCADO_API int avocado_count(const avocado_batch* batch);
+
+// Loads disc image (cue, bin, iso, img, chd), exe or psf into every instance, returns 0 on success
+AVOCADO_API int avocado_load(avocado_batch* batch, const char* path);
+
+/**
+ * Emulates one frame on every instance.
+ * pads         - count * AVOCADO_PORTS entries, NULL keeps previous state
+ * framebuffers - count * AVOCADO_FRAMEBUFFER_WIDTH * AVOCADO_FRAMEBUFFER_HEIGHT pixels (0xAABBGGRR), can be NULL
+ * audio        - count * AVOCADO_AUDIO_CAPACITY samples, can be NULL
+ * info         - count entries, can be NULL
+ * Returns number of instances still running.
+ */
+AVOCADO_API int avocado_step(avocado_batch* batch, const avocado_pad* pads, uint32_t* framebuffers, int16_t* audio,
+                             avocado_frame_info* info);
+
+#ifdef __cplusplus
+}
+#endif
@@ -403,11 +403,11 @@ void gpuLogWindow(System *sys) {
 }
 
 void ioLogWindow(System *sys) {
-#ifdef ENABLE_IO_LOG
     if (!ioLogEnabled) {
         return;
     }
     ImGui::Begin("IO Log", &ioLogEnabled, ImVec2(200, 400));
+    sys->ioLog = ioLogEnabled;
 
     ImGui::BeginChild("IO Log", ImVec2(0, -ImGui::GetItemsLineHeightWithSpacing()), false, ImGuiWindowFlags_HorizontalScrollbar);
     ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
@@ -427,7 +427,6 @@ void ioLogWindow(System *sys) {
     ImGui::EndChild();
 
     ImGui::End();
-#endif
 }
 
 void vramWindow(gpu::GPU *gpu) {
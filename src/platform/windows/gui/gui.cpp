@@ -103,9 +103,9 @@ void renderImgui(System* sys) {
                 if (ImGui::MenuItem("BIOS calls log", nullptr, (bool*)&sys->biosLog)) {
                     config["debug"]["log"]["bios"] = sys->biosLog;
                 }
-#ifdef ENABLE_IO_LOG
-                ImGui::MenuItem("IO log", nullptr, &ioLogEnabled);
-#endif
+                if (ImGui::MenuItem("IO log", nullptr, &ioLogEnabled)) {
+                    sys->ioLog = ioLogEnabled;
+                }
                 ImGui::MenuItem("GTE log", nullptr, &gteLogEnabled);
                 ImGui::MenuItem("GPU log", nullptr, &gpuLogEnabled);
 
@@ -127,6 +127,7 @@ void renderImgui(System* sys) {
             }
             if (ImGui::BeginMenu("Options")) {
                 if (ImGui::MenuItem("Graphics", nullptr)) showGraphicsOptionsWindow = true;
+                if (ImGui::MenuItem("System", nullptr)) showSystemOptionsWindow = true;
                 if (ImGui::MenuItem("BIOS", nullptr)) showBiosWindow = true;
                 if (ImGui::MenuItem("Controller", nullptr)) showControllerSetupWindow = true;
                 ImGui::EndMenu();
@@ -159,6 +160,7 @@ void renderImgui(System* sys) {
 
         // Options
         if (showGraphicsOptionsWindow) graphicsOptionsWindow();
+        if (showSystemOptionsWindow) systemOptionsWindow();
         if (showBiosWindow) biosSelectionWindow();
         if (showControllerSetupWindow) controllerSetupWindow();
 
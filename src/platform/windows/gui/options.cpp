@@ -1,15 +1,19 @@
 #include "options.h"
 #include <imgui.h>
 #include "config.h"
+#include "device/gpu/gpu.h"
 #include "filesystem.h"
 #include "gui.h"
 #include "images.h"
+#include "memory/fastmem.h"
 #include "platform/windows/input/sdl_input_manager.h"
 #include "renderer/opengl/opengl.h"
+#include "scheduler.h"
 #include "utils/file.h"
 #include "utils/string.h"
 
 bool showGraphicsOptionsWindow = false;
+bool showSystemOptionsWindow = false;
 bool showBiosWindow = false;
 bool showControllerSetupWindow = false;
 
@@ -105,6 +109,15 @@ void graphicsOptionsWindow() {
         }
     }
 
+    // Software renderer (hardware only mode is 1)
+    if (selectedRenderingMode != 1) {
+        int renderThreads = config["options"]["graphics"]["render_threads"];
+        if (ImGui::SliderInt("Render threads (0 - auto)", &renderThreads, 0, gpu::GPU::MAX_RENDER_THREADS)) {
+            config["options"]["graphics"]["render_threads"] = renderThreads;
+            bus.notify(Event::Config::Graphics{});
+        }
+    }
+
     bool filtering = config["options"]["graphics"]["filtering"];
     if (ImGui::Checkbox("Filtering", &filtering)) {
         config["options"]["graphics"]["filtering"] = filtering;
@@ -136,6 +149,48 @@ void graphicsOptionsWindow() {
     ImGui::End();
 }
 
+void systemOptionsWindow() {
+    const std::array<const char*, 3> cpuCores = {{"Interpreter (slow, reference)", "Cached interpreter", "Recompiler (x86-64)"}};
+    int selectedCpuCore = static_cast<int>(config["options"]["system"]["cpu_core"].get<CpuCore>());
+
+    ImGui::Begin("System", &showSystemOptionsWindow, ImGuiWindowFlags_AlwaysAutoResize);
+
+    ImGui::Text("CPU core");
+    ImGui::SameLine();
+    if (ImGui::Combo("##cpu_core", &selectedCpuCore, cpuCores.data(), cpuCores.size())) {
+        config["options"]["system"]["cpu_core"] = static_cast<CpuCore>(selectedCpuCore);
+        bus.notify(Event::Config::Cpu{});
+    }
+
+    bool loadDelaySlots = config["options"]["system"]["load_delay_slots"];
+    if (ImGui::Checkbox("Load delay slots (accurate, slower)", &loadDelaySlots)) {
+        config["options"]["system"]["load_delay_slots"] = loadDelaySlots;
+        bus.notify(Event::Config::Cpu{});
+    }
+
+    bool skipIdleLoops = config["options"]["system"]["skip_idle_loops"];
+    if (ImGui::Checkbox("Skip idle loops", &skipIdleLoops)) {
+        config["options"]["system"]["skip_idle_loops"] = skipIdleLoops;
+        bus.notify(Event::Config::Cpu{});
+    }
+
+    // Devices keep real timing, games with slowdowns get more instructions per frame
+    float cpuMultiplier = config["options"]["system"]["cpu_multiplier"];
+    if (ImGui::SliderFloat("CPU clock multiplier", &cpuMultiplier, Scheduler::MIN_CPU_MULTIPLIER, Scheduler::MAX_CPU_MULTIPLIER, "%.2fx")) {
+        config["options"]["system"]["cpu_multiplier"] = cpuMultiplier;
+        bus.notify(Event::Config::Cpu{});
+    }
+
+#ifdef FASTMEM_AVAILABLE
+    bool fastmem = config["options"]["system"]["fastmem"];
+    if (ImGui::Checkbox("Fastmem (applied after hard reset)", &fastmem)) {
+        config["options"]["system"]["fastmem"] = fastmem;
+    }
+#endif
+
+    ImGui::End();
+}
+
 void biosSelectionWindow() {
     static bool biosesFound = false;
     static std::vector<std::string> bioses;
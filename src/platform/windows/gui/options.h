@@ -1,9 +1,11 @@
 #pragma once
 
 extern bool showGraphicsOptionsWindow;
+extern bool showSystemOptionsWindow;
 extern bool showBiosWindow;
 extern bool showControllerSetupWindow;
 
 void graphicsOptionsWindow();
+void systemOptionsWindow();
 void biosSelectionWindow();
 void controllerSetupWindow();
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <cstdio>
 #include <string>
 #include "config.h"
+#include "device/gpu/frame_skip.h"
 #include "disc/format/chd_format.h"
 #include "disc/format/cue_parser.h"
 #include "imgui/imgui_impl_sdl_gl3.h"
@@ -13,6 +14,9 @@
 #include "platform/windows/input/sdl_input_manager.h"
 #include "renderer/opengl/opengl.h"
 #include "sound/sound.h"
+#include "state/movie.h"
+#include "state/rewind.h"
+#include "state/run_ahead.h"
 #include "system.h"
 #include "utils/file.h"
 #include "utils/psf.h"
@@ -157,18 +161,21 @@ std::unique_ptr<System> hardReset() {
 }
 
 // Warning: this method might have 1 or more miliseconds of inaccuracy.
-void limitFramerate(std::unique_ptr<System>& sys, SDL_Window* window, bool framelimiter, bool ntsc, bool mouseLocked) {
+// Speed is a multiple of real hardware speed, 0 doesn't limit. Returns measured speed.
+double limitFramerate(std::unique_ptr<System>& sys, SDL_Window* window, double speed, bool ntsc, bool mouseLocked,
+                      const state::RunAhead* runAhead, const gpu::FrameSkip* frameSkip) {
     static double timeToSkip = 0;
     static double counterFrequency = (double)SDL_GetPerformanceFrequency();
     static double startTime = SDL_GetPerformanceCounter() / counterFrequency;
-    static double fps;
+    static double fps = 60.0;
     static double fpsTime = 0.0;
     static int deltaFrames = 0;
 
     double currentTime = SDL_GetPerformanceCounter() / counterFrequency;
     double deltaTime = currentTime - startTime;
 
-    double frameTime = ntsc ? (1.0 / 60.0) : (1.0 / 50.0);
+    double realFrameTime = ntsc ? (1.0 / 60.0) : (1.0 / 50.0);
+    double frameTime = speed > 0 ? realFrameTime / speed : 0;
 
     // Hack: when emulation is paused and app is inactive
     // detlaTime accumulates and forces app to run without framelimiting
@@ -178,7 +185,7 @@ void limitFramerate(std::unique_ptr<System>& sys, SDL_Window* window, bool frame
         deltaTime = 1.0;
     }
 
-    if (framelimiter) {
+    if (speed > 0) {
         // If frame was shorter than frameTime - spin
         if (deltaTime < frameTime - timeToSkip) {
             while (deltaTime < frameTime - timeToSkip) {  // calculate real difference
@@ -215,13 +222,35 @@ void limitFramerate(std::unique_ptr<System>& sys, SDL_Window* window, bool frame
             title += " | " + gameName;
         }
 
-        title += string_format(" | FPS: %.0f (%0.2f ms) %s", fps, (1.0 / fps) * 1000.0, !framelimiter ? "unlimited" : "");
+        std::string limit;
+        if (speed == 0) {
+            limit = "unlimited";
+        } else if (speed != 1.0) {
+            limit = string_format("fast-forward %gx", speed);
+        }
+        title += string_format(" | FPS: %.0f (%0.2f ms) %s", fps, (1.0 / fps) * 1000.0, limit.c_str());
+
+        if (runAhead) {
+            auto stats = runAhead->getStats();
+            title += string_format(" | run-ahead %d %s (headroom %.2fx)", stats.frames, stats.active ? "on" : "off", stats.headroom);
+        }
+
+        if (frameSkip) {
+            auto stats = frameSkip->getStats();
+            title += string_format(" | frameskip %d (%llu skipped)", stats.skip, (unsigned long long)stats.skipped);
+        }
+
+        double cpuMultiplier = sys->scheduler->getCpuMultiplier();
+        if (cpuMultiplier != 1.0) {
+            title += string_format(" | CPU %.2fx (%.1f MIPS)", cpuMultiplier, sys->scheduler->getInstructionRate() / 1e6);
+        }
 
         if (sys->state == System::State::pause) {
             title += " | paused";
         }
         SDL_SetWindowTitle(window, title.c_str());
     }
+    return fps * realFrameTime;
 }
 
 int main(int argc, char** argv) {
@@ -274,11 +303,39 @@ int main(int argc, char** argv) {
 
     std::unique_ptr<System> sys = hardReset();
 
+    std::unique_ptr<state::Rewind> rewind;
+    if (config["options"]["rewind"]["enabled"]) {
+        size_t budget = config["options"]["rewind"]["budget_mb"].get<size_t>() * 1024 * 1024;
+        rewind = std::make_unique<state::Rewind>(budget, config["options"]["rewind"]["interval"].get<int>());
+    }
+
+    std::unique_ptr<state::RunAhead> runAhead;
+    if (config["options"]["run_ahead"]["frames"] > 0u) {
+        runAhead = std::make_unique<state::RunAhead>(config["options"]["run_ahead"]["frames"].get<int>(),
+                                                     config["options"]["run_ahead"]["auto"].get<bool>());
+    }
+
+    std::unique_ptr<gpu::FrameSkip> frameSkip;
+    if (config["options"]["frameskip"]["frames"] > 0u) {
+        frameSkip = std::make_unique<gpu::FrameSkip>(config["options"]["frameskip"]["frames"].get<int>(),
+                                                     config["options"]["frameskip"]["auto"].get<bool>());
+    }
+
+    const char* MOVIE_NAME = "movie.avm";
+    state::Movie movie;
+
+    // States and input of previous game or BIOS run are useless after reset
+    auto onSystemReset = [&]() {
+        if (rewind) rewind->clear();
+        movie.stop();
+    };
+
     int busToken = bus.listen<Event::File::Load>([&](auto e) {
         if (e.reset) {
             sys = hardReset();
         }
         loadFile(sys, e.file);
+        onSystemReset();
     });
 
     bool exitProgram = false;
@@ -289,6 +346,24 @@ int main(int argc, char** argv) {
     bool doHardReset = false;
     bus.listen<Event::System::HardReset>(busToken, [&](auto) { doHardReset = true; });
 
+    // Emulator works on its own copy of config, pass changes made in options
+    bus.listen<Event::Config::Graphics>(busToken, [&](auto) {
+        sys->config = config;
+        sys->gpu->reload();
+    });
+    bus.listen<Event::Config::Gte>(busToken, [&](auto) {
+        sys->config = config;
+        sys->cpu->reload();
+    });
+    bus.listen<Event::Config::Cpu>(busToken, [&](auto) {
+        sys->config = config;
+        sys->cpu->reload();
+    });
+    bus.listen<Event::Config::Controller>(busToken, [&](auto) {
+        sys->config = config;
+        sys->controller->reload();
+    });
+
     // If argument given - open that file (same as drag and drop)
     if (argc > 1) {
         loadFile(sys, argv[1]);
@@ -335,7 +410,11 @@ int main(int argc, char** argv) {
     else
         sys->state = System::State::run;
 
-    bool frameLimitEnabled = true;
+    // Tab toggles fast-forward, speed 0 runs as fast as possible
+    bool fastForward = false;
+    double fastForwardSpeed = std::max(0.0, config["options"]["fast_forward"]["speed"].get<double>());
+    bool fastForwardSkipPresenting = config["options"]["fast_forward"]["skip_presenting"];
+    double lastPresentTime = 0;
     bool windowFocused = true;
 
     SDL_Event event;
@@ -375,6 +454,7 @@ int main(int argc, char** argv) {
                 if (event.key.keysym.sym == SDLK_F2) {
                     if (event.key.keysym.mod & KMOD_SHIFT) {
                         sys = hardReset();
+                        onSystemReset();
                     } else
                         sys->softReset();
                 }
@@ -389,6 +469,17 @@ int main(int argc, char** argv) {
                 if (event.key.keysym.sym == SDLK_F8) {
                     sys->singleStep();
                 }
+                if (event.key.keysym.sym == SDLK_F9) {
+                    if (movie.getMode() == state::Movie::Mode::Recording) {
+                        movie.stop();
+                        if (movie.save(MOVIE_NAME)) printf("Movie saved to %s (%zu frames)\n", MOVIE_NAME, movie.getLength());
+                    } else if (event.key.keysym.mod & KMOD_SHIFT) {
+                        if (movie.load(MOVIE_NAME) && movie.startReplay(sys.get())) printf("Replaying %s\n", MOVIE_NAME);
+                    } else {
+                        movie.startRecording(sys.get());
+                        printf("Recording movie\n");
+                    }
+                }
                 if (event.key.keysym.sym == SDLK_SPACE) {
                     if (sys->state == System::State::pause) {
                         sys->state = System::State::run;
@@ -396,12 +487,13 @@ int main(int argc, char** argv) {
                         sys->state = System::State::pause;
                     }
                 }
-                if (event.key.keysym.sym == SDLK_TAB) frameLimitEnabled = !frameLimitEnabled;
+                if (event.key.keysym.sym == SDLK_TAB) fastForward = !fastForward;
             }
             if (event.type == SDL_DROPFILE) {
                 std::string path = event.drop.file;
                 SDL_free(event.drop.file);
                 loadFile(sys, path);
+                onSystemReset();
             }
             if (event.type == SDL_WINDOWEVENT
                 && (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED || event.window.event == SDL_WINDOWEVENT_RESIZED)) {
@@ -413,27 +505,66 @@ int main(int argc, char** argv) {
         if (doHardReset) {
             doHardReset = false;
             sys = hardReset();
+            onSystemReset();
         }
 
+        bool frameEmulated = false;
+        bool presentFrame = true;
         if (sys->state == System::State::run) {
             sys->gpu->clear();
-            sys->controller->update();
-
-            sys->emulateFrame();
+            // Replayed movie replaces live input
+            if (movie.getMode() != state::Movie::Mode::Replaying) sys->controller->update();
+
+            // Hold backspace to rewind, not while movie is active (its input is tied to emulated frames)
+            bool rewinding = rewind && movie.getMode() == state::Movie::Mode::None && !inputManager->keyboardCaptured
+                             && SDL_GetKeyboardState(nullptr)[SDL_SCANCODE_BACKSPACE];
+            if (!rewinding || !rewind->rewind(sys.get())) {
+                frameEmulated = true;
+                movie.update(sys.get());
+                if (frameSkip) presentFrame = frameSkip->beginFrame(sys.get());
+                // Fast-forward presents at most at display rate, frames in between are skipped
+                double now = SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
+                if (fastForward && fastForwardSkipPresenting && presentFrame && now - lastPresentTime < 1.0 / 60.0) {
+                    presentFrame = false;
+                    sys->gpu->skipRendering = true;
+                }
+                if (presentFrame) lastPresentTime = now;
+                // Skipped frame isn't shown, running ahead of it is pointless
+                if (runAhead && presentFrame) {
+                    runAhead->runFrame(sys.get());
+                } else {
+                    sys->emulateFrame();
+                }
+                if (frameSkip) frameSkip->endFrame(sys.get());
+                sys->gpu->skipRendering = false;
+                if (presentFrame) sys->gpu->flushDisplayArea();
+            }
             if (singleFrame) {
                 singleFrame = false;
                 sys->state = System::State::pause;
             }
         }
-        ImGui_ImplSdlGL3_NewFrame(window);
+        // Skipped frames are emulated, but not presented
+        if (presentFrame) {
+            ImGui_ImplSdlGL3_NewFrame(window);
 
-        SDL_GL_GetDrawableSize(window, &opengl.width, &opengl.height);
-        opengl.render(sys->gpu.get());
-        renderImgui(sys.get());
+            SDL_GL_GetDrawableSize(window, &opengl.width, &opengl.height);
+            opengl.render(sys->gpu.get());
+        }
+
+        // Run-ahead state was presented, GUI and rewind work with the real frame
+        if (runAhead) runAhead->restore(sys.get());
+        if (rewind && frameEmulated) rewind->frameEmulated(sys.get());
 
-        SDL_GL_SwapWindow(window);
+        if (presentFrame) {
+            renderImgui(sys.get());
+            SDL_GL_SwapWindow(window);
+        }
 
-        limitFramerate(sys, window, frameLimitEnabled, sys->gpu->isNtsc(), inputManager->mouseLocked);
+        double speed = limitFramerate(sys, window, fastForward ? fastForwardSpeed : 1.0, sys->gpu->isNtsc(), inputManager->mouseLocked,
+                                      runAhead.get(), frameSkip.get());
+        // Audio is stretched to measured speed, not the requested one
+        Sound::setFastForward(fastForward ? speed : 0);
     }
     saveMemoryCards(sys, true);
     saveConfigFile(CONFIG_NAME);
@@ -0,0 +1,115 @@
+#include "scheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include "system.h"
+
+Scheduler::Scheduler(System* sys) : sys(sys) { setCpuMultiplier(1.0); }
+
+Scheduler::EventId Scheduler::addEvent(const std::string& name, std::function<void()> callback) {
+    Event event;
+    event.name = name;
+    event.callback = callback;
+    events.push_back(event);
+    return static_cast<EventId>(events.size() - 1);
+}
+
+void Scheduler::schedule(EventId event, uint64_t cycles) { scheduleAt(event, getTimestamp() + cycles); }
+
+void Scheduler::reschedule(EventId event, uint64_t cycles) { scheduleAt(event, events[event].timestamp + cycles); }
+
+void Scheduler::cancel(EventId event) {
+    events[event].scheduled = false;
+    if (event == nextEvent) findNextEvent();
+}
+
+uint64_t Scheduler::getTimestamp() const {
+    uint64_t fixed = static_cast<uint64_t>(sys->cpu->sliceExecuted) * cyclesPerInstruction + cycleFraction;
+    return timestamp + (fixed >> FRACTION_BITS);
+}
+
+int Scheduler::getCyclesToNextEvent() const {
+    if (nextEvent == -1) return INT_MAX;
+    if (nextTimestamp <= timestamp) return 0;
+    return static_cast<int>(std::min<uint64_t>(nextTimestamp - timestamp, INT_MAX));
+}
+
+void Scheduler::setCpuMultiplier(double multiplier) {
+    multiplier = std::clamp(multiplier, MIN_CPU_MULTIPLIER, MAX_CPU_MULTIPLIER);
+    cyclesPerInstruction = static_cast<uint32_t>(std::lround((System::CYCLES_PER_INSTRUCTION << FRACTION_BITS) / multiplier));
+}
+
+double Scheduler::getCpuMultiplier() const {
+    return static_cast<double>(System::CYCLES_PER_INSTRUCTION << FRACTION_BITS) / cyclesPerInstruction;
+}
+
+double Scheduler::getInstructionRate() const {
+    return static_cast<double>(System::SYSTEM_CLOCK) * (1 << FRACTION_BITS) / cyclesPerInstruction;
+}
+
+int Scheduler::instructionsFor(uint64_t cycles) const {
+    uint64_t fixed = cycles << FRACTION_BITS;
+    if (fixed <= cycleFraction) return 0;
+    uint64_t instructions = (fixed - cycleFraction + cyclesPerInstruction - 1) / cyclesPerInstruction;
+    return static_cast<int>(std::min<uint64_t>(instructions, INT_MAX));
+}
+
+uint64_t Scheduler::cyclesFor(uint64_t instructions) const { return (instructions * cyclesPerInstruction) >> FRACTION_BITS; }
+
+void Scheduler::update() {
+    auto& cpu = sys->cpu;
+    uint64_t fixed = static_cast<uint64_t>(cpu->sliceExecuted) * cyclesPerInstruction + cycleFraction;
+    timestamp += fixed >> FRACTION_BITS;
+    cycleFraction = fixed & ((1 << FRACTION_BITS) - 1);
+    cpu->sliceExecuted = 0;
+    cpu->sliceLength = 0;
+
+    while (nextEvent != -1 && nextTimestamp <= timestamp) {
+        EventId event = nextEvent;
+        events[event].scheduled = false;
+        findNextEvent();
+        if (!profiling) {
+            events[event].callback();
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        events[event].callback();
+        events[event].seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        events[event].calls++;
+    }
+}
+
+std::vector<Scheduler::EventStats> Scheduler::getStats() const {
+    std::vector<EventStats> stats;
+    for (const auto& event : events) stats.push_back({event.name, event.calls, event.seconds});
+    return stats;
+}
+
+void Scheduler::scheduleAt(EventId event, uint64_t timestamp) {
+    events[event].timestamp = timestamp;
+    events[event].scheduled = true;
+    findNextEvent();
+
+    // Event scheduled by device during CPU slice - end slice at the event
+    auto& cpu = sys->cpu;
+    if (event == nextEvent && cpu->sliceLength > 0) {
+        int instructions = instructionsFor(timestamp > this->timestamp ? timestamp - this->timestamp : 0);
+        if (instructions < cpu->sliceLength) {
+            cpu->sliceLength = std::max(cpu->sliceExecuted + 1, instructions);
+        }
+    }
+}
+
+void Scheduler::findNextEvent() {
+    // There is only a handful of events, linear search is faster than maintaining a heap
+    nextEvent = -1;
+    for (size_t i = 0; i < events.size(); i++) {
+        if (!events[i].scheduled) continue;
+        if (nextEvent == -1 || events[i].timestamp < nextTimestamp) {
+            nextEvent = static_cast<int>(i);
+            nextTimestamp = events[i].timestamp;
+        }
+    }
+}
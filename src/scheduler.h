@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct System;
+
+/**
+ * Timestamp based event scheduler, all times are in system cycles.
+ * Devices register events once and schedule them when they have work to do,
+ * CPU runs until the nearest event (see System::emulateFrame).
+ * Current time includes instructions executed in currently running CPU slice.
+ * CPU multiplier changes only how many instructions fit in a cycle, devices keep their real timing.
+ */
+class Scheduler {
+   public:
+    typedef int EventId;
+
+    struct EventStats {
+        std::string name;
+        uint64_t calls;
+        double seconds;
+    };
+
+    // Measure host time spent in event callbacks (see getStats)
+    bool profiling = false;
+
+    Scheduler(System* sys);
+
+    EventId addEvent(const std::string& name, std::function<void()> callback);
+
+    // Schedule event relative to current time, replaces previous schedule
+    void schedule(EventId event, uint64_t cycles);
+    // Schedule event relative to its previous timestamp (periodic events without drift)
+    void reschedule(EventId event, uint64_t cycles);
+    void cancel(EventId event);
+    bool isScheduled(EventId event) const { return events[event].scheduled; }
+
+    uint64_t getTimestamp() const;
+    int getCyclesToNextEvent() const;
+
+    static constexpr double MIN_CPU_MULTIPLIER = 0.5;
+    static constexpr double MAX_CPU_MULTIPLIER = 8.0;
+
+    // Overclock (or underclock) CPU relative to system clock, 1.0 is real hardware
+    void setCpuMultiplier(double multiplier);
+    double getCpuMultiplier() const;
+    // Instructions executed per second of emulated time
+    double getInstructionRate() const;
+    // Instructions needed to advance time by given cycles (rounded up)
+    int instructionsFor(uint64_t cycles) const;
+    uint64_t cyclesFor(uint64_t instructions) const;
+
+    // Account instructions executed by CPU and run events that are due
+    void update();
+
+    // Calls and host time of every event since profiling was enabled
+    std::vector<EventStats> getStats() const;
+
+    // Events are identified by index, devices register them in the same order in every instance
+    template <class Archive>
+    void serialize(Archive& ar) {
+        uint32_t count = static_cast<uint32_t>(events.size());
+        ar(timestamp, cycleFraction, count);
+        if constexpr (!Archive::saving) {
+            if (count != events.size()) return ar.fail("different event count");
+        }
+        for (auto& event : events) ar(event.timestamp, event.scheduled);
+        if (!Archive::saving) findNextEvent();
+    }
+
+   private:
+    struct Event {
+        std::string name;
+        std::function<void()> callback;
+        uint64_t timestamp = 0;
+        bool scheduled = false;
+        uint64_t calls = 0;
+        double seconds = 0;
+    };
+
+    System* sys;
+    std::vector<Event> events;
+    uint64_t timestamp = 0;      // Time of last update
+    uint64_t nextTimestamp = 0;  // Nearest event
+    int nextEvent = -1;
+    // Cycles per instruction in fixed point, fraction of cycle not accounted yet is carried to the next update
+    static const int FRACTION_BITS = 8;
+    uint32_t cyclesPerInstruction;
+    uint32_t cycleFraction = 0;
+
+    void scheduleAt(EventId event, uint64_t timestamp);
+    void findNextEvent();
+};
@@ -57,29 +57,23 @@ std::vector<int16_t> decode(uint8_t buffer[16], int32_t prevSample[2]) {
     return decoded;
 }
 
-// Separate buffers and counters for left and right channels
-// TODO: Come up with better solution. Are two buffers really necessary?
-int16_t ringbuf[2][0x20] = {};
-int p[2] = {};
-int sixstep[2] = {6, 6};
-
 template <int ch>
-int16_t doZigzag(int p, int table) {
+int16_t doZigzag(const XAState& state, int p, int table) {
     int32_t sum = 0;
     for (int i = 1; i < 29; i++) {
-        sum += (ringbuf[ch][(p - i) & 0x1f] * zigzagTables[table][i]) / 0x8000;
+        sum += (state.ringbuf[ch][(p - i) & 0x1f] * zigzagTables[table][i]) / 0x8000;
     }
     return clamp_16bit(sum);
 }
 
 template <int ch>
-void interpolate(int16_t sample, std::vector<int16_t>& output) {
-    ringbuf[ch][p[ch]++ & 0x1f] = sample;
+void interpolate(XAState& state, int16_t sample, std::vector<int16_t>& output) {
+    state.ringbuf[ch][state.p[ch]++ & 0x1f] = sample;
 
-    if (--sixstep[ch] == 0) {
-        sixstep[ch] = 6;
+    if (--state.sixstep[ch] == 0) {
+        state.sixstep[ch] = 6;
         for (int table = 0; table < 7; table++) {
-            output.push_back(doZigzag<ch>(p[ch], table));
+            output.push_back(doZigzag<ch>(state, state.p[ch], table));
         }
     }
 }
@@ -87,7 +81,7 @@ void interpolate(int16_t sample, std::vector<int16_t>& output) {
 enum class Channel { mono, left, right };
 
 template <Channel channel>
-std::vector<int16_t> decodePacket(uint8_t buffer[128], int32_t prevSample[2], bool sampleRate) {
+std::vector<int16_t> decodePacket(XAState& state, uint8_t buffer[128], int32_t prevSample[2], bool sampleRate) {
     std::vector<int16_t> decoded;
 
     std::vector<int> blocks;
@@ -129,14 +123,14 @@ std::vector<int16_t> decodePacket(uint8_t buffer[128], int32_t prevSample[2], bo
             // clamp to -0x8000 +0x7fff
             // Intepolate 37800Hz to 44100Hz
             if (channel == Channel::mono || channel == Channel::left) {
-                interpolate<0>(clamp_16bit(sample), decoded);
+                interpolate<0>(state, clamp_16bit(sample), decoded);
 
                 // 18900Hz to 37800Hz
                 // FIXME: Doubling samples isn't how you should interpolate it, right?
-                if (sampleRate) interpolate<0>(clamp_16bit(sample), decoded);
+                if (sampleRate) interpolate<0>(state, clamp_16bit(sample), decoded);
             } else {
-                interpolate<1>(clamp_16bit(sample), decoded);
-                if (sampleRate) interpolate<0>(clamp_16bit(sample), decoded);
+                interpolate<1>(state, clamp_16bit(sample), decoded);
+                if (sampleRate) interpolate<0>(state, clamp_16bit(sample), decoded);
             }
 
             // Move previous samples forward
@@ -148,9 +142,9 @@ std::vector<int16_t> decodePacket(uint8_t buffer[128], int32_t prevSample[2], bo
     return decoded;
 }
 
-std::pair<std::vector<int16_t>, std::vector<int16_t>> decodeXA(uint8_t buffer[128 * 18], cd::Codinginfo codinginfo) {
-    static int32_t prevSampleLeft[2] = {};
-    static int32_t prevSampleRight[2] = {};
+std::pair<std::vector<int16_t>, std::vector<int16_t>> decodeXA(uint8_t buffer[128 * 18], cd::Codinginfo codinginfo, XAState& state) {
+    int32_t* prevSampleLeft = state.prevSample[0];
+    int32_t* prevSampleRight = state.prevSample[1];
 
     std::vector<int16_t> left;
     std::vector<int16_t> right;
@@ -158,13 +152,13 @@ std::pair<std::vector<int16_t>, std::vector<int16_t>> decodeXA(uint8_t buffer[12
     // Each sector contains of 18 128-byte portions
     for (int packet = 0; packet < 18; packet++) {
         if (codinginfo.stereo) {
-            auto l = decodePacket<Channel::left>(buffer + packet * 128, prevSampleLeft, codinginfo.sampleRate);
-            auto r = decodePacket<Channel::right>(buffer + packet * 128, prevSampleRight, codinginfo.sampleRate);
+            auto l = decodePacket<Channel::left>(state, buffer + packet * 128, prevSampleLeft, codinginfo.sampleRate);
+            auto r = decodePacket<Channel::right>(state, buffer + packet * 128, prevSampleRight, codinginfo.sampleRate);
 
             left.insert(left.end(), l.begin(), l.end());
             right.insert(right.end(), r.begin(), r.end());
         } else {
-            auto mono = decodePacket<Channel::mono>(buffer + packet * 128, prevSampleLeft, codinginfo.sampleRate);
+            auto mono = decodePacket<Channel::mono>(state, buffer + packet * 128, prevSampleLeft, codinginfo.sampleRate);
             left.insert(left.end(), mono.begin(), mono.end());
             right.insert(right.end(), mono.begin(), mono.end());
         }
@@ -4,6 +4,17 @@
 
 namespace ADPCM {
 enum Flag { End = 1 << 0, Repeat = 1 << 1, Start = 1 << 2 };
+
+// Decoder state carried between XA sectors, separate for left and right channel
+struct XAState {
+    int32_t prevSample[2][2] = {};
+    // Interpolation ring buffers and counters
+    // TODO: Come up with better solution. Are two buffers really necessary?
+    int16_t ringbuf[2][0x20] = {};
+    int p[2] = {};
+    int sixstep[2] = {6, 6};
+};
+
 std::vector<int16_t> decode(uint8_t buffer[16], int32_t prevSample[2]);
-std::pair<std::vector<int16_t>, std::vector<int16_t>> decodeXA(uint8_t buffer[128 * 18], cd::Codinginfo codinginfo);
+std::pair<std::vector<int16_t>, std::vector<int16_t>> decodeXA(uint8_t buffer[128 * 18], cd::Codinginfo codinginfo, XAState& state);
 };  // namespace ADPCM
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "sound.h"
+#include <algorithm>
+#include <vector>
+#include "time_stretch.h"
+
+namespace Sound {
+namespace {
+// In samples, about 46ms of stereo audio
+const size_t TARGET_BUFFER = 512 * 8;
+const size_t MAX_BUFFER = 512 * 32;
+
+TimeStretch stretch;
+bool fastForward = false;
+double speed = 1.0;
+std::vector<int16_t> stretched;
+};  // namespace
+
+void appendBuffer(const int16_t* samples, size_t count) {
+    std::unique_lock<std::mutex> lock(audioMutex);
+
+    stretched.clear();
+    if (!fastForward) {
+        // Input kept since fast-forward ended is played first
+        stretch.flush(stretched);
+        stretched.insert(stretched.end(), samples, samples + count);
+    } else {
+        // Speed is measured over longer time, amount of queued audio corrects the ratio
+        double fill = (double)buffer.size() / TARGET_BUFFER;
+        stretch.setRatio(speed * std::clamp(1.0 + (fill - 1.0) * 0.5, 0.75, 2.0));
+        stretch.process(samples, count, stretched);
+    }
+    buffer.insert(buffer.end(), stretched.begin(), stretched.end());
+
+    // Playback lags behind emulation, oldest samples are dropped
+    if (buffer.size() > MAX_BUFFER) {
+        buffer.erase(buffer.begin(), buffer.end() - TARGET_BUFFER);
+    }
+}
+
+void setFastForward(double newSpeed) {
+    std::unique_lock<std::mutex> lock(audioMutex);
+    fastForward = newSpeed > 0;
+    speed = std::max(1.0, newSpeed);
+}
+};  // namespace Sound
@@ -1,7 +1,7 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <deque>
-#include <iterator>
 #include <mutex>
 
 namespace Sound {
@@ -14,13 +14,8 @@ void stop();
 void close();
 void clearBuffer();
 
-template <typename Iterator>
-void appendBuffer(const Iterator& start, const Iterator& end) {
-    std::unique_lock<std::mutex> lock(audioMutex);
-
-    if (buffer.size() > 512 * 32) {
-        buffer.clear();
-    }
-    buffer.insert(buffer.end(), start, end);
-}
+// Queues interleaved stereo samples for playback
+void appendBuffer(const int16_t* samples, size_t count);
+// Fast-forward, audio emulated at given multiple of real speed is time-stretched back to real time, 0 disables
+void setFastForward(double speed);
 };  // namespace Sound
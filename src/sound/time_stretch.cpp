@@ -0,0 +1,73 @@
+#include "time_stretch.h"
+#include <algorithm>
+#include <cmath>
+
+void TimeStretch::setRatio(double ratio) { this->ratio = std::max(0.5, ratio); }
+
+// Offset in seek window where input is most similar to the tail (normalized cross-correlation of mono mix)
+size_t TimeStretch::bestOffset() const {
+    std::array<int32_t, OVERLAP> reference;
+    for (size_t i = 0; i < OVERLAP; i++) reference[i] = tail[i * 2] + tail[i * 2 + 1];
+
+    size_t best = 0;
+    double bestScore = -1e300;
+    for (size_t offset = 0; offset < SEEK; offset++) {
+        const int16_t* src = &input[offset * CHANNELS];
+        int64_t correlation = 0;
+        int64_t energy = 1;
+        for (size_t i = 0; i < OVERLAP; i++) {
+            int32_t sample = src[i * 2] + src[i * 2 + 1];
+            correlation += (int64_t)reference[i] * sample;
+            energy += (int64_t)sample * sample;
+        }
+        double score = correlation / std::sqrt((double)energy);
+        if (score > bestScore) {
+            bestScore = score;
+            best = offset;
+        }
+    }
+    return best;
+}
+
+void TimeStretch::process(const int16_t* samples, size_t count, std::vector<int16_t>& output) {
+    input.insert(input.end(), samples, samples + count);
+
+    for (;;) {
+        // Input skipped over by faster tempo
+        size_t frames = input.size() / CHANNELS;
+        if (skip >= 1.0) {
+            size_t dropped = std::min((size_t)skip, frames);
+            input.erase(input.begin(), input.begin() + dropped * CHANNELS);
+            skip -= dropped;
+            frames -= dropped;
+            if (skip >= 1.0) return;
+        }
+        if (frames < SEEK + SEQUENCE) return;
+
+        size_t offset = hasTail ? bestOffset() : 0;
+        const int16_t* src = &input[offset * CHANNELS];
+
+        size_t start = 0;
+        if (hasTail) {
+            for (size_t i = 0; i < OVERLAP * CHANNELS; i++) {
+                int32_t fade = (int32_t)(i / CHANNELS);
+                output.push_back((int16_t)((tail[i] * ((int32_t)OVERLAP - fade) + src[i] * fade) / (int32_t)OVERLAP));
+            }
+            start = OVERLAP;
+        }
+        output.insert(output.end(), src + start * CHANNELS, src + (SEQUENCE - OVERLAP) * CHANNELS);
+        std::copy_n(src + (SEQUENCE - OVERLAP) * CHANNELS, OVERLAP * CHANNELS, tail.begin());
+        hasTail = true;
+
+        // Every sequence outputs (SEQUENCE - OVERLAP) frames
+        skip += (SEQUENCE - OVERLAP) * ratio;
+    }
+}
+
+void TimeStretch::flush(std::vector<int16_t>& output) {
+    if (hasTail) output.insert(output.end(), tail.begin(), tail.end());
+    output.insert(output.end(), input.begin(), input.end());
+    input.clear();
+    hasTail = false;
+    skip = 0;
+}
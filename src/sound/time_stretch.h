@@ -0,0 +1,37 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Changes tempo of stereo audio without changing its pitch (WSOLA).
+ * Input is cut into overlapping sequences, every sequence is shifted within a seek window to best match
+ * the end of previous one and crossfaded with it. Sequences are taken from input advancing ratio times faster than output.
+ */
+class TimeStretch {
+   public:
+    // Input played per output, 2.0 plays twice as fast
+    void setRatio(double ratio);
+    double getRatio() const { return ratio; }
+
+    // Appends stretched interleaved samples to output, part of input is kept until there is enough of it
+    void process(const int16_t* samples, size_t count, std::vector<int16_t>& output);
+    // Appends kept input unchanged
+    void flush(std::vector<int16_t>& output);
+
+   private:
+    static const int CHANNELS = 2;
+    // In frames at 44100Hz
+    static const size_t SEQUENCE = 1764;  // 40ms
+    static const size_t OVERLAP = 352;    // 8ms
+    static const size_t SEEK = 660;       // 15ms
+
+    double ratio = 1.0;
+    std::vector<int16_t> input;
+    std::array<int16_t, OVERLAP * CHANNELS> tail;  // End of previous sequence, not output yet
+    bool hasTail = false;
+    double skip = 0;  // Input frames to drop before next sequence
+
+    size_t bestOffset() const;
+};
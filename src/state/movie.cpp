@@ -0,0 +1,196 @@
+#include "movie.h"
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include "device/controller/peripherals/analog_controller.h"
+#include "state.h"
+#include "system.h"
+#include "utils/file.h"
+#include "utils/string.h"
+
+namespace state {
+namespace {
+const uint32_t MOVIE_START = sectionId("MVST");
+const uint32_t MOVIE_INPUT = sectionId("MVIN");
+const uint32_t MOVIE_VERSION = 1;
+
+Movie::Pad readPad(peripherals::AbstractDevice* device) {
+    Movie::Pad pad;
+    if (auto digital = dynamic_cast<peripherals::DigitalController*>(device)) {
+        pad.buttons = digital->getButtons();
+    }
+    if (auto analog = dynamic_cast<peripherals::AnalogController*>(device)) {
+        pad.leftX = analog->left.x;
+        pad.leftY = analog->left.y;
+        pad.rightX = analog->right.x;
+        pad.rightY = analog->right.y;
+        pad.analogButton = analog->analogPressed;
+    }
+    return pad;
+}
+
+void applyPad(peripherals::AbstractDevice* device, const Movie::Pad& pad) {
+    if (auto digital = dynamic_cast<peripherals::DigitalController*>(device)) {
+        digital->setButtons(pad.buttons);
+    }
+    if (auto analog = dynamic_cast<peripherals::AnalogController*>(device)) {
+        analog->left.x = pad.leftX;
+        analog->left.y = pad.leftY;
+        analog->right.x = pad.rightX;
+        analog->right.y = pad.rightY;
+        analog->setAnalogButton(pad.analogButton);
+    }
+}
+
+// Script aliases of DigitalController button names
+uint16_t scriptButton(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    if (name == "x") name = "cross";
+    if (name == "o") name = "circle";
+    return peripherals::DigitalController::buttonMask(name);
+}
+};  // namespace
+
+void Movie::startRecording(System* sys) {
+    sys->saveState(startState);
+    inputs.clear();
+    frame = 0;
+    mode = Mode::Recording;
+}
+
+bool Movie::startReplay(System* sys) {
+    if (!startState.empty() && !sys->loadState(startState)) {
+        printf("[MOVIE] Start state cannot be loaded (different configuration or controller types)\n");
+        return false;
+    }
+    frame = 0;
+    mode = Mode::Replaying;
+    return true;
+}
+
+void Movie::stop() { mode = Mode::None; }
+
+void Movie::update(System* sys) {
+    auto& devices = sys->controller->controller;
+    if (mode == Mode::Recording) {
+        Input input;
+        for (int port = 0; port < PORTS; port++) input[port] = readPad(devices[port].get());
+        inputs.push_back(input);
+        frame++;
+    } else if (mode == Mode::Replaying) {
+        if (frame >= inputs.size()) {
+            mode = Mode::None;
+            return;
+        }
+        for (int port = 0; port < PORTS; port++) applyPad(devices[port].get(), inputs[frame][port]);
+        frame++;
+    }
+}
+
+bool Movie::save(const std::string& path) {
+    std::vector<uint8_t> data;
+    Writer ar(data);
+    ar.section(MOVIE_START, MOVIE_VERSION, [&] { ar(startState); });
+    ar.section(MOVIE_INPUT, MOVIE_VERSION, [&] { ar(inputs); });
+    ar.finish();
+
+    auto compressed = compressAsync(std::move(data)).get();
+    if (!putFileContents(path, compressed)) {
+        printf("[MOVIE] Cannot write %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Movie::load(const std::string& path) {
+    auto file = getFileContents(path);
+    std::vector<uint8_t> data;
+    if (!isCompressed(file) || !decompress(file, data)) {
+        printf("[MOVIE] %s is not a movie\n", path.c_str());
+        return false;
+    }
+
+    Reader ar(data.data(), data.size());
+    std::vector<uint8_t> loadedState;
+    std::vector<Input> loadedInputs;
+    ar.section(MOVIE_START, MOVIE_VERSION, [&] { ar(loadedState); });
+    ar.section(MOVIE_INPUT, MOVIE_VERSION, [&] { ar(loadedInputs); });
+    if (!ar.ok()) {
+        printf("[MOVIE] %s is corrupted or has unsupported version\n", path.c_str());
+        return false;
+    }
+
+    startState = std::move(loadedState);
+    inputs = std::move(loadedInputs);
+    frame = 0;
+    mode = Mode::None;
+    return true;
+}
+
+bool Movie::parseScript(const std::string& script) {
+    std::vector<Input> compiled;
+    std::istringstream lines(script);
+    int lineNumber = 0;
+    for (std::string line; std::getline(lines, line);) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream stream(line);
+        std::vector<std::string> args;
+        for (std::string arg; stream >> arg;) args.push_back(arg);
+        if (args.empty()) continue;
+
+        auto error = [&](const char* reason) {
+            printf("[MOVIE] Script line %d: %s\n", lineNumber, reason);
+            return false;
+        };
+
+        if (args.size() < 3) return error("expected <frame> press|hold <buttons> [frames]");
+        char* end;
+        long start = strtol(args[0].c_str(), &end, 10);
+        if (*end != '\0' || start < 0 || start >= MAX_SCRIPT_FRAMES) return error("invalid frame number");
+
+        long length = PRESS_FRAMES;
+        if (args[1] == "hold") {
+            if (args.size() != 4) return error("hold needs number of frames");
+            length = strtol(args[3].c_str(), &end, 10);
+            if (*end != '\0' || length <= 0 || length > MAX_SCRIPT_FRAMES) return error("invalid number of frames");
+        } else if (args[1] != "press" || args.size() != 3) {
+            return error("unknown command");
+        }
+
+        int port = 0;
+        std::string buttons = args[2];
+        if (buttons.size() > 2 && buttons[1] == ':') {
+            port = buttons[0] - '1';
+            if (port < 0 || port >= PORTS) return error("invalid port");
+            buttons = buttons.substr(2);
+        }
+
+        uint16_t mask = 0;
+        for (auto& name : split(buttons, "+")) {
+            uint16_t button = scriptButton(name);
+            if (button == 0) return error("unknown button");
+            mask |= button;
+        }
+
+        if (start + length > MAX_SCRIPT_FRAMES) return error("script is too long");
+        if (compiled.size() < static_cast<size_t>(start + length)) compiled.resize(start + length);
+        for (long i = start; i < start + length; i++) compiled[i][port].buttons |= mask;
+    }
+
+    startState.clear();
+    inputs = std::move(compiled);
+    frame = 0;
+    mode = Mode::None;
+    return true;
+}
+
+bool Movie::loadScript(const std::string& path) {
+    if (!fileExists(path)) {
+        printf("[MOVIE] Cannot open %s\n", path.c_str());
+        return false;
+    }
+    return parseScript(getFileContentsAsString(path));
+}
+};  // namespace state
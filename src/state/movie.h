@@ -0,0 +1,65 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct System;
+
+namespace state {
+/**
+ * Input movie - controller state applied by Controller::update() on every frame.
+ * Recording stores the state it started from, replay on the same BIOS and disc is bit-identical.
+ * Movies compiled from scripts have no start state, they are replayed from the current state (eg. fresh boot).
+ *
+ * Script has one command per line, frames are counted from the start of replay, '#' starts a comment:
+ *   600 press cross      - press button (held for PRESS_FRAMES)
+ *   700 hold right 120   - hold button for given number of frames
+ *   900 press 2:l1+r1    - buttons joined with '+', port 2
+ */
+class Movie {
+   public:
+    static const int PORTS = 2;
+    static const int PRESS_FRAMES = 5;
+    static const long MAX_SCRIPT_FRAMES = 60 * 60 * 60 * 4;  // 4 hours at 60 fps, limits memory of compiled script
+
+    struct Pad {
+        uint16_t buttons = 0;  // DigitalController::setButtons bits
+        uint8_t leftX = 0x80;
+        uint8_t leftY = 0x80;
+        uint8_t rightX = 0x80;
+        uint8_t rightY = 0x80;
+        uint8_t analogButton = 0;
+        uint8_t reserved = 0;
+    };
+    using Input = std::array<Pad, PORTS>;
+
+    enum class Mode { None, Recording, Replaying };
+
+    // Stores current state as the start of movie, previous input is discarded
+    void startRecording(System* sys);
+    // Loads start state if movie has one, false if it cannot be loaded into this instance
+    bool startReplay(System* sys);
+    void stop();
+
+    // Call after Controller::update() on every frame, records applied input or replaces it with the recorded one.
+    // Replay stops after the last frame.
+    void update(System* sys);
+
+    Mode getMode() const { return mode; }
+    size_t getFrame() const { return frame; }
+    size_t getLength() const { return inputs.size(); }
+
+    bool save(const std::string& path);
+    bool load(const std::string& path);
+    // Replaces movie with compiled script, errors are printed with line numbers
+    bool parseScript(const std::string& script);
+    bool loadScript(const std::string& path);
+
+   private:
+    Mode mode = Mode::None;
+    size_t frame = 0;
+    std::vector<uint8_t> startState;
+    std::vector<Input> inputs;
+};
+};  // namespace state
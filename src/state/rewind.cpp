@@ -0,0 +1,272 @@
+#include "rewind.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "miniz.h"
+#include "system.h"
+
+namespace state {
+namespace {
+void xorInto(std::vector<uint8_t>& data, const std::vector<uint8_t>& base) {
+    size_t size = std::min(data.size(), base.size());
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, &data[i], 8);
+        memcpy(&b, &base[i], 8);
+        a ^= b;
+        memcpy(&data[i], &a, 8);
+    }
+    for (; i < size; i++) data[i] ^= base[i];
+}
+
+bool isZero(const uint8_t* data, size_t size) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i + 8 <= size; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        acc |= v;
+    }
+    for (size_t i = size & ~7; i < size; i++) acc |= data[i];
+    return acc == 0;
+}
+
+// Delta is mostly zeros, only changed blocks are passed to compressor: bitmap of changed blocks followed by their data
+void pack(const std::vector<uint8_t>& delta, std::vector<uint8_t>& packed) {
+    size_t blocks = (delta.size() + Rewind::BLOCK_SIZE - 1) / Rewind::BLOCK_SIZE;
+    packed.assign((blocks + 7) / 8, 0);
+    for (size_t block = 0; block < blocks; block++) {
+        size_t offset = block * Rewind::BLOCK_SIZE;
+        size_t size = std::min(Rewind::BLOCK_SIZE, delta.size() - offset);
+        if (isZero(&delta[offset], size)) continue;
+
+        packed[block / 8] |= 1 << (block % 8);
+        packed.insert(packed.end(), delta.begin() + offset, delta.begin() + offset + size);
+    }
+}
+
+bool unpack(const std::vector<uint8_t>& packed, std::vector<uint8_t>& delta) {
+    size_t blocks = (delta.size() + Rewind::BLOCK_SIZE - 1) / Rewind::BLOCK_SIZE;
+    size_t position = (blocks + 7) / 8;
+    if (packed.size() < position) return false;
+    for (size_t block = 0; block < blocks; block++) {
+        size_t offset = block * Rewind::BLOCK_SIZE;
+        size_t size = std::min(Rewind::BLOCK_SIZE, delta.size() - offset);
+        if ((packed[block / 8] & (1 << (block % 8))) == 0) {
+            memset(&delta[offset], 0, size);
+            continue;
+        }
+
+        if (position + size > packed.size()) return false;
+        memcpy(&delta[offset], &packed[position], size);
+        position += size;
+    }
+    return position == packed.size();
+}
+};  // namespace
+
+Rewind::Rewind(size_t memoryBudget, int interval, int keyframeInterval)
+    : memoryBudget(memoryBudget), interval(std::max(1, interval)), keyframeInterval(std::max(1, keyframeInterval)) {
+    worker = std::thread([this] { workerLoop(); });
+}
+
+Rewind::~Rewind() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void Rewind::frameEmulated(System* sys) {
+    if (++frame < interval) return;
+    frame = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint8_t> state;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (pending.size() >= MAX_PENDING) {
+            dropped++;
+            return;
+        }
+        if (!spare.empty()) {
+            state = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+
+    sys->saveState(state);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stateSize = state.size();
+        pending.push_back(std::move(state));
+        captured++;
+        captureSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    wake.notify_one();
+}
+
+void Rewind::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [&] { return quit || !pending.empty(); });
+        if (quit) return;
+
+        std::vector<uint8_t> state = std::move(pending.front());
+        pending.pop_front();
+        busy = true;
+        lock.unlock();
+
+        encode(state);
+
+        lock.lock();
+        spare.push_back(std::move(state));
+        busy = false;
+        if (pending.empty()) idle.notify_all();
+    }
+}
+
+void Rewind::encode(std::vector<uint8_t>& state) {
+    auto start = std::chrono::steady_clock::now();
+
+    Entry entry;
+    entry.keyframe = forceKeyframe || keyframe.size() != state.size() || sinceKeyframe >= keyframeInterval;
+    entry.size = state.size();
+    if (entry.keyframe) {
+        keyframe = state;
+        group++;
+        sinceKeyframe = 0;
+        forceKeyframe = false;
+    } else {
+        xorInto(state, keyframe);
+        sinceKeyframe++;
+    }
+    entry.group = group;
+
+    const std::vector<uint8_t>* source = &state;
+    if (!entry.keyframe) {
+        pack(state, packed);
+        source = &packed;
+    }
+    entry.packedSize = source->size();
+
+    mz_ulong size = mz_compressBound(source->size());
+    entry.data.resize(size);
+    if (mz_compress2(entry.data.data(), &size, source->data(), source->size(), MZ_BEST_SPEED) != MZ_OK) {
+        forceKeyframe = true;
+        return;
+    }
+    entry.data.resize(size);
+    entry.data.shrink_to_fit();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    keyframeSize = keyframe.capacity();
+    packedSize = packed.capacity();
+    memoryUsed += entry.data.size();
+    uncompressedBytes += entry.size;
+    compressedBytes += entry.data.size();
+    compressSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    compressed++;
+    entries.push_back(std::move(entry));
+    enforceBudget();
+}
+
+// Called with mutex locked
+size_t Rewind::bufferMemory() const {
+    size_t size = keyframeSize + packedSize + decodedKeyframe.capacity() + decoded.capacity();
+    for (const auto& state : pending) size += state.capacity();
+    for (const auto& state : spare) size += state.capacity();
+    if (busy) size += stateSize;  // State being encoded
+    return size;
+}
+
+void Rewind::enforceBudget() {
+    // Newest group is always kept
+    auto newestKeyframe = std::find_if(entries.rbegin(), entries.rend(), [](const Entry& e) { return e.keyframe; });
+    size_t keep = std::min<size_t>(newestKeyframe - entries.rbegin() + 1, entries.size());
+
+    size_t buffers = bufferMemory();
+    while (memoryUsed + buffers > memoryBudget && entries.size() > keep) {
+        // Drop whole group, deltas without keyframe can't be decoded
+        do {
+            memoryUsed -= entries.front().data.size();
+            entries.pop_front();
+        } while (entries.size() > keep && !entries.front().keyframe);
+    }
+}
+
+bool Rewind::decompress(const Entry& entry, std::vector<uint8_t>& data) {
+    std::vector<uint8_t>& target = entry.keyframe ? data : packed;
+    target.resize(entry.packedSize);
+    mz_ulong size = entry.packedSize;
+    packedSize = packed.capacity();
+    if (mz_uncompress(target.data(), &size, entry.data.data(), entry.data.size()) != MZ_OK || size != entry.packedSize) return false;
+    if (entry.keyframe) return true;
+
+    data.resize(entry.size);
+    return unpack(packed, data);
+}
+
+void Rewind::waitForWorker(std::unique_lock<std::mutex>& lock) {
+    idle.wait(lock, [&] { return pending.empty() && !busy; });
+}
+
+bool Rewind::rewind(System* sys) {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitForWorker(lock);
+    frame = 0;
+
+    // Keyframe can't be used for deltas captured after the rewind
+    forceKeyframe = true;
+    while (!entries.empty()) {
+        Entry entry = std::move(entries.back());
+        entries.pop_back();
+        memoryUsed -= entry.data.size();
+
+        if (!decompress(entry, decoded)) continue;
+
+        if (entry.keyframe) {
+            decodedKeyframe = decoded;
+            decodedGroup = entry.group;
+        } else {
+            if (decodedGroup != entry.group) {
+                // Find keyframe of this group, it is the newest keyframe left
+                auto key = std::find_if(entries.rbegin(), entries.rend(), [](const Entry& e) { return e.keyframe; });
+                if (key == entries.rend() || key->group != entry.group || !decompress(*key, decodedKeyframe)) continue;
+                decodedGroup = entry.group;
+            }
+            xorInto(decoded, decodedKeyframe);
+        }
+
+        if (sys->loadState(decoded)) return true;
+    }
+    return false;
+}
+
+void Rewind::clear() {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitForWorker(lock);
+    entries.clear();
+    memoryUsed = 0;
+    forceKeyframe = true;
+    decodedGroup = UINT64_MAX;
+    frame = 0;
+}
+
+Rewind::Stats Rewind::getStats() {
+    std::unique_lock<std::mutex> lock(mutex);
+    Stats stats;
+    stats.entries = entries.size();
+    stats.memoryUsed = memoryUsed + bufferMemory();
+    stats.memoryBudget = memoryBudget;
+    stats.captured = captured;
+    stats.dropped = dropped;
+    stats.compressionRatio = compressedBytes != 0 ? static_cast<double>(uncompressedBytes) / compressedBytes : 0;
+    stats.captureMs = captured != 0 ? 1000.0 * captureSeconds / captured : 0;
+    stats.compressMs = compressed != 0 ? 1000.0 * compressSeconds / compressed : 0;
+    return stats;
+}
+};  // namespace state
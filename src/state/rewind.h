@@ -0,0 +1,104 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct System;
+
+namespace state {
+/**
+ * Rewind buffer with memory budget.
+ * States captured every interval frames are stored as XOR deltas against the last keyframe
+ * (RAM, VRAM and SPU RAM change little between frames, deltas are mostly zeros).
+ * Only changed blocks of a delta are compressed.
+ * Emulation thread only copies the state, XOR and compression run on worker thread.
+ * When budget is exceeded the oldest keyframe is dropped together with its deltas.
+ */
+class Rewind {
+   public:
+    static const size_t BLOCK_SIZE = 4096;  // Granularity of skipping unchanged data in deltas
+
+    struct Stats {
+        size_t entries = 0;     // States available for rewinding
+        size_t memoryUsed = 0;  // Compressed entries and state buffers, in bytes
+        size_t memoryBudget = 0;
+        uint64_t captured = 0;  // States captured since creation
+        uint64_t dropped = 0;   // Captures skipped because worker was behind
+        double compressionRatio = 0;
+        double captureMs = 0;   // Average cost on emulation thread
+        double compressMs = 0;  // Average cost on worker thread
+    };
+
+    Rewind(size_t memoryBudget, int interval = 1, int keyframeInterval = 60);
+    ~Rewind();
+
+    // Called after every emulated frame
+    void frameEmulated(System* sys);
+    // Loads last captured state and removes it, false if there is nothing to rewind to
+    bool rewind(System* sys);
+    void clear();
+    Stats getStats();
+
+   private:
+    static const size_t MAX_PENDING = 4;
+
+    struct Entry {
+        bool keyframe;
+        uint64_t group;     // Entries of a group are deltas against its keyframe
+        size_t size;        // Uncompressed
+        size_t packedSize;  // Passed to compressor, only changed blocks of delta
+        std::vector<uint8_t> data;
+    };
+
+    const size_t memoryBudget;
+    const int interval;
+    const int keyframeInterval;
+    int frame = 0;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake, idle;
+    bool quit = false;
+    bool busy = false;
+
+    std::deque<std::vector<uint8_t>> pending;  // Captured states waiting for worker
+    std::vector<std::vector<uint8_t>> spare;   // Reused buffers
+    std::deque<Entry> entries;
+    size_t memoryUsed = 0;  // Compressed entries
+
+    // Sizes of buffers owned by worker, written under mutex so budget can be checked from any thread
+    size_t stateSize = 0;
+    size_t keyframeSize = 0;
+    size_t packedSize = 0;
+
+    // Encoder state, touched only by worker (or with worker idle)
+    std::vector<uint8_t> keyframe;
+    uint64_t group = 0;
+    int sinceKeyframe = 0;
+    bool forceKeyframe = true;
+
+    // Keyframe of entries being rewound
+    std::vector<uint8_t> decodedKeyframe;
+    uint64_t decodedGroup = UINT64_MAX;
+    std::vector<uint8_t> decoded;
+    std::vector<uint8_t> packed;  // Used by worker, or by rewind with worker idle
+
+    uint64_t captured = 0;
+    uint64_t dropped = 0;
+    uint64_t uncompressedBytes = 0;
+    uint64_t compressedBytes = 0;
+    double captureSeconds = 0;
+    double compressSeconds = 0;
+    uint64_t compressed = 0;
+
+    void workerLoop();
+    void encode(std::vector<uint8_t>& state);
+    size_t bufferMemory() const;
+    void enforceBudget();
+    bool decompress(const Entry& entry, std::vector<uint8_t>& data);
+    void waitForWorker(std::unique_lock<std::mutex>& lock);
+};
+};  // namespace state
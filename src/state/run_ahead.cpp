@@ -0,0 +1,91 @@
+#include "run_ahead.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include "system.h"
+
+namespace state {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double elapsed(Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); }
+
+void average(double& value, double sample) {
+    if (value == 0) {
+        value = sample;
+    } else {
+        value += (sample - value) * 0.05;
+    }
+}
+};  // namespace
+
+RunAhead::RunAhead(int frames, bool automatic) : frames(std::max(0, frames)), automatic(automatic), active(!automatic) {}
+
+double RunAhead::cost() const { return frameSeconds * (frames + 1) + saveSeconds + loadSeconds; }
+
+void RunAhead::runFrame(System* sys) {
+    if (restorePending) restore(sys);
+
+    auto start = Clock::now();
+    sys->emulateFrame();
+    average(frameSeconds, elapsed(start));
+
+    budgetSeconds = sys->gpu->isNtsc() ? 1.0 / 60.0 : 1.0 / 50.0;
+    if (automatic) {
+        if (!active && cost() < budgetSeconds * ENABLE_BELOW) active = true;
+        if (active && cost() > budgetSeconds * DISABLE_ABOVE) active = false;
+    }
+    if (!active || frames == 0 || sys->state != System::State::run) return;
+
+    start = Clock::now();
+    sys->saveState(state);
+    average(saveSeconds, elapsed(start));
+
+    start = Clock::now();
+    sys->suppressOutput = true;
+    for (int i = 0; i < frames && sys->state == System::State::run; i++) {
+        // Only primitives of the last frame are presented by hardware renderer
+        sys->gpu->clear();
+        // Frames in between are never shown, rasterization they don't need is skipped and discarded by restore
+        sys->gpu->skipRendering = i < frames - 1;
+        sys->emulateFrame();
+    }
+    sys->gpu->skipRendering = false;
+    sys->gpu->flushDisplayArea();
+    sys->suppressOutput = false;
+    average(frameSeconds, elapsed(start) / frames);
+
+    restorePending = true;
+
+    // Future frames are not presented if CPU halted, the real frame is shown instead
+    if (sys->state != System::State::run) {
+        restore(sys);
+        sys->state = System::State::run;
+        return;
+    }
+    ranAhead++;
+}
+
+void RunAhead::restore(System* sys) {
+    if (!restorePending) return;
+    restorePending = false;
+
+    auto start = Clock::now();
+    if (!sys->loadState(state)) {
+        printf("[RunAhead] Unable to restore state\n");
+    }
+    average(loadSeconds, elapsed(start));
+}
+
+RunAhead::Stats RunAhead::getStats() const {
+    Stats stats;
+    stats.frames = frames;
+    stats.active = active && frames != 0;
+    stats.frameMs = frameSeconds * 1000.0;
+    stats.snapshotMs = (saveSeconds + loadSeconds) * 1000.0;
+    stats.budgetMs = budgetSeconds * 1000.0;
+    stats.headroom = cost() != 0 ? budgetSeconds / cost() : 0;
+    stats.ranAhead = ranAhead;
+    return stats;
+}
+};  // namespace state
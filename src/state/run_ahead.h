@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+struct System;
+
+namespace state {
+/**
+ * Run-ahead hides input lag built into games.
+ * After the real frame the state is saved and more frames are emulated with the same input and audio suppressed.
+ * Last of them is presented, then the system is restored to the real frame.
+ * Every host frame costs (frames + 1) emulated frames and a save/load.
+ */
+class RunAhead {
+   public:
+    struct Stats {
+        int frames = 0;
+        bool active = false;     // In automatic mode run-ahead is enabled only when host is fast enough
+        double frameMs = 0;      // Average emulated frame
+        double snapshotMs = 0;   // Average save and load
+        double budgetMs = 0;     // Host frame at real speed
+        double headroom = 0;     // Budget divided by cost of run-ahead, above 1 when host sustains (frames + 1)x speed
+        uint64_t ranAhead = 0;   // Host frames presented from run-ahead state
+    };
+
+    RunAhead(int frames, bool automatic);
+
+    // Emulates real frame and runs ahead, System is left in the future state for presenting
+    void runFrame(System* sys);
+    // Returns to the state after real frame, call after presenting
+    void restore(System* sys);
+    Stats getStats() const;
+
+   private:
+    // Automatic mode hysteresis, fraction of frame budget
+    static constexpr double ENABLE_BELOW = 0.8;
+    static constexpr double DISABLE_ABOVE = 0.95;
+
+    const int frames;
+    const bool automatic;
+    bool active;
+    bool restorePending = false;
+    std::vector<uint8_t> state;
+
+    // Moving averages
+    double frameSeconds = 0;
+    double saveSeconds = 0;
+    double loadSeconds = 0;
+    double budgetSeconds = 1.0 / 60.0;
+    uint64_t ranAhead = 0;
+
+    double cost() const;
+};
+};  // namespace state
@@ -0,0 +1,89 @@
+#include "state.h"
+#include <cstdio>
+#include "miniz.h"
+
+namespace state {
+Writer::Writer(std::vector<uint8_t>& data) : data(data) {
+    Header header = {MAGIC, FORMAT_VERSION, 0, 0};
+    raw(&header, sizeof(header));
+}
+
+void Writer::finish() {
+    Header header = {MAGIC, FORMAT_VERSION, 0, static_cast<uint32_t>(position - sizeof(Header))};
+    memcpy(data.data(), &header, sizeof(header));
+    data.resize(position);
+}
+
+Reader::Reader(const uint8_t* data, size_t size) : data(data), end(size) {
+    Header header;
+    raw(&header, sizeof(header));
+    if (!valid || header.magic != MAGIC || header.version != FORMAT_VERSION || (header.flags & Header::COMPRESSED)
+        || header.size != size - sizeof(Header)) {
+        printf("[STATE] Invalid state header\n");
+        valid = false;
+        return;
+    }
+
+    while (position < end) {
+        uint32_t sectionHeader[3];
+        raw(sectionHeader, sizeof(sectionHeader));
+        if (!valid || position + sectionHeader[2] > end) {
+            printf("[STATE] Truncated state\n");
+            valid = false;
+            return;
+        }
+        sections[sectionHeader[0]] = {sectionHeader[1], position, sectionHeader[2]};
+        position += sectionHeader[2];
+    }
+}
+
+void Reader::fail(const char* reason) {
+    printf("[STATE] Section %.4s: %s\n", reinterpret_cast<const char*>(&currentSection), reason);
+    valid = false;
+}
+
+bool isCompressed(const std::vector<uint8_t>& data) {
+    if (data.size() < sizeof(Header)) return false;
+    Header header;
+    memcpy(&header, data.data(), sizeof(header));
+    return header.magic == MAGIC && (header.flags & Header::COMPRESSED);
+}
+
+std::future<std::vector<uint8_t>> compressAsync(std::vector<uint8_t> data) {
+    return std::async(std::launch::async, [data = std::move(data)] {
+        std::vector<uint8_t> output;
+        if (data.size() < sizeof(Header)) return output;
+
+        Header header;
+        memcpy(&header, data.data(), sizeof(header));
+        header.flags |= Header::COMPRESSED;
+
+        mz_ulong size = mz_compressBound(data.size() - sizeof(Header));
+        output.resize(sizeof(Header) + size);
+        if (mz_compress2(output.data() + sizeof(Header), &size, data.data() + sizeof(Header), data.size() - sizeof(Header), MZ_BEST_SPEED)
+            != MZ_OK) {
+            return std::vector<uint8_t>();
+        }
+        memcpy(output.data(), &header, sizeof(header));
+        output.resize(sizeof(Header) + size);
+        return output;
+    });
+}
+
+bool decompress(const std::vector<uint8_t>& data, std::vector<uint8_t>& output) {
+    if (!isCompressed(data)) return false;
+
+    Header header;
+    memcpy(&header, data.data(), sizeof(header));
+    header.flags &= ~Header::COMPRESSED;
+
+    output.resize(sizeof(Header) + header.size);
+    mz_ulong size = header.size;
+    if (mz_uncompress(output.data() + sizeof(Header), &size, data.data() + sizeof(Header), data.size() - sizeof(Header)) != MZ_OK
+        || size != header.size) {
+        return false;
+    }
+    memcpy(output.data(), &header, sizeof(header));
+    return true;
+}
+};  // namespace state
@@ -0,0 +1,196 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Binary save states.
+ * Every device has a single serialize(Archive&) method used for both saving (Writer) and loading (Reader),
+ * trivially copyable values and arrays are copied with memcpy (state depends on host endianness and struct layout).
+ * State consists of sections with their own versions, section with unknown version is rejected.
+ */
+namespace state {
+// Format of blob header, sections have separate versions
+const uint32_t FORMAT_VERSION = 1;
+
+inline constexpr uint32_t sectionId(const char (&name)[5]) {
+    return static_cast<uint32_t>(name[0]) | static_cast<uint32_t>(name[1]) << 8 | static_cast<uint32_t>(name[2]) << 16
+           | static_cast<uint32_t>(name[3]) << 24;
+}
+
+template <class Archive, typename T, typename = void>
+struct hasSerialize : std::false_type {};
+template <class Archive, typename T>
+struct hasSerialize<Archive, T, std::void_t<decltype(std::declval<T&>().serialize(std::declval<Archive&>()))>> : std::true_type {};
+
+// serialize() takes precedence, trivially copyable devices still hold pointers that must not be stored
+template <class Archive, typename T>
+void serializeValue(Archive& ar, T& value) {
+    if constexpr (hasSerialize<Archive, T>::value) {
+        value.serialize(ar);
+    } else {
+        static_assert(std::is_trivially_copyable_v<T>, "Type needs serialize method");
+        ar.raw(&value, sizeof(T));
+    }
+}
+
+template <class Archive, typename T, size_t size>
+void serializeValue(Archive& ar, std::array<T, size>& array) {
+    if constexpr (std::is_trivially_copyable_v<T> && !hasSerialize<Archive, T>::value) {
+        ar.raw(array.data(), sizeof(T) * size);
+    } else {
+        for (auto& value : array) serializeValue(ar, value);
+    }
+}
+
+template <class Archive, typename T>
+void serializeValue(Archive& ar, std::vector<T>& vector) {
+    static_assert(std::is_trivially_copyable_v<T>, "Only vectors of plain values are supported");
+    uint32_t size = static_cast<uint32_t>(vector.size());
+    ar.raw(&size, sizeof(size));
+    if constexpr (!Archive::saving) {
+        if (ar.ok() && size > ar.remaining() / sizeof(T)) ar.fail("size mismatch");  // Corrupted count, don't allocate it
+        vector.resize(ar.ok() ? size : 0);
+    }
+    ar.raw(vector.data(), sizeof(T) * vector.size());
+}
+
+template <class Archive, typename T>
+void serializeValue(Archive& ar, std::deque<T>& deque) {
+    static_assert(std::is_trivially_copyable_v<T>, "Only deques of plain values are supported");
+    uint32_t size = static_cast<uint32_t>(deque.size());
+    ar.raw(&size, sizeof(size));
+    if constexpr (!Archive::saving) {
+        if (ar.ok() && size > ar.remaining() / sizeof(T)) ar.fail("size mismatch");
+        deque.resize(ar.ok() ? size : 0);
+    }
+    for (auto& value : deque) ar.raw(&value, sizeof(T));
+}
+
+template <class Archive, typename A, typename B>
+void serializeValue(Archive& ar, std::pair<A, B>& pair) {
+    serializeValue(ar, pair.first);
+    serializeValue(ar, pair.second);
+}
+
+class Writer {
+   public:
+    static const bool saving = true;
+
+    // Buffer is reused, it is not reallocated if previous state had the same size
+    explicit Writer(std::vector<uint8_t>& data);
+    // Fills header and trims buffer to written size
+    void finish();
+
+    template <typename... Ts>
+    void operator()(Ts&... values) {
+        (serializeValue(*this, values), ...);
+    }
+
+    void raw(const void* ptr, size_t size) {
+        if (position + size > data.size()) data.resize(std::max(position + size, data.size() * 2));
+        memcpy(data.data() + position, ptr, size);
+        position += size;
+    }
+
+    template <typename F>
+    void section(uint32_t id, uint32_t version, F serialize) {
+        uint32_t header[3] = {id, version, 0};
+        size_t start = position;
+        raw(header, sizeof(header));
+        serialize();
+        header[2] = static_cast<uint32_t>(position - start - sizeof(header));
+        memcpy(data.data() + start, header, sizeof(header));
+    }
+
+    bool ok() const { return true; }
+
+   private:
+    std::vector<uint8_t>& data;
+    size_t position = 0;
+};
+
+class Reader {
+   public:
+    static const bool saving = false;
+
+    // Data has to outlive the reader, compressed states have to be decompressed first
+    Reader(const uint8_t* data, size_t size);
+
+    template <typename... Ts>
+    void operator()(Ts&... values) {
+        (serializeValue(*this, values), ...);
+    }
+
+    void raw(void* ptr, size_t size) {
+        if (!valid || position + size > end) {
+            valid = false;
+            return;
+        }
+        memcpy(ptr, data + position, size);
+        position += size;
+    }
+
+    template <typename F>
+    void section(uint32_t id, uint32_t version, F serialize) {
+        if (!valid) return;
+        currentSection = id;
+        auto it = sections.find(id);
+        if (it == sections.end() || it->second.version != version) {
+            fail(it == sections.end() ? "missing" : "unsupported version");
+            return;
+        }
+        position = it->second.offset;
+        end = it->second.offset + it->second.size;
+        serialize();
+        if (valid && position != end) fail("size mismatch");
+    }
+
+    // State cannot be applied to this instance (eg. configuration differs)
+    void fail(const char* reason);
+    bool hasSection(uint32_t id, uint32_t version) const {
+        auto it = sections.find(id);
+        return it != sections.end() && it->second.version == version;
+    }
+    bool ok() const { return valid; }
+    // Bytes left in current section
+    size_t remaining() const { return valid ? end - position : 0; }
+
+   private:
+    struct Section {
+        uint32_t version;
+        size_t offset;
+        size_t size;
+    };
+
+    const uint8_t* data;
+    size_t position = 0;
+    size_t end = 0;
+    bool valid = true;
+    uint32_t currentSection = 0;
+    std::unordered_map<uint32_t, Section> sections;
+};
+
+// Header written before sections
+struct Header {
+    enum Flags : uint32_t { COMPRESSED = 1 << 0 };
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t size;  // Uncompressed size of sections
+};
+const uint32_t MAGIC = sectionId("AVST");
+
+bool isCompressed(const std::vector<uint8_t>& data);
+// Compression is slow compared with saving, it is done on background thread
+std::future<std::vector<uint8_t>> compressAsync(std::vector<uint8_t> data);
+bool decompress(const std::vector<uint8_t>& data, std::vector<uint8_t>& output);
+};  // namespace state
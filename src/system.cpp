@@ -1,24 +1,66 @@
 #include "system.h"
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include "bios/functions.h"
 #include "config.h"
 #include "sound/sound.h"
+#include "state/state.h"
 #include "utils/address.h"
 #include "utils/file.h"
 #include "utils/psx_exe.h"
 
-System::System() {
+namespace {
+// Write map used when cache is isolated
+uint8_t* const isolatedPages[System::PAGE_COUNT] = {};
+
+// Layout of backing storage, scratchpad takes whole host page
+const size_t RAM_OFFSET = 0;
+const size_t BIOS_OFFSET = RAM_OFFSET + System::RAM_SIZE;
+const size_t EXPANSION_OFFSET = BIOS_OFFSET + System::BIOS_SIZE;
+const size_t SCRATCHPAD_OFFSET = EXPANSION_OFFSET + System::EXPANSION_SIZE;
+const size_t MEMORY_SIZE = SCRATCHPAD_OFFSET + System::RAM_PROTECTION_PAGE_SIZE;
+
+// Save state sections, version is bumped when layout of serialized device changes
+enum StateSection { SYSTEM, SCHEDULER, CPU, GPU, SPU, CDROM, DMA, TIMERS, MDEC, CONTROLLER, MISC };
+const std::pair<uint32_t, uint32_t> stateSections[] = {
+    {state::sectionId("SYS "), 1}, {state::sectionId("SCHD"), 2}, {state::sectionId("CPU "), 1}, {state::sectionId("GPU "), 1},
+    {state::sectionId("SPU "), 1}, {state::sectionId("CDRM"), 1}, {state::sectionId("DMA "), 1}, {state::sectionId("TIMR"), 2},
+    {state::sectionId("MDEC"), 1}, {state::sectionId("CTRL"), 1}, {state::sectionId("MISC"), 2},
+};
+};  // namespace
+
+System::System(const json& config) : config(config) {
+#ifdef FASTMEM_AVAILABLE
+    if (config["options"]["system"]["fastmem"].get<bool>()) {
+        fastmem = std::make_unique<fastmem::Fastmem>(MEMORY_SIZE);
+        if (!fastmem->isValid()) fastmem.reset();
+    }
+#endif
+    uint8_t* storage;
+    if (fastmem) {
+        storage = fastmem->getMemory();
+    } else {
+        memory.resize(MEMORY_SIZE);
+        storage = memory.data();
+    }
+    ram = storage + RAM_OFFSET;
+    bios = storage + BIOS_OFFSET;
+    expansion = storage + EXPANSION_OFFSET;
+    scratchpad = storage + SCRATCHPAD_OFFSET;
+    mapMemory();
+
     memset(bios, 0, BIOS_SIZE);
     memset(ram, 0, RAM_SIZE);
     memset(scratchpad, 0, SCRATCHPAD_SIZE);
     memset(expansion, 0, EXPANSION_SIZE);
 
+    scheduler = std::make_unique<Scheduler>(this);
     cpu = std::make_unique<mips::CPU>(this);
-    gpu = std::make_unique<gpu::GPU>();
+    gpu = std::make_unique<gpu::GPU>(this->config);
     spu = std::make_unique<spu::SPU>(this);
-    mdec = std::make_unique<mdec::MDEC>();
+    mdec = std::make_unique<mdec::MDEC>(config["debug"]["log"]["mdec"]);
 
     cdrom = std::make_unique<device::cdrom::CDROM>(this);
     controller = std::make_unique<device::controller::Controller>(this);
@@ -31,10 +73,114 @@ System::System() {
         timer[t] = std::make_unique<Timer>(this, t);
     }
 
+    gpuLineEvent = scheduler->addEvent("gpu line", [this] {
+        if (gpu->emulateGpuCycles(gpu::CYCLES_PER_LINE)) {
+            interrupt->trigger(interrupt::VBLANK);
+            frameEnded = true;
+        }
+        if (gpu->gpuLine > gpu::LINE_VBLANK_START_NTSC) timer[1]->vblank();
+        scheduler->reschedule(gpuLineEvent, gpu::CYCLES_PER_LINE);
+    });
+    scheduler->schedule(gpuLineEvent, gpu::CYCLES_PER_LINE);
+
+    spuEvent = scheduler->addEvent("spu sample", [this] {
+        spu->step(cdrom.get());
+        if (spu->bufferReady) {
+            spu->bufferReady = false;
+            // Samples of run-ahead frames are dropped, restored SPU produces them again
+            if (!suppressOutput) {
+                if (audioCallback) {
+                    audioCallback(spu->audioBuffer.data(), spu->audioBuffer.size());
+                } else {
+                    Sound::appendBuffer(spu->audioBuffer.data(), spu->audioBuffer.size());
+                }
+            }
+        }
+
+        // Sample rate doesn't divide system clock, carry the remainder
+        spuClockRemainder += SYSTEM_CLOCK % AUDIO_SAMPLE_RATE;
+        int cycles = SYSTEM_CLOCK / AUDIO_SAMPLE_RATE + spuClockRemainder / AUDIO_SAMPLE_RATE;
+        spuClockRemainder %= AUDIO_SAMPLE_RATE;
+        scheduler->reschedule(spuEvent, cycles);
+    });
+    scheduler->schedule(spuEvent, SYSTEM_CLOCK / AUDIO_SAMPLE_RATE);
+
     debugOutput = config["debug"]["log"]["system"].get<int>();
     biosLog = config["debug"]["log"]["bios"];
 }
 
+void System::mapMemory() {
+    readPages.assign(PAGE_COUNT, nullptr);
+    writePages.assign(PAGE_COUNT, nullptr);
+    ramProtectedPages.fill(0);
+
+    // Every 512MB segment (KUSEG, KSEG0, KSEG1 ...) mirrors physical address space
+    for (uint32_t segment = 0; segment < 8; segment++) {
+        auto map = [&](uint32_t base, uint8_t* memory, size_t storageOffset, uint32_t size, uint32_t mirrors, bool writable) {
+            for (uint32_t offset = 0; offset < size * mirrors; offset += PAGE_SIZE) {
+                uint32_t page = ((segment << 29) | (base + offset)) >> PAGE_BITS;
+                readPages[page] = memory + offset % size;
+                if (writable) writePages[page] = memory + offset % size;
+            }
+            if (!fastmem) return;
+            for (uint32_t mirror = 0; mirror < mirrors; mirror++) {
+                if (!fastmem->map((segment << 29) | (base + mirror * size), storageOffset, size, writable)) {
+                    printf("[FASTMEM] Unable to map 0x%08x\n", (segment << 29) | (base + mirror * size));
+                }
+            }
+        };
+        map(RAM_BASE, ram, RAM_OFFSET, RAM_SIZE, 4, true);
+        map(EXPANSION_BASE, expansion, EXPANSION_OFFSET, EXPANSION_SIZE, 1, true);
+        map(BIOS_BASE, bios, BIOS_OFFSET, BIOS_SIZE, 1, false);
+
+        // Scratchpad shares page with IO, only host page is mapped (rest of it is excluded in readMemory/writeMemory)
+        if (fastmem) fastmem->map((segment << 29) | SCRATCHPAD_BASE, SCRATCHPAD_OFFSET, RAM_PROTECTION_PAGE_SIZE, true);
+    }
+
+    if (fastmem) fastmemBase = fastmem->getBase();
+    setCacheIsolation(false);
+}
+
+bool System::unshareMemory() {
+    if (!fastmem) return true;
+
+    // Mappings are created from scratch, cached code has to drop its RAM write protection first
+    cpu->blockCache->flush();
+    if (cpu->recompiler) cpu->recompiler->reset();
+    if (!fastmem->unshare()) {
+        printf("[FASTMEM] Unable to copy shared memory\n");
+        return false;
+    }
+    mapMemory();
+    setCacheIsolation(cpu->cop0.status.isolateCache);
+    return true;
+}
+
+void System::setCacheIsolation(bool isolated) {
+    writeMap = isolated ? isolatedPages : writePages.data();
+    if (fastmem) fastmemWriteBase = isolated ? fastmem->getEmptyBase() : fastmem->getBase();
+}
+
+void System::setRamWriteProtection(uint32_t offset, bool protect) {
+    offset &= ~(RAM_PROTECTION_PAGE_SIZE - 1);
+
+    // Page table is protected as long as any of its 4KB pages is
+    uint8_t& protectedPages = ramProtectedPages[offset / PAGE_SIZE];
+    protectedPages += protect ? 1 : -1;
+    bool updatePageTable = protectedPages == (protect ? 1 : 0);
+
+    for (uint32_t segment = 0; segment < 8; segment++) {
+        for (uint32_t mirror = 0; mirror < 4; mirror++) {
+            uint32_t address = (segment << 29) | (RAM_BASE + mirror * RAM_SIZE + offset);
+            if (updatePageTable) {
+                uint32_t pageOffset = offset & ~(PAGE_SIZE - 1);
+                writePages[address >> PAGE_BITS] = protect ? nullptr : ram + pageOffset;
+            }
+            if (fastmem) fastmem->setWriteProtection(address, RAM_PROTECTION_PAGE_SIZE, protect);
+        }
+    }
+}
+
 // Note: stupid static_casts and asserts are only to supress MSVC warnings
 
 // Warning: This function does not check array boundaries. Make sure that address is aligned!
@@ -89,18 +235,9 @@ constexpr void write_io(Device& periph, uint32_t addr, T data) {
     }
 }
 
-#ifdef ENABLE_IO_LOG
-#define LOG_IO(mode, size, addr, data, pc) ioLogList.push_back({(mode), (size), (addr), (data), (pc)})
-#else
-#define LOG_IO(mode, size, addr, data, pc)
-#endif
-
-#define READ_IO(begin, end, periph)                                              \
-    if (addr >= (begin) && addr < (end)) {                                       \
-        auto data = read_io<T>((periph), addr - (begin));                        \
-                                                                                 \
-        LOG_IO(IO_LOG_ENTRY::MODE::READ, sizeof(T) * 8, address, data, cpu->PC); \
-        return data;                                                             \
+#define READ_IO(begin, end, periph)                  \
+    if (addr >= (begin) && addr < (end)) {           \
+        return read_io<T>((periph), addr - (begin)); \
     }
 
 #define READ_IO32(begin, end, periph)                                                                          \
@@ -111,17 +248,13 @@ constexpr void write_io(Device& periph, uint32_t addr, T data) {
         } else {                                                                                               \
             printf("R Unsupported access to " #periph " with bit size %d\n", static_cast<int>(sizeof(T) * 8)); \
         }                                                                                                      \
-                                                                                                               \
-        LOG_IO(IO_LOG_ENTRY::MODE::READ, sizeof(T) * 8, address, data, cpu->PC);                               \
         return data;                                                                                           \
     }
 
-#define WRITE_IO(begin, end, periph)                                              \
-    if (addr >= (begin) && addr < (end)) {                                        \
-        write_io<T>((periph), addr - (begin), data);                              \
-                                                                                  \
-        LOG_IO(IO_LOG_ENTRY::MODE::WRITE, sizeof(T) * 8, address, data, cpu->PC); \
-        return;                                                                   \
+#define WRITE_IO(begin, end, periph)                 \
+    if (addr >= (begin) && addr < (end)) {           \
+        write_io<T>((periph), addr - (begin), data); \
+        return;                                      \
     }
 
 #define WRITE_IO32(begin, end, periph)                                                                         \
@@ -131,8 +264,6 @@ constexpr void write_io(Device& periph, uint32_t addr, T data) {
         } else {                                                                                               \
             printf("W Unsupported access to " #periph " with bit size %d\n", static_cast<int>(sizeof(T) * 8)); \
         }                                                                                                      \
-                                                                                                               \
-        LOG_IO(IO_LOG_ENTRY::MODE::WRITE, sizeof(T) * 8, address, data, cpu->PC);                              \
         return;                                                                                                \
     }
 
@@ -140,20 +271,55 @@ template <typename T>
 INLINE T System::readMemory(uint32_t address) {
     static_assert(std::is_same<T, uint8_t>() || std::is_same<T, uint16_t>() || std::is_same<T, uint32_t>(), "Invalid type used");
 
-    uint32_t addr = align_mips<T>(address);
+#ifdef FASTMEM_AVAILABLE
+    if (fastmemBase != nullptr && likely(!isFastmemExcluded(address))) {
+        return fastmem::read<T>(this, address & ~(sizeof(T) - 1), fastmemBase);
+    }
+#endif
 
-    if (in_range<RAM_BASE, RAM_SIZE * 4>(addr)) {
-        return read_fast<T>(ram, (addr - RAM_BASE) & (RAM_SIZE - 1));
+    uint8_t* page = readPages[address >> PAGE_BITS];
+    if (likely(page != nullptr)) {
+        return read_fast<T>(page, address & (PAGE_SIZE - 1));
+    }
+    return readSlow<T>(address);
+}
+
+template <typename T>
+INLINE void System::writeMemory(uint32_t address, T data) {
+    static_assert(std::is_same<T, uint8_t>() || std::is_same<T, uint16_t>() || std::is_same<T, uint32_t>(), "Invalid type used");
+
+#ifdef FASTMEM_AVAILABLE
+    if (fastmemBase != nullptr && likely(!isFastmemExcluded(address))) {
+        return fastmem::write<T>(this, address & ~(sizeof(T) - 1), data, fastmemWriteBase);
     }
-    if (in_range<EXPANSION_BASE, EXPANSION_SIZE>(addr)) {
-        return read_fast<T>(expansion, addr - EXPANSION_BASE);
+#endif
+
+    uint8_t* page = writeMap[address >> PAGE_BITS];
+    if (likely(page != nullptr)) {
+        return write_fast<T>(page, address & (PAGE_SIZE - 1), data);
     }
+    writeSlow<T>(address, data);
+}
+
+bool System::isPollingSafe(uint32_t address) {
+    return in_range<0x1f801044, 4>(address)        // JOY_STAT
+           || in_range<0x1f801070, 8>(address)     // I_STAT, I_MASK
+           || in_range<0x1f801080, 0x80>(address)  // DMA
+           || in_range<0x1f801800, 1>(address)     // CDROM status
+           || in_range<0x1f801814, 4>(address)     // GPUSTAT
+           || in_range<0x1f801daa, 2>(address)     // SPUCNT
+           || in_range<0x1f801dae, 2>(address);    // SPUSTAT
+}
+
+template <typename T>
+T System::readSlow(uint32_t address) {
+    uint32_t addr = align_mips<T>(address);
+
     if (in_range<SCRATCHPAD_BASE, SCRATCHPAD_SIZE>(addr)) {
         return read_fast<T>(scratchpad, addr - SCRATCHPAD_BASE);
     }
-    if (in_range<BIOS_BASE, BIOS_SIZE>(addr)) {
-        return read_fast<T>(bios, addr - BIOS_BASE);
-    }
+
+    if (!isPollingSafe(addr)) volatileRead = true;
 
     READ_IO(0x1f801000, 0x1f801024, memoryControl);
     READ_IO(0x1f801040, 0x1f801050, controller);
@@ -171,27 +337,24 @@ INLINE T System::readMemory(uint32_t address) {
     READ_IO(0x1f802000, 0x1f802067, expansion2);
 
     if (in_range<0xfffe0130, 4>(address)) {
-        auto data = read_io<T>(memoryControl, address);
-        LOG_IO(IO_LOG_ENTRY::MODE::READ, sizeof(T) * 8, address, data, cpu->PC);
-        return data;
+        return read_io<T>(memoryControl, address);
     }
 
     printf("R Unhandled address at 0x%08x\n", address);
     return 0;
 }
-template <typename T>
-INLINE void System::writeMemory(uint32_t address, T data) {
-    static_assert(std::is_same<T, uint8_t>() || std::is_same<T, uint16_t>() || std::is_same<T, uint32_t>(), "Invalid type used");
 
+template <typename T>
+void System::writeSlow(uint32_t address, T data) {
     if (unlikely(cpu->cop0.status.isolateCache)) return;
 
     uint32_t addr = align_mips<T>(address);
 
+    // Write protected page with cached code
     if (in_range<RAM_BASE, RAM_SIZE * 4>(addr)) {
-        return write_fast<T>(ram, (addr - RAM_BASE) & (RAM_SIZE - 1), data);
-    }
-    if (in_range<EXPANSION_BASE, EXPANSION_SIZE>(addr)) {
-        return write_fast<T>(expansion, addr - EXPANSION_BASE, data);
+        uint32_t offset = (addr - RAM_BASE) & (RAM_SIZE - 1);
+        cpu->blockCache->invalidate(offset);
+        return write_fast<T>(ram, offset, data);
     }
     if (in_range<SCRATCHPAD_BASE, SCRATCHPAD_SIZE>(addr)) {
         return write_fast<T>(scratchpad, addr - SCRATCHPAD_BASE, data);
@@ -215,13 +378,19 @@ INLINE void System::writeMemory(uint32_t address, T data) {
 
     if (in_range<0xfffe0130, 4>(address)) {
         write_io<T>(memoryControl, 0xfffe0130, data);
-        LOG_IO(IO_LOG_ENTRY::MODE::WRITE, sizeof(T) * 8, address, data, cpu->PC);
         return;
     }
 
     printf("W Unhandled address at 0x%08x: 0x%02x\n", address, data);
 }
 
+template uint8_t System::readSlow<uint8_t>(uint32_t address);
+template uint16_t System::readSlow<uint16_t>(uint32_t address);
+template uint32_t System::readSlow<uint32_t>(uint32_t address);
+template void System::writeSlow<uint8_t>(uint32_t address, uint8_t data);
+template void System::writeSlow<uint16_t>(uint32_t address, uint16_t data);
+template void System::writeSlow<uint32_t>(uint32_t address, uint32_t data);
+
 uint8_t System::readMemory8(uint32_t address) { return readMemory<uint8_t>(address); }
 
 uint16_t System::readMemory16(uint32_t address) { return readMemory<uint16_t>(address); }
@@ -316,74 +485,91 @@ void System::singleStep() {
     cpu->executeInstructions(1);
     state = State::pause;
 
-    dma->step();
-    cdrom->step();
-    timer[0]->step(3);
-    timer[1]->step(3);
-    timer[2]->step(3);
-    controller->step();
-    spu->step(cdrom.get());
-
-    if (gpu->emulateGpuCycles(3)) {
-        interrupt->trigger(interrupt::VBLANK);
-    }
+    scheduler->update();
 }
 
 void System::emulateFrame() {
-#ifdef ENABLE_IO_LOG
     ioLogList.clear();
-#endif
     cpu->gte.log.clear();
     gpu->gpuLogList.clear();
 
-    gpu->prevVram = gpu->vram;
-    int systemCycles = 300;
-    for (;;) {
-        if (!cpu->executeInstructions(systemCycles / 3)) {
-            // printf("CPU Halted\n");
-            return;
+    if (!suppressOutput) gpu->prevVram = gpu->vram;
+    frameEnded = false;
+    while (!frameEnded) {
+        // Run CPU until nearest event (or until device schedules an earlier one)
+        int cycles = scheduler->getCyclesToNextEvent();
+        int instructions = scheduler->instructionsFor(cycles);
+        bool running;
+        if (unlikely(scheduler->profiling)) {
+            auto start = std::chrono::steady_clock::now();
+            running = cpu->executeInstructions(instructions);
+            cpuSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } else {
+            running = cpu->executeInstructions(instructions);
         }
+        scheduler->update();
 
-        dma->step();
-        cdrom->step();
-        timer[0]->step(systemCycles);
-        timer[1]->step(systemCycles);
-        timer[2]->step(systemCycles);
-
-        static float spuCounter = 0;
-        // TODO: Yey, magic numbers!
-        spuCounter += (float)systemCycles / 1.575f / (float)0x300;
-        if (spuCounter >= 1.f) {
-            spu->step(cdrom.get());
-            spuCounter -= 1.0f;
+        if (!running) {
+            // printf("CPU Halted\n");
+            return;
         }
+    }
+}
 
-        if (spu->bufferReady) {
-            spu->bufferReady = false;
-            Sound::appendBuffer(spu->audioBuffer.begin(), spu->audioBuffer.end());
-        }
+template <class Archive>
+void System::serialize(Archive& ar) {
+    auto section = [&](StateSection id, auto serialize) { ar.section(stateSections[id].first, stateSections[id].second, serialize); };
+
+    // BIOS and expansion ROM are not stored
+    section(SYSTEM, [&] {
+        ar.raw(ram, RAM_SIZE);
+        ar.raw(scratchpad, SCRATCHPAD_SIZE);
+        ar(spuClockRemainder, frameEnded);
+    });
+    section(SCHEDULER, [&] { ar(*scheduler); });
+    section(CPU, [&] { ar(*cpu); });
+    section(GPU, [&] { ar(*gpu); });
+    section(SPU, [&] { ar(*spu); });
+    section(CDROM, [&] { ar(*cdrom); });
+    section(DMA, [&] { ar(*dma); });
+    section(TIMERS, [&] { ar(*timer[0], *timer[1], *timer[2]); });
+    section(MDEC, [&] { ar(*mdec); });
+    section(CONTROLLER, [&] { controller->serialize(ar); });
+    section(MISC, [&] { ar(*interrupt, *memoryControl, *serial, *expansion2); });
+}
 
-        controller->step();
+void System::saveState(std::vector<uint8_t>& data) {
+    state::Writer ar(data);
+    serialize(ar);
+    ar.finish();
+}
 
-        if (gpu->emulateGpuCycles(systemCycles)) {
-            interrupt->trigger(interrupt::VBLANK);
-            return;  // frame emulated
-        }
+bool System::loadState(const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> decompressed;
+    const std::vector<uint8_t>* source = &data;
+    if (state::isCompressed(data)) {
+        if (!state::decompress(data, decompressed)) return false;
+        source = &decompressed;
+    }
 
-        if (gpu->gpuLine > gpu::LINE_VBLANK_START_NTSC) {
-            if (timer[1]->mode.syncEnabled) {
-                auto mode1 = static_cast<timer::CounterMode::SyncMode1>(timer[1]->mode.syncMode);
-                using modes = timer::CounterMode::SyncMode1;
-                if (mode1 == modes::resetAtVblank || mode1 == modes::resetAtVblankAndPauseOutside) {
-                    timer[1]->current._reg = 0;
-                } else if (mode1 == modes::pauseUntilVblankAndFreerun) {
-                    timer[1]->paused = false;
-                    timer[1]->mode.syncEnabled = false;
-                }
-            }
+    state::Reader ar(source->data(), source->size());
+    if (!ar.ok()) return false;
+    for (auto& [id, version] : stateSections) {
+        if (!ar.hasSection(id, version)) {
+            printf("[STATE] Section %.4s is missing or has unsupported version\n", reinterpret_cast<const char*>(&id));
+            return false;
         }
-        // Handle Timer1 - Reset on VBlank
     }
+
+    // Run-ahead and rewind load a state every frame, code that didn't change stays compiled.
+    // BIOS is not stored, its blocks are always valid.
+    cpu->blockCache->saveCodePages();
+    serialize(ar);
+    cpu->blockCache->invalidateChangedPages();
+
+    setCacheIsolation(cpu->cop0.status.isolateCache);
+    cpu->attention = true;
+    return ar.ok();
 }
 
 void System::softReset() {
@@ -434,6 +620,7 @@ bool System::loadBios(std::string path) {
     }
 
     std::copy(_bios.begin(), _bios.end(), bios);
+    cpu->blockCache->flush();
     state = State::run;
     return true;
 }
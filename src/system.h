@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include "config.h"
 #include "cpu/cpu.h"
 #include "device/cdrom/cdrom.h"
 #include "device/controller/controller.h"
@@ -12,8 +13,11 @@
 #include "device/serial.h"
 #include "device/spu/spu.h"
 #include "device/timer.h"
+#include "memory/fastmem.h"
+#include "scheduler.h"
 #include "utils/macros.h"
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -23,29 +27,17 @@
  */
 
 /**
- * #define ENABLE_LOAD_DELAY_SLOTS
- * Switch: --disable-load-delay-slots
- * Default: true
- *
- * Accurate load delay slots, slightly slower.
- * Not sure, if games depends on that (assembler should nop delay slot)
- */
-
-/**
- * #define ENABLE_BREAKPOINTS
- * Switch: --enable-breakpoints
- * Default: false
- *
- * Enables logic that is responsible for checking code breakpoints.
- * Used in auto test build
+ * Load delay slots, breakpoints, IO log and BIOS trace are selected in runtime,
+ * see mips::Feature
  */
 
 /**
- * #define ENABLE_IO_LOG
- * Switch --enable-io-log
- * Default: false
+ * #define ENABLE_FASTMEM
+ * Switch: --disable-fastmem
+ * Default: true
  *
- * Enables IO access buffer log
+ * Guest memory mapped into host address space, RAM access without any lookups.
+ * Linux x86-64 only, enabled in runtime with options.system.fastmem
  */
 
 namespace bios {
@@ -71,15 +63,45 @@ struct System {
     static const int SCRATCHPAD_SIZE = 1024;
     static const int EXPANSION_SIZE = 1 * 1024 * 1024;
     static const int IO_SIZE = 0x2000;
+
+    // Memory map granularity
+    static const int PAGE_BITS = 16;
+    static const int PAGE_SIZE = 1 << PAGE_BITS;
+    static const int PAGE_COUNT = 1 << (32 - PAGE_BITS);
+
+    // Timing, devices are clocked in system cycles (GPU clock)
+    static const int SYSTEM_CLOCK = 53693175;
+    static const int CYCLES_PER_INSTRUCTION = 3;
+    static const int AUDIO_SAMPLE_RATE = 44100;
+
+    // Granularity of RAM write protection (cached code)
+    static const int RAM_PROTECTION_PAGE_SIZE = 4 * 1024;
+
     State state = State::stop;
 
-    uint8_t bios[BIOS_SIZE];
-    uint8_t ram[RAM_SIZE];
-    uint8_t scratchpad[SCRATCHPAD_SIZE];
-    uint8_t expansion[EXPANSION_SIZE];
+    // Copy of configuration taken when instance is created, devices read options only from here.
+    // Instances don't share any state, frontend updates this copy (and reloads devices) when options change.
+    json config;
+
+    uint8_t* bios;
+    uint8_t* ram;
+    uint8_t* scratchpad;
+    uint8_t* expansion;
 
     bool debugOutput = true;  // Print BIOS logs
 
+    std::unique_ptr<Scheduler> scheduler;
+    Scheduler::EventId gpuLineEvent;
+    Scheduler::EventId spuEvent;
+    int spuClockRemainder = 0;
+    bool frameEnded = false;
+    // Host time spent in CPU slices (device accesses done by CPU included), measured if scheduler->profiling is set
+    double cpuSeconds = 0;
+    // Receives interleaved stereo samples instead of global Sound buffer (many instances in one process)
+    std::function<void(const int16_t* samples, size_t count)> audioCallback;
+    // Frames emulated only to be discarded later (run-ahead), audio is dropped
+    bool suppressOutput = false;
+
     // Devices
     std::unique_ptr<mips::CPU> cpu;
 
@@ -95,15 +117,55 @@ struct System {
     std::unique_ptr<Serial> serial;
     std::array<std::unique_ptr<Timer>, 3> timer;
 
+    // Host pointers for every 64KB page of address space (all mirrors included),
+    // nullptr pages (IO, scratchpad, RAM with cached code) are handled by readSlow/writeSlow
+    std::vector<uint8_t*> readPages;
+    std::vector<uint8_t*> writePages;
+    uint8_t* const* writeMap;  // writePages or empty map if cache is isolated
+    std::array<uint8_t, RAM_SIZE / PAGE_SIZE> ramProtectedPages;  // Number of protected 4KB pages in each 64KB page
+
+    // Host address space mapping, used instead of page tables if enabled
+    std::unique_ptr<fastmem::Fastmem> fastmem;
+    uint8_t* fastmemBase = nullptr;
+    uint8_t* fastmemWriteBase = nullptr;  // fastmemBase or empty window if cache is isolated
+    std::vector<uint8_t> memory;          // Backing storage for bios, ram, scratchpad and expansion without fastmem
+
+    // Set by reads of IO registers with side effects or time dependent value (idle loop can't be skipped)
+    bool volatileRead = false;
+
     template <typename T>
     INLINE T readMemory(uint32_t address);
     template <typename T>
     INLINE void writeMemory(uint32_t address, T data);
+    template <typename T>
+    T readSlow(uint32_t address);
+    template <typename T>
+    void writeSlow(uint32_t address, T data);
+
+    void mapMemory();
+    // Writes to isolated cache are dropped (cop0.status.isolateCache)
+    void setCacheIsolation(bool isolated);
+    // Writes to protected 4KB RAM page go through slow path which invalidates cached code
+    void setRamWriteProtection(uint32_t offset, bool protect);
+    // Called in child process after fork(), fastmem storage would be shared with parent otherwise
+    // (plain memory is private copy-on-write already)
+    bool unshareMemory();
+    // IO registers are accessed often, faulting on them would be too slow
+    static INLINE bool isIo(uint32_t address) {
+        return (address & 0x1fffffff) - static_cast<uint32_t>(IO_BASE) < static_cast<uint32_t>(IO_SIZE);
+    }
+    // Scratchpad shares host page with unused addresses, fastmem maps the whole page so they go through slow path with IO
+    static INLINE bool isFastmemExcluded(uint32_t address) {
+        const uint32_t begin = SCRATCHPAD_BASE + SCRATCHPAD_SIZE;
+        return (address & 0x1fffffff) - begin < static_cast<uint32_t>(IO_BASE + IO_SIZE) - begin;
+    }
+    // Status registers that change only in scheduled events and have no read side effects
+    static bool isPollingSafe(uint32_t address);
     void singleStep();
     void handleBiosFunction();
     void handleSyscallFunction();
 
-    System();
+    explicit System(const json& config = ::config);
     uint8_t readMemory8(uint32_t address);
     uint16_t readMemory16(uint32_t address);
     uint32_t readMemory32(uint32_t address);
@@ -114,6 +176,14 @@ struct System {
     void emulateFrame();
     void softReset();
 
+    // Save states, valid only between frames (not during emulateFrame).
+    // Buffer is reused, saving doesn't allocate if it has enough capacity from previous save.
+    // Loading checks all sections first, corrupted section contents leave the instance partially loaded (false is returned).
+    void saveState(std::vector<uint8_t>& data);
+    bool loadState(const std::vector<uint8_t>& data);
+    template <class Archive>
+    void serialize(Archive& ar);
+
     // Helpers
     int biosLog = 0;
     bool printStackTrace = false;
@@ -122,7 +192,7 @@ struct System {
     bool loadExeFile(const std::vector<uint8_t>& _exe);
     void dumpRam();
 
-#ifdef ENABLE_IO_LOG
+    bool ioLog = false;  // Log IO accesses done by CPU in ioLogList
     struct IO_LOG_ENTRY {
         enum class MODE { READ, WRITE } mode;
 
@@ -133,5 +203,4 @@ struct System {
     };
 
     std::vector<IO_LOG_ENTRY> ioLogList;
-#endif
 };
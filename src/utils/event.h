@@ -9,6 +9,7 @@ namespace Config {
 struct Graphics {};
 struct Gte {};
 struct Controller {};
+struct Cpu {};
 };  // namespace Config
 
 namespace File {
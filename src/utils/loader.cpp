@@ -0,0 +1,45 @@
+#include "loader.h"
+#include <algorithm>
+#include "disc/format/chd_format.h"
+#include "disc/format/cue_parser.h"
+#include "utils/file.h"
+#include "utils/psf.h"
+
+bool bootstrap(System* sys) {
+    sys->cpu->breakpoints.emplace(0x80030000, mips::CPU::Breakpoint(true));
+    while (sys->state == System::State::run) sys->emulateFrame();
+    return sys->state == System::State::pause;
+}
+
+bool loadFile(System* sys, const std::string& path) {
+    std::string ext = getExtension(path);
+    std::transform(ext.begin(), ext.end(), ext.begin(), tolower);
+
+    if (ext == "psf" || ext == "minipsf") {
+        if (!bootstrap(sys) || !loadPsf(sys, path)) return false;
+        sys->state = System::State::run;
+        return true;
+    }
+
+    if (ext == "exe" || ext == "psexe") {
+        // Replace shell with .exe contents
+        if (!bootstrap(sys) || !sys->loadExeFile(getFileContents(path))) return false;
+        sys->state = System::State::run;
+        return true;
+    }
+
+    std::unique_ptr<disc::Disc> disc;
+    if (ext == "chd") {
+        disc = disc::format::Chd::open(path);
+    } else if (ext == "cue") {
+        disc::format::CueParser parser;
+        disc = parser.parse(path.c_str());
+    } else if (ext == "iso" || ext == "bin" || ext == "img") {
+        disc = disc::format::Cue::fromBin(path.c_str());
+    }
+    if (!disc) return false;
+
+    sys->cdrom->disc = std::move(disc);
+    sys->cdrom->setShell(false);
+    return true;
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include "system.h"
+
+// Run BIOS until shell is about to be executed
+bool bootstrap(System* sys);
+
+// Disc image (cue, bin, iso, img, chd) is inserted, exe and psf replace the shell (BIOS is run first)
+bool loadFile(System* sys, const std::string& path);
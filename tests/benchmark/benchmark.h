@@ -0,0 +1,20 @@
+#pragma once
+#include <chrono>
+#include <functional>
+
+namespace benchmark {
+// Runs function given number of times, returns best wall time in seconds
+inline double measure(const std::function<void()>& function, int runs = 5) {
+    double best = 0;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0 || time < best) best = time;
+    }
+    return best;
+}
+
+void cpu();
+void gte();
+};  // namespace benchmark
@@ -0,0 +1,55 @@
+#include <cstdio>
+#include <memory>
+#include "benchmark.h"
+#include "config.h"
+#include "system.h"
+
+namespace {
+const uint32_t PROGRAM_BASE = 0x80010000;
+const int INSTRUCTIONS = 20000000;
+const int SLICE = 1000;
+
+// ALU, SPECIAL and memory instructions in a tight loop
+const uint32_t program[] = {
+    0x3c08000f,  // start: lui t0, 0x000f
+    0x35084240,  // ori t0, t0, 0x4240
+    0x25290003,  // loop: addiu t1, t1, 3
+    0x01285026,  // xor t2, t1, t0
+    0xafaa0000,  // sw t2, 0(sp)
+    0x8fab0000,  // lw t3, 0(sp)
+    0x01696021,  // addu t4, t3, t1
+    0x000c6880,  // sll t5, t4, 2
+    0x2508ffff,  // addiu t0, t0, -1
+    0x1500fff8,  // bne t0, zero, loop
+    0x00000000,  // nop
+    0x08004000,  // j start
+    0x00000000,  // nop
+};
+
+void run(const char* name, CpuCore core, bool loadDelaySlots) {
+    config["options"]["system"]["cpu_core"] = core;
+    config["options"]["system"]["load_delay_slots"] = loadDelaySlots;
+    auto sys = std::make_unique<System>();
+    for (size_t i = 0; i < sizeof(program) / sizeof(program[0]); i++) {
+        sys->writeMemory32(PROGRAM_BASE + i * 4, program[i]);
+    }
+    sys->cpu->setPC(PROGRAM_BASE);
+    sys->cpu->reg[29] = 0x80100000;
+    sys->state = System::State::run;
+
+    double time = benchmark::measure([&] {
+        for (int i = 0; i < INSTRUCTIONS / SLICE; i++) sys->cpu->executeInstructions(SLICE);
+    });
+    printf("  %-20s %-14s %7.1f MIPS\n", name, loadDelaySlots ? "delay slots" : "no delay slots", INSTRUCTIONS / time / 1e6);
+}
+};  // namespace
+
+namespace benchmark {
+void cpu() {
+    for (bool loadDelaySlots : {true, false}) {
+        run("interpreter", CpuCore::INTERPRETER, loadDelaySlots);
+        run("cached interpreter", CpuCore::CACHED_INTERPRETER, loadDelaySlots);
+        run("jit", CpuCore::JIT, loadDelaySlots);
+    }
+}
+};  // namespace benchmark
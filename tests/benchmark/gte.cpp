@@ -0,0 +1,55 @@
+#include <cstdio>
+#include "benchmark.h"
+#include "cpu/gte/gte.h"
+
+namespace {
+const int COMMANDS = 1000000;
+
+struct Command {
+    const char* name;
+    uint32_t opcode;
+};
+
+// Opcodes as used by PsyQ library (sf bit set, lm where applicable)
+const Command commands[] = {
+    {"RTPS", 0x00180001},
+    {"RTPT", 0x00280030},
+    {"NCLIP", 0x01400006},
+    {"OP", 0x0170000c},
+    {"DPCS", 0x00780010},
+    {"INTPL", 0x00980011},
+    {"MVMVA rt*v0+tr", 0x00480012},
+    {"MVMVA ll*v0", 0x004a6012},
+    {"MVMVA lc*ir+bk", 0x004da012},
+    {"NCDS", 0x00e80413},
+    {"CDP", 0x01280414},
+    {"NCDT", 0x00f80416},
+    {"NCCS", 0x0108041b},
+    {"CC", 0x0138041c},
+    {"NCS", 0x00c8041e},
+    {"NCT", 0x00d80420},
+    {"SQR", 0x00a80428},
+    {"DCPL", 0x00680029},
+    {"DPCT", 0x00f8002a},
+    {"AVSZ3", 0x0158002d},
+    {"AVSZ4", 0x0168002e},
+    {"GPF", 0x0198003d},
+    {"GPL", 0x01a8003e},
+    {"NCCT", 0x0118043f},
+};
+};  // namespace
+
+namespace benchmark {
+void gte() {
+    GTE gte;
+    for (int r = 0; r < 63; r++) gte.write(r, (0x01230456 * (r + 1)) & 0x0fff0fff);
+
+    for (auto& c : commands) {
+        gte::Command command(c.opcode);
+        double time = benchmark::measure([&] {
+            for (int i = 0; i < COMMANDS; i++) gte.command(command);
+        });
+        printf("  %-16s %6.1f ns\n", c.name, time / COMMANDS * 1e9);
+    }
+}
+};  // namespace benchmark
@@ -0,0 +1,35 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "benchmark.h"
+#include "config.h"
+
+namespace {
+struct Benchmark {
+    const char* name;
+    void (*function)();
+};
+
+const std::vector<Benchmark> benchmarks = {
+    {"cpu", benchmark::cpu},
+    {"gte", benchmark::gte},
+};
+};  // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--help") == 0) {
+        printf("usage: avocado_benchmark [name]\n  available:");
+        for (auto& b : benchmarks) printf(" %s", b.name);
+        printf("\n");
+        return 0;
+    }
+
+    config["debug"]["log"]["system"] = 0;
+
+    for (auto& b : benchmarks) {
+        if (argc > 1 && strcmp(argv[1], b.name) != 0) continue;
+        printf("%s:\n", b.name);
+        b.function();
+    }
+    return 0;
+}
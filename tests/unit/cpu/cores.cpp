@@ -0,0 +1,189 @@
+#include <catch.hpp>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../../../tools/aot/translator.h"
+#include "../system_helpers.h"
+#include "utils/file.h"
+
+namespace mips {
+namespace {
+const uint32_t DATA_BASE = 0x80100000;
+
+// Loop with ALU ops, load delay slots, mult/div and stores
+const uint32_t program[] = {
+    0x3c080000 | 100,  // lui t0, 100
+    0x00084402,        // srl t0, t0, 16
+    0x3c1d8010,        // lui sp, 0x8010
+    0x25290003,        // loop: addiu t1, t1, 3
+    0x01285026,        // xor t2, t1, t0
+    0xafaa0000,        // sw t2, 0(sp)
+    0x8fab0000,        // lw t3, 0(sp)
+    0x01606021,        // addu t4, t3, zero (load delay slot - old value)
+    0x01690018,        // mult t3, t1
+    0x00006812,        // mflo t5
+    0x012d001b,        // divu t1, t5
+    0x00007010,        // mfhi t6
+    0x000e7880,        // sll t7, t6, 2
+    0x01cf8023,        // subu s0, t6, t7
+    0x2a110032,        // slti s1, s0, 50
+    0xa3b10004,        // sb s1, 4(sp)
+    0x27bd0008,        // addiu sp, sp, 8
+    0x2508ffff,        // addiu t0, t0, -1
+    0x1500fff1,        // bne t0, zero, loop
+    0x01094821,        // addu t1, t0, t1 (delay slot)
+    0x1000ffff,        // b .
+    0x00000000,        // nop
+};
+
+// Waits for VBLANK in I_STAT, acknowledges it and counts frames in s0
+const uint32_t pollingProgram[] = {
+    0x3c081f80,  // loop: lui t0, 0x1f80
+    0x8d091070,  // lw t1, 0x1070(t0)
+    0x00000000,  // nop
+    0x31290001,  // andi t1, t1, 1
+    0x1120fffb,  // beq t1, zero, loop
+    0x00000000,  // nop
+    0xad001070,  // sw zero, 0x1070(t0)
+    0x26100001,  // addiu s0, s0, 1
+    0x08004000,  // j loop
+    0x00000000,  // nop
+};
+
+// Counts loop iterations in s0
+const uint32_t countingProgram[] = {
+    0x26100001,  // loop: addiu s0, s0, 1
+    0x1000fffe,  // b loop
+    0x00000000,  // nop
+};
+
+std::unique_ptr<System> run(CpuCore core, const std::string& aotModule = "") {
+    json options = defaultConfig;
+    options["options"]["system"]["cpu_core"] = core;
+    options["options"]["system"]["skip_idle_loops"] = false;
+    options["options"]["system"]["aot_module"] = aotModule;
+    auto sys = createSystem(options, program);
+    for (int i = 0; i < 50; i++) sys->cpu->executeInstructions(37);
+    return sys;
+}
+
+std::unique_ptr<System> runFrames(bool skipIdleLoops, uint32_t entry = PROGRAM_BASE) {
+    json options = defaultConfig;
+    options["options"]["system"]["cpu_core"] = CpuCore::CACHED_INTERPRETER;
+    options["options"]["system"]["skip_idle_loops"] = skipIdleLoops;
+    auto sys = createSystem(options, pollingProgram);
+    sys->cpu->setPC(entry);
+    for (int i = 0; i < 10; i++) sys->emulateFrame();
+    return sys;
+}
+
+std::unique_ptr<System> runCounting(double cpuMultiplier) {
+    json options = defaultConfig;
+    options["options"]["system"]["cpu_core"] = CpuCore::CACHED_INTERPRETER;
+    options["options"]["system"]["cpu_multiplier"] = cpuMultiplier;
+    auto sys = createSystem(options, countingProgram);
+    for (int i = 0; i < 10; i++) sys->emulateFrame();
+    return sys;
+}
+
+void compare(System* expected, System* actual) {
+    for (int r = 0; r < CPU::REGISTER_COUNT; r++) {
+        INFO("r" << r);
+        REQUIRE(actual->cpu->reg[r] == expected->cpu->reg[r]);
+    }
+    REQUIRE(actual->cpu->hi == expected->cpu->hi);
+    REQUIRE(actual->cpu->lo == expected->cpu->lo);
+    REQUIRE(actual->cpu->PC == expected->cpu->PC);
+    for (uint32_t address = DATA_BASE; address < DATA_BASE + 100 * 8; address += 4) {
+        REQUIRE(actual->readMemory32(address) == expected->readMemory32(address));
+    }
+}
+};  // namespace
+
+TEST_CASE("Cached interpreter matches interpreter", "[cpu]") {
+    auto expected = run(CpuCore::INTERPRETER);
+    auto actual = run(CpuCore::CACHED_INTERPRETER);
+    compare(expected.get(), actual.get());
+}
+
+TEST_CASE("Recompiler matches interpreter", "[cpu]") {
+    auto expected = run(CpuCore::INTERPRETER);
+    auto actual = run(CpuCore::JIT);
+    compare(expected.get(), actual.get());
+}
+
+TEST_CASE("AOT module matches interpreter", "[cpu]") {
+    ::aot::Program exe;
+    exe.base = PROGRAM_BASE;
+    exe.entry = PROGRAM_BASE;
+    exe.words.assign(std::begin(program), std::end(program));
+    ::aot::Translator translator(exe);
+    translator.discover();
+    REQUIRE(translator.getBlockCount() > 0);
+
+    // Paths with spaces and quotes reach the compiler unchanged, src directory is relative to the repository root
+    const std::string source = "aot test's module.cpp";
+#ifdef _WIN32
+    const std::string module = "aot test's module.dll";
+#else
+    const std::string module = "./aot test's module.so";
+#endif
+    REQUIRE(putFileContents(source, translator.generate()));
+    bool compiled = ::aot::compileModule(source, module, "src");
+    std::remove(source.c_str());
+    REQUIRE(compiled);
+
+    auto expected = run(CpuCore::INTERPRETER);
+    for (auto core : {CpuCore::CACHED_INTERPRETER, CpuCore::JIT}) {
+        auto actual = run(core, module);
+        REQUIRE(actual->cpu->aotModule != nullptr);
+        REQUIRE(actual->cpu->aotModule->getBlockCount() == translator.getBlockCount());
+        REQUIRE(actual->cpu->blockCache->getBlock(PROGRAM_BASE)->aot != nullptr);
+        compare(expected.get(), actual.get());
+    }
+    std::remove(module.c_str());
+}
+
+TEST_CASE("Systems running on separate threads don't affect each other", "[cpu]") {
+    auto expected = run(CpuCore::INTERPRETER);
+
+    const CpuCore cores[] = {CpuCore::INTERPRETER, CpuCore::CACHED_INTERPRETER, CpuCore::JIT};
+    std::vector<std::unique_ptr<System>> systems(6);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < systems.size(); i++) {
+        threads.emplace_back([&, i] { systems[i] = run(cores[i % 3]); });
+    }
+    for (auto& thread : threads) thread.join();
+
+    for (auto& sys : systems) compare(expected.get(), sys.get());
+}
+
+TEST_CASE("Skipping idle loop doesn't change emulated time", "[cpu]") {
+    auto expected = runFrames(false);
+    auto actual = runFrames(true);
+    REQUIRE(actual->cpu->idleCyclesSkipped > 0);
+    REQUIRE(actual->cpu->reg[16] == expected->cpu->reg[16]);
+    REQUIRE(actual->scheduler->getTimestamp() == expected->scheduler->getTimestamp());
+
+    SECTION("Loop entered from RAM mirror") {
+        // Block is shared with 0x80010000 where the loop continues after the first frame
+        auto mirrored = runFrames(true, PROGRAM_BASE + 0x200000);
+        REQUIRE(mirrored->cpu->idleCyclesSkipped > actual->cpu->idleCyclesSkipped / 2);
+        REQUIRE(mirrored->cpu->reg[16] == expected->cpu->reg[16]);
+        REQUIRE(mirrored->scheduler->getTimestamp() == expected->scheduler->getTimestamp());
+    }
+}
+
+TEST_CASE("CPU multiplier scales instructions, not emulated time", "[cpu]") {
+    auto expected = runCounting(1.0);
+    for (double multiplier : {2.0, 1.5}) {
+        INFO("multiplier " << multiplier);
+        auto actual = runCounting(multiplier);
+        REQUIRE(actual->scheduler->getCpuMultiplier() == Approx(multiplier));
+        REQUIRE(actual->cpu->reg[16] == Approx(expected->cpu->reg[16] * multiplier).epsilon(0.001));
+        // Frames end at the same line event
+        REQUIRE(actual->scheduler->getTimestamp() == Approx(expected->scheduler->getTimestamp()).margin(System::CYCLES_PER_INSTRUCTION));
+    }
+}
+}  // namespace mips
@@ -0,0 +1,65 @@
+#include <catch.hpp>
+#include <random>
+#include "cpu/gte/gte.h"
+#include "cpu/gte/simd.h"
+
+namespace gte {
+namespace {
+int16_t randomValue(std::mt19937& rng) {
+    // Mostly extreme values to hit MAC overflows and IR saturation
+    switch (rng() % 3) {
+        case 0: return (rng() & 1) ? 0x7fff : -0x8000;
+        case 1: return static_cast<int16_t>(rng() % 0x2000 - 0x1000);
+        default: return static_cast<int16_t>(rng());
+    }
+}
+};  // namespace
+
+TEST_CASE("Matrix by vector product matches scalar implementation", "[gte]") {
+    std::mt19937 rng(1);
+    for (int n = 0; n < 20000; n++) {
+        Matrix m;
+        for (auto& row : m) {
+            for (auto& value : row) value = randomValue(rng);
+        }
+        Vector<int16_t> v(randomValue(rng), randomValue(rng), randomValue(rng));
+        Vector<int32_t> tr(static_cast<int32_t>(rng()), static_cast<int32_t>(rng()), static_cast<int32_t>(rng() % 0x10000));
+        bool sf = rng() & 1;
+        bool lm = rng() & 1;
+
+        Product expected = multiplyMatrixByVectorScalar(m, v, tr, sf, lm);
+        Product result = multiplyMatrixByVector(m, v, tr, sf, lm);
+
+        INFO("iteration " << n);
+        REQUIRE(result.flags == expected.flags);
+        for (int i = 0; i < 3; i++) {
+            REQUIRE(result.value[i] == expected.value[i]);
+            REQUIRE(result.mac[i] == expected.mac[i]);
+            REQUIRE(result.ir[i] == expected.ir[i]);
+        }
+    }
+}
+
+TEST_CASE("FLAG of RTPT is calculated from registers used by command", "[gte]") {
+    std::mt19937 rng(2);
+    GTE immediate, delayed;
+    for (int n = 0; n < 1000; n++) {
+        for (int r = 0; r < 63; r++) {
+            if (r == 15 || r == 28 || r == 30) continue;
+            uint32_t value = static_cast<uint16_t>(randomValue(rng)) | (static_cast<uint16_t>(randomValue(rng)) << 16);
+            immediate.write(r, value);
+            delayed.write(r, value);
+        }
+
+        Command rtpt(0x30 | ((rng() & 1) << 19) | ((rng() & 1) << 10));
+        immediate.command(rtpt);
+        delayed.command(rtpt);
+
+        // Registers read by RTPT are overwritten before FLAG is read
+        for (int r = 0; r < 63; r++) delayed.write(r, static_cast<uint32_t>(rng()));
+
+        INFO("iteration " << n);
+        REQUIRE(delayed.read(63) == immediate.read(63));
+    }
+}
+};  // namespace gte
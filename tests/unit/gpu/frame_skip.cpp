@@ -0,0 +1,103 @@
+#include <catch.hpp>
+#include <memory>
+#include <vector>
+#include "gpu_helpers.h"
+
+namespace gpu {
+namespace {
+// Draws a frame into 320x240 buffer at given position, sprite rendered to texture at (640, 0) in the first frame is drawn twice
+void drawFrame(GPU* gpu, int bufferX, int bufferY, int frame) {
+    if (frame == 0) {
+        draw(gpu, {
+                      0xe3000000 | (640 | (0 << 10)),  // Drawing area (640, 0) - (703, 63)
+                      0xe4000000 | (703 | (63 << 10)),
+                      0xe5000000,
+                      0x20ff0000, xy(640, 0), xy(703, 0), xy(640, 63),  // Flat triangles
+                      0x2000ff00, xy(703, 0), xy(703, 63), xy(640, 63),  //
+                  });
+    }
+    draw(gpu, {
+                  0xe100010a,  // Texture page (640, 0), 15bit
+                  0xe3000000 | (bufferX | (bufferY << 10)),
+                  0xe4000000 | ((bufferX + 319) | ((bufferY + 239) << 10)),
+                  0xe5000000 | (bufferX | (bufferY << 11)),
+                  0x02101010, xy(bufferX, bufferY), xy(320, 240),         // Clear
+                  0x200000ff, xy(10, 10), xy(300, 20), xy(frame, 200),    // Background
+                  0x65808080, xy(20 + frame, 30), 0, xy(64, 64),          // Sprite
+                  0x65808080, xy(200, 100 + frame), 0, xy(64, 64),        //
+                  0x40ffffff, xy(0, 0), xy(319, 239),                     // Line
+              });
+}
+
+std::vector<uint32_t> readVram(GPU* gpu, int x, int y, int w, int h) {
+    draw(gpu, {0xc0000000, xy(x, y), xy(w, h)});
+    std::vector<uint32_t> words(w * h / 2);
+    for (auto& word : words) word = gpu->read(0);
+    return words;
+}
+};  // namespace
+
+TEST_CASE("Skipped frames produce the same VRAM", "[GPU]") {
+    // Tiled rendering of deferred primitives is tested below, this one doesn't depend on number of cores
+    json config = withRenderThreads(1);
+    auto reference = std::make_unique<GPU>(config);
+    auto skipping = std::make_unique<GPU>(config);
+
+    for (int frame = 0; frame < 6; frame++) {
+        int bufferY = (frame % 2) * 240;
+        drawFrame(reference.get(), 0, bufferY, frame);
+
+        skipping->skipRendering = frame % 3 != 2;
+        drawFrame(skipping.get(), 0, bufferY, frame);
+        if (!skipping->skipRendering) skipping->flushDisplayArea();
+    }
+    skipping->skipRendering = false;
+
+    // Primitives are kept until needed, render to texture forces them
+    REQUIRE(skipping->deferStats.deferred > 0);
+    REQUIRE(skipping->deferStats.flushed > 0);
+
+    SECTION("Primitives covered by clear are dropped") {
+        // Buffer of skipped frame is cleared again two frames later
+        REQUIRE(skipping->deferStats.dropped > 0);
+        skipping->flushDeferred();
+        REQUIRE((reference->vram == skipping->vram));
+    }
+
+    SECTION("VRAM read forces deferred primitives") {
+        REQUIRE((readVram(skipping.get(), 0, 240, 320, 240) == readVram(reference.get(), 0, 240, 320, 240)));
+        REQUIRE((readVram(skipping.get(), 0, 0, 320, 240) == readVram(reference.get(), 0, 0, 320, 240)));
+    }
+}
+
+TEST_CASE("Tiled deferred primitives sample texture before it is overwritten", "[GPU]") {
+    json serialConfig = withRenderThreads(1);
+    json tiledConfig = withRenderThreads(4);
+    auto serial = std::make_unique<GPU>(serialConfig);
+    auto tiled = std::make_unique<GPU>(tiledConfig);
+
+    for (GPU* gpu : {serial.get(), tiled.get()}) {
+        gpu->skipRendering = true;
+        draw(gpu, {
+                      0xe100010a,  // Texture page (640, 0), 15bit
+                      0xe3000000,  // Drawing area (0, 0) - (1023, 511)
+                      0xe4000000 | (1023 | (511 << 10)),
+                      0xe5000000,
+                      0x20ff0000, xy(640, 0), xy(703, 0), xy(640, 63),  // Texture
+                      0x2000ff00, xy(703, 0), xy(703, 63), xy(640, 63),  //
+                  });
+        for (int i = 0; i < 8; i++) {
+            draw(gpu, {0x65808080, xy(i * 70, (i % 2) * 100), 0, xy(64, 64)});  // Sprites sampling the texture
+        }
+        uint64_t flushed = gpu->deferStats.flushed;
+
+        // Sprites have to be rasterized before the texture changes
+        draw(gpu, {0x200000ff, xy(640, 0), xy(703, 63), xy(640, 63)});
+        REQUIRE(gpu->deferStats.flushed >= flushed + 8);
+
+        gpu->skipRendering = false;
+        gpu->flushDeferred();
+    }
+    REQUIRE((tiled->vram == serial->vram));
+}
+};  // namespace gpu
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "config.h"
+#include "device/gpu/gpu.h"
+
+namespace gpu {
+inline uint32_t xy(int x, int y) { return (y << 16) | x; }
+
+inline void draw(GPU* gpu, const std::vector<uint32_t>& words) {
+    for (auto word : words) gpu->write(0, word);
+}
+
+// GPU keeps reference to config, it has to outlive the GPU
+inline json withRenderThreads(int threads) {
+    json config = defaultConfig;
+    config["options"]["graphics"]["render_threads"] = threads;
+    return config;
+}
+};  // namespace gpu
@@ -0,0 +1,67 @@
+#include <catch.hpp>
+#include <memory>
+#include <vector>
+#include "gpu_helpers.h"
+
+namespace gpu {
+namespace {
+// Overlapping semi-transparent primitives crossing tile edges, mask bit and render to texture
+void drawScene(GPU* gpu) {
+    draw(gpu, {
+                  0xe3000000 | (640 | (0 << 10)),                                             // Texture drawn at (640, 0) - (703, 63)
+                  0xe4000000 | (703 | (63 << 10)),
+                  0xe5000000 | (640 | (0 << 11)),
+                  0x30ff0000, xy(0, 0), 0x0000ff00, xy(63, 0), 0x000000ff, xy(0, 63),         // Gouraud triangles
+                  0x3000ffff, xy(63, 0), 0x00ff00ff, xy(63, 63), 0x00ffff00, xy(0, 63),       //
+                  0xe100060a,                                                                 // Texture page (640, 0), dithering
+                  0xe3000000 | (5 | (3 << 10)),                                               // Drawing area (5, 3) - (400, 300)
+                  0xe4000000 | (400 | (300 << 10)),
+                  0xe5000000,
+                  0x02202020, xy(0, 0), xy(512, 320),                                         // Clear
+                  0x200000ff, xy(0, 10), xy(390, 40), xy(100, 290),                           // Background
+                  0x32ff8000, xy(30, 20), 0x0000ff80, xy(350, 100), 0x008000ff, xy(60, 280),  // Blended gouraud (B/2 + F/2)
+                  0xe6000001,                                                                 // Set mask
+                  0x62ff00ff, xy(100, 60), xy(150, 97),                                       // Blended rectangle
+                  0xe6000002,                                                                 // Check mask
+                  0x6000ff00, xy(70, 50), xy(200, 130),                                       // Covers rectangle above only partially
+                  0xe6000000,
+                  0xe100062a,                                                                 // B + F
+                  0x2a808080, xy(0, 200), xy(390, 150), xy(200, 310), xy(380, 310),           // Flat quad
+                  0xe100060a,
+                  0x65808080, xy(20, 100), 0, xy(64, 64),                                     // Sprites sampling render target
+                  0x67606060, xy(180, 150), 0, xy(64, 64),                                    //
+                  0x40ffffff, xy(0, 0), xy(390, 290),                                         // Lines
+                  0x42ffffff, xy(390, 10), xy(10, 250),                                       //
+              });
+
+    // Sprite sampling area drawn in the same batch ends it
+    draw(gpu, {
+                  0xe100070a,  // Texture page (640, 0), 15bit
+                  0xe3000000 | (0 | (0 << 10)),
+                  0xe4000000 | (1023 | (511 << 10)),
+                  0x20ffff00, xy(650, 10), xy(700, 20), xy(660, 60),  // Over render target
+                  0x65808080, xy(420, 300), 0, xy(64, 64),            // Sampled after the triangle
+              });
+}
+};  // namespace
+
+TEST_CASE("Tiled rendering matches single thread", "[GPU]") {
+    json serialConfig = withRenderThreads(1);
+    json tiledConfig = withRenderThreads(4);
+
+    auto serial = std::make_unique<GPU>(serialConfig);
+    auto tiled = std::make_unique<GPU>(tiledConfig);
+    REQUIRE(tiled->getRenderThreads() == 4);
+
+    for (int frame = 0; frame < 3; frame++) {
+        drawScene(serial.get());
+        drawScene(tiled.get());
+    }
+    tiled->flushDeferred();
+
+    REQUIRE(serial->batchStats.batches == 0);
+    REQUIRE(tiled->batchStats.batches > 3);
+    REQUIRE(tiled->batchStats.tiles > tiled->batchStats.batches);
+    REQUIRE((tiled->vram == serial->vram));
+}
+};  // namespace gpu
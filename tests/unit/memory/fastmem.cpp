@@ -0,0 +1,24 @@
+#include <catch.hpp>
+#include <memory>
+#include "config.h"
+#include "system.h"
+
+TEST_CASE("Fastmem maps only scratchpad of its host page", "[memory]") {
+    json options = defaultConfig;
+    options["options"]["system"]["fastmem"] = true;
+    auto sys = std::make_unique<System>(options);
+#ifdef FASTMEM_AVAILABLE
+    REQUIRE(sys->fastmemBase != nullptr);
+#endif
+
+    for (uint32_t segment : {0x00000000u, 0x80000000u, 0xa0000000u}) {
+        sys->writeMemory32(segment | (System::SCRATCHPAD_BASE + System::SCRATCHPAD_SIZE - 4), 0x12345678);
+        REQUIRE(sys->readMemory32(segment | (System::SCRATCHPAD_BASE + System::SCRATCHPAD_SIZE - 4)) == 0x12345678);
+
+        // Unused addresses between scratchpad and IO are not backed by memory
+        sys->writeMemory32(segment | (System::SCRATCHPAD_BASE + System::SCRATCHPAD_SIZE), 0x12345678);
+        sys->writeMemory8(segment | (System::IO_BASE - 1), 0x12);
+        REQUIRE(sys->readMemory32(segment | (System::SCRATCHPAD_BASE + System::SCRATCHPAD_SIZE)) == 0);
+        REQUIRE(sys->readMemory8(segment | (System::IO_BASE - 1)) == 0);
+    }
+}
@@ -0,0 +1,61 @@
+#include <catch.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "sound/time_stretch.h"
+
+namespace {
+const int SAMPLE_RATE = 44100;
+
+std::vector<int16_t> sine(double frequency, int frames) {
+    std::vector<int16_t> samples;
+    for (int i = 0; i < frames; i++) {
+        auto value = (int16_t)(std::sin(2.0 * M_PI * frequency * i / SAMPLE_RATE) * 10000);
+        samples.push_back(value);
+        samples.push_back(value);
+    }
+    return samples;
+}
+
+// Estimated from rising zero crossings of left channel
+double frequencyOf(const std::vector<int16_t>& samples) {
+    int crossings = 0;
+    for (size_t i = 2; i < samples.size(); i += 2) {
+        if (samples[i - 2] < 0 && samples[i] >= 0) crossings++;
+    }
+    return crossings * (double)SAMPLE_RATE / (samples.size() / 2);
+}
+};  // namespace
+
+TEST_CASE("Time stretch changes tempo, not pitch", "[SOUND]") {
+    auto input = sine(440.0, SAMPLE_RATE * 4);
+
+    for (double ratio : {2.0, 4.0}) {
+        TimeStretch stretch;
+        stretch.setRatio(ratio);
+
+        // Fed in chunks the size SPU produces
+        std::vector<int16_t> output;
+        for (size_t i = 0; i < input.size(); i += 1470) {
+            stretch.process(&input[i], std::min<size_t>(1470, input.size() - i), output);
+        }
+
+        INFO("ratio " << ratio);
+        double duration = (output.size() / 2) / (double)SAMPLE_RATE;
+        REQUIRE(duration == Approx(4.0 / ratio).margin(0.1));
+        REQUIRE(frequencyOf(output) == Approx(440.0).epsilon(0.02));
+    }
+}
+
+TEST_CASE("Time stretch flush returns kept input", "[SOUND]") {
+    auto input = sine(440.0, 1000);
+
+    TimeStretch stretch;
+    stretch.setRatio(2.0);
+    std::vector<int16_t> output;
+    stretch.process(input.data(), input.size(), output);
+    REQUIRE(output.empty());
+
+    stretch.flush(output);
+    REQUIRE((output == input));
+}
@@ -0,0 +1,277 @@
+#include <catch.hpp>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "../system_helpers.h"
+#include "device/controller/peripherals/digital_controller.h"
+#include "state/movie.h"
+#include "state/rewind.h"
+#include "state/run_ahead.h"
+#include "state/state.h"
+
+namespace state {
+namespace {
+// Counts in s2 while waiting for VBLANK, stores the counter in RAM and frame number in s0
+const uint32_t program[] = {
+    0x3c081f80,  // loop: lui t0, 0x1f80
+    0x8d091070,  // lw t1, 0x1070(t0)
+    0x26520007,  // addiu s2, s2, 7
+    0x31290001,  // andi t1, t1, 1
+    0x1120fffb,  // beq t1, zero, loop
+    0x00000000,  // nop
+    0xad001070,  // sw zero, 0x1070(t0)
+    0x26100001,  // addiu s0, s0, 1
+    0x08004000,  // j loop
+    0xac120100,  // sw s2, 0x100(zero)
+};
+
+json withCore(CpuCore core) {
+    json options = defaultConfig;
+    options["options"]["system"]["cpu_core"] = core;
+    return options;
+}
+
+void runFrames(System* sys, int frames) {
+    for (int i = 0; i < frames; i++) sys->emulateFrame();
+}
+
+void requireSameState(System* a, System* b) {
+    REQUIRE(a->cpu->PC == b->cpu->PC);
+    REQUIRE(a->cpu->reg == b->cpu->reg);
+    REQUIRE(a->scheduler->getTimestamp() == b->scheduler->getTimestamp());
+    REQUIRE(memcmp(a->ram, b->ram, System::RAM_SIZE) == 0);
+}
+};  // namespace
+
+TEST_CASE("Loaded state continues like the original instance", "[STATE]") {
+    for (auto core : {CpuCore::INTERPRETER, CpuCore::CACHED_INTERPRETER}) {
+        auto original = createSystem(withCore(core), program);
+        runFrames(original.get(), 5);
+
+        std::vector<uint8_t> saved;
+        original->saveState(saved);
+        runFrames(original.get(), 5);
+
+        auto restored = createSystem(withCore(core), program);
+        REQUIRE(restored->loadState(saved));
+        runFrames(restored.get(), 5);
+        requireSameState(original.get(), restored.get());
+
+        // Loading into instance that ran further rewinds it
+        REQUIRE(original->loadState(saved));
+        runFrames(original.get(), 5);
+        requireSameState(original.get(), restored.get());
+    }
+}
+
+TEST_CASE("Save state round trip is exact", "[STATE]") {
+    auto sys = createSystem(withCore(CpuCore::INTERPRETER), program);
+    runFrames(sys.get(), 3);
+
+    std::vector<uint8_t> first, second;
+    sys->saveState(first);
+    REQUIRE(sys->loadState(first));
+    sys->saveState(second);
+    REQUIRE(first == second);
+
+    SECTION("Compressed state is loaded") {
+        auto compressed = compressAsync(first).get();
+        REQUIRE(isCompressed(compressed));
+        REQUIRE(compressed.size() < first.size());
+        REQUIRE(sys->loadState(compressed));
+        sys->saveState(second);
+        REQUIRE(first == second);
+    }
+
+    SECTION("Loaded state doesn't refer to saving instance") {
+        auto other = createSystem(withCore(CpuCore::INTERPRETER), program);
+        REQUIRE(other->loadState(first));
+        sys.reset();
+        runFrames(other.get(), 3);
+
+        auto reference = createSystem(withCore(CpuCore::INTERPRETER), program);
+        runFrames(reference.get(), 6);
+        requireSameState(reference.get(), other.get());
+    }
+
+    SECTION("Invalid state is rejected") {
+        REQUIRE_FALSE(sys->loadState({}));
+        first.resize(first.size() / 2);
+        REQUIRE_FALSE(sys->loadState(first));
+    }
+}
+TEST_CASE("Corrupted element count is rejected", "[STATE]") {
+    std::vector<uint32_t> vector = {1, 2, 3};
+    std::deque<uint32_t> deque = {4, 5};
+    std::vector<uint8_t> data;
+    Writer writer(data);
+    writer.section(sectionId("TEST"), 1, [&] { writer(vector, deque); });
+    writer.finish();
+
+    // Counts would allocate 16GB each
+    const uint32_t count = 0xffffffff;
+    const size_t vectorCount = sizeof(Header) + 3 * sizeof(uint32_t);  // After section header
+    const size_t dequeCount = vectorCount + sizeof(uint32_t) + vector.size() * sizeof(uint32_t);
+    for (size_t offset : {vectorCount, dequeCount}) {
+        std::vector<uint8_t> corrupted = data;
+        memcpy(corrupted.data() + offset, &count, sizeof(count));
+
+        std::vector<uint32_t> loadedVector;
+        std::deque<uint32_t> loadedDeque;
+        Reader reader(corrupted.data(), corrupted.size());
+        reader.section(sectionId("TEST"), 1, [&] { reader(loadedVector, loadedDeque); });
+        REQUIRE_FALSE(reader.ok());
+        REQUIRE(loadedDeque.empty());
+    }
+
+    std::vector<uint32_t> loadedVector;
+    std::deque<uint32_t> loadedDeque;
+    Reader reader(data.data(), data.size());
+    reader.section(sectionId("TEST"), 1, [&] { reader(loadedVector, loadedDeque); });
+    REQUIRE(reader.ok());
+    REQUIRE(loadedVector == vector);
+    REQUIRE(loadedDeque == deque);
+}
+TEST_CASE("Rewind restores previous frames", "[STATE]") {
+    auto sys = createSystem(withCore(CpuCore::INTERPRETER), program);
+    Rewind rewind(64 * 1024 * 1024, 1, 4);
+
+    std::vector<std::vector<uint8_t>> frames;
+    for (int i = 0; i < 10; i++) {
+        sys->emulateFrame();
+        rewind.frameEmulated(sys.get());
+        frames.emplace_back();
+        sys->saveState(frames.back());
+    }
+
+    // Keyframes and deltas of older groups are decoded
+    std::vector<uint8_t> state;
+    for (int i = 9; i >= 0; i--) {
+        REQUIRE(rewind.rewind(sys.get()));
+        sys->saveState(state);
+        REQUIRE(state == frames[i]);
+    }
+    REQUIRE_FALSE(rewind.rewind(sys.get()));
+
+    auto stats = rewind.getStats();
+    REQUIRE(stats.captured == 10);
+    REQUIRE(stats.compressionRatio > 1);
+    REQUIRE(stats.memoryUsed > 2 * frames[0].size());  // Keyframe and decoded state buffers
+
+    SECTION("Oldest states are dropped when over budget") {
+        Rewind small(frames[0].size(), 1, 4);
+        for (int i = 0; i < 20; i++) {
+            sys->emulateFrame();
+            small.frameEmulated(sys.get());
+        }
+        // Only newest group (keyframe and up to 4 deltas) fits
+        REQUIRE(small.rewind(sys.get()));
+        REQUIRE(small.getStats().entries < 5);
+
+        small.clear();
+        REQUIRE_FALSE(small.rewind(sys.get()));
+    }
+}
+TEST_CASE("Run-ahead presents future frame and continues like plain emulation", "[STATE]") {
+    for (auto core : {CpuCore::INTERPRETER, CpuCore::CACHED_INTERPRETER, CpuCore::JIT}) {
+        auto plain = createSystem(withCore(CpuCore::INTERPRETER), program);
+        auto ahead = createSystem(withCore(core), program);
+        size_t plainSamples = 0, aheadSamples = 0;
+        plain->audioCallback = [&](const int16_t*, size_t count) { plainSamples += count; };
+        ahead->audioCallback = [&](const int16_t*, size_t count) { aheadSamples += count; };
+
+        RunAhead runAhead(2, false);
+        mips::Block* block = nullptr;
+        for (int i = 0; i < 10; i++) {
+            plain->emulateFrame();
+            runAhead.runFrame(ahead.get());
+
+            // s0 counts frames
+            REQUIRE(ahead->cpu->reg[16] == plain->cpu->reg[16] + 2);
+            runAhead.restore(ahead.get());
+            requireSameState(plain.get(), ahead.get());
+
+            // Loaded state has the same code, its blocks are not recompiled
+            if (core == CpuCore::INTERPRETER) continue;
+            if (block == nullptr) block = ahead->cpu->blockCache->getBlock(PROGRAM_BASE);
+            REQUIRE(ahead->cpu->blockCache->getBlock(PROGRAM_BASE) == block);
+        }
+
+        // Samples of discarded frames are not played
+        REQUIRE(plainSamples > 0);
+        REQUIRE(aheadSamples == plainSamples);
+        REQUIRE(runAhead.getStats().headroom > 0);
+    }
+}
+
+TEST_CASE("Loading state invalidates code that changed", "[STATE]") {
+    auto sys = createSystem(withCore(CpuCore::CACHED_INTERPRETER), program);
+    runFrames(sys.get(), 2);
+    std::vector<uint8_t> saved;
+    sys->saveState(saved);
+
+    // Patched counter increment is dropped by loading the state
+    sys->writeMemory32(PROGRAM_BASE + 8, 0x26520009);  // addiu s2, s2, 9
+    runFrames(sys.get(), 2);
+    auto patched = sys->cpu->blockCache->getBlock(PROGRAM_BASE);
+    REQUIRE(patched->instructions[2].opcode.opcode == 0x26520009);
+
+    REQUIRE(sys->loadState(saved));
+    REQUIRE(sys->cpu->blockCache->getBlock(PROGRAM_BASE)->instructions[2].opcode.opcode == program[2]);
+    runFrames(sys.get(), 2);
+
+    auto reference = createSystem(withCore(CpuCore::INTERPRETER), program);
+    runFrames(reference.get(), 4);
+    requireSameState(reference.get(), sys.get());
+}
+TEST_CASE("Movie replays recorded input", "[STATE]") {
+    auto getButtons = [](System* sys) {
+        return static_cast<peripherals::DigitalController&>(*sys->controller->controller[0]).getButtons();
+    };
+
+    auto sys = createSystem(withCore(CpuCore::INTERPRETER), program);
+    Movie script;
+    REQUIRE(script.parseScript("# comment\n2 press x\n3 hold up+start 2\n"));
+    REQUIRE(script.getLength() == 7);
+
+    Movie record;
+    REQUIRE(script.startReplay(sys.get()));
+    record.startRecording(sys.get());
+    std::vector<uint16_t> applied;
+    for (int i = 0; i < 8; i++) {
+        script.update(sys.get());
+        record.update(sys.get());
+        applied.push_back(getButtons(sys.get()));
+        sys->emulateFrame();
+    }
+    REQUIRE(script.getMode() == Movie::Mode::None);
+    REQUIRE(applied[1] == 0);
+    REQUIRE(applied[2] == peripherals::DigitalController::buttonMask("cross"));
+    REQUIRE(applied[4] == (peripherals::DigitalController::buttonMask("cross") | peripherals::DigitalController::buttonMask("up")
+                           | peripherals::DigitalController::buttonMask("start")));
+
+    // Replay starts from the recorded state on a different instance
+    std::vector<uint8_t> expected;
+    sys->saveState(expected);
+    auto other = createSystem(withCore(CpuCore::INTERPRETER), program);
+    other->emulateFrame();
+    REQUIRE(record.startReplay(other.get()));
+    for (int i = 0; i < 8; i++) {
+        record.update(other.get());
+        REQUIRE(getButtons(other.get()) == applied[i]);
+        other->emulateFrame();
+    }
+    std::vector<uint8_t> replayed;
+    other->saveState(replayed);
+    REQUIRE(replayed == expected);
+
+    SECTION("Invalid script is rejected") {
+        REQUIRE_FALSE(script.parseScript("10 press nothing"));
+        REQUIRE_FALSE(script.parseScript("x press start"));
+        REQUIRE_FALSE(script.parseScript("10 hold start"));
+        REQUIRE_FALSE(script.parseScript("10 press 3:start"));
+        REQUIRE_FALSE(script.parseScript("99999999999 press x"));
+        REQUIRE_FALSE(script.parseScript("10 hold x 99999999999"));
+    }
+}
+};  // namespace state
@@ -0,0 +1,16 @@
+#pragma once
+#include <memory>
+#include "config.h"
+#include "system.h"
+
+const uint32_t PROGRAM_BASE = 0x80010000;
+
+// System without BIOS executing program loaded at PROGRAM_BASE
+template <size_t N>
+std::unique_ptr<System> createSystem(const json& options, const uint32_t (&program)[N]) {
+    auto sys = std::make_unique<System>(options);
+    for (size_t i = 0; i < N; i++) sys->writeMemory32(PROGRAM_BASE + i * 4, program[i]);
+    sys->cpu->setPC(PROGRAM_BASE);
+    sys->state = System::State::run;
+    return sys;
+}
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "translator.h"
+#include "utils/file.h"
+#include "utils/psx_exe.h"
+
+void printHelp() {
+    printf(R"(
+usage: avocado_aot game.exe output.cpp [options]
+  --compile module   - build shared object with $CXX (c++ by default)
+  --include dir      - Avocado src directory used for compilation (default: src)
+  --help             - print help
+
+Generated module is loaded with options.system.aot_module config option.
+)");
+}
+
+bool loadExe(const std::string& path, aot::Program& program) {
+    auto file = getFileContents(path);
+    if (file.size() < 0x800) {
+        printf("Unable to load %s\n", path.c_str());
+        return false;
+    }
+
+    PsxExe exe;
+    memcpy(&exe, file.data(), sizeof(exe));
+    if (memcmp(exe.magic, "PS-X EXE", 8) != 0) {
+        printf("%s is not a PS-X EXE\n", path.c_str());
+        return false;
+    }
+
+    uint32_t size = std::min<uint32_t>(exe.t_size, static_cast<uint32_t>(file.size() - 0x800));
+    program.base = exe.t_addr;
+    program.entry = exe.pc0;
+    program.words.resize(size / 4);
+    memcpy(program.words.data(), file.data() + 0x800, program.words.size() * 4);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3 || strcmp(argv[1], "--help") == 0) {
+        printHelp();
+        return 0;
+    }
+
+    std::string input = argv[1];
+    std::string output = argv[2];
+    std::string module;
+    std::string include = "src";
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--compile") == 0 && i + 1 < argc) {
+            module = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--include") == 0 && i + 1 < argc) {
+            include = argv[++i];
+            continue;
+        }
+        printf("Unknown option %s\n", argv[i]);
+        return 1;
+    }
+
+    aot::Program program;
+    if (!loadExe(input, program)) return 1;
+
+    aot::Translator translator(program);
+    translator.discover();
+    if (translator.getBlockCount() == 0) {
+        printf("No code found at entry point 0x%08x\n", program.entry);
+        return 1;
+    }
+
+    if (!putFileContents(output, translator.generate())) {
+        printf("Unable to write %s\n", output.c_str());
+        return 1;
+    }
+    printf("%s: %zu blocks translated\n", output.c_str(), translator.getBlockCount());
+
+    if (!module.empty()) {
+        if (!aot::compileModule(output, module, include)) {
+            printf("Compilation failed\n");
+            return 1;
+        }
+    }
+    return 0;
+}
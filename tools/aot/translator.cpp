@@ -0,0 +1,235 @@
+#include "translator.h"
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include "cpu/block_cache.h"
+#include "cpu/instructions.h"
+#include "debugger/debugger.h"
+#include "utils/string.h"
+
+using mips::Block;
+using mips::Opcode;
+
+namespace aot {
+namespace {
+std::string reg(int r) { return string_format("r[%d]", r); }
+std::string sreg(int r) { return string_format("(int32_t)r[%d]", r); }
+std::string hex(uint32_t value) { return string_format("0x%08xu", value); }
+
+// Instructions without side effects other than register writes (same set as jit::Recompiler emits inline).
+// Returns false for anything else, target is register written with loadAndInvalidate (-1 if none).
+bool translateNative(Opcode i, std::string& expression, int& target) {
+    const uint32_t simm = static_cast<uint32_t>(static_cast<int32_t>(i.offset));
+    target = i.op == 0 ? i.rd : i.rt;
+
+    auto binary = [&](const std::string& a, const char* op, const std::string& b) { expression = a + " " + op + " " + b; };
+    auto compare = [&](const std::string& a, const std::string& b) { expression = "(uint32_t)(" + a + " < " + b + ")"; };
+    auto shift = [&](const std::string& value, const char* op, const std::string& amount, bool arithmetic) {
+        expression = arithmetic ? "(uint32_t)(" + value + " " + op + " " + amount + ")" : value + " " + op + " " + amount;
+    };
+    const std::string variable = reg(i.rs) + " & 0x1f";
+    const std::string immediate = std::to_string(i.sh);
+
+    if (i.op == 0) {
+        switch (i.fun) {
+            case 0: shift(reg(i.rt), "<<", immediate, false); break;                  // sll
+            case 2: shift(reg(i.rt), ">>", immediate, false); break;                  // srl
+            case 3: shift(sreg(i.rt), ">>", immediate, true); break;                  // sra
+            case 4: shift(reg(i.rt), "<<", "(" + variable + ")", false); break;       // sllv
+            case 6: shift(reg(i.rt), ">>", "(" + variable + ")", false); break;       // srlv
+            case 7: shift(sreg(i.rt), ">>", "(" + variable + ")", true); break;       // srav
+            case 16: expression = "*c->hi"; break;                                    // mfhi
+            case 18: expression = "*c->lo"; break;                                    // mflo
+            case 33: binary(reg(i.rs), "+", reg(i.rt)); break;                        // addu
+            case 35: binary(reg(i.rs), "-", reg(i.rt)); break;                        // subu
+            case 36: binary(reg(i.rs), "&", reg(i.rt)); break;                        // and
+            case 37: binary(reg(i.rs), "|", reg(i.rt)); break;                        // or
+            case 38: binary(reg(i.rs), "^", reg(i.rt)); break;                        // xor
+            case 39: expression = "~(" + reg(i.rs) + " | " + reg(i.rt) + ")"; break;  // nor
+            case 42: compare(sreg(i.rs), sreg(i.rt)); break;                          // slt
+            case 43: compare(reg(i.rs), reg(i.rt)); break;                            // sltu
+            case 17:                                                                  // mthi
+            case 19:                                                                  // mtlo
+                binary(i.fun == 17 ? "*c->hi" : "*c->lo", "=", reg(i.rs));
+                target = -1;
+                break;
+            default: return false;
+        }
+        return true;
+    }
+
+    switch (i.op) {
+        case 9: binary(reg(i.rs), "+", hex(simm)); break;                                 // addiu
+        case 10: compare(sreg(i.rs), std::to_string(static_cast<int32_t>(simm))); break;  // slti
+        case 11: compare(reg(i.rs), hex(simm)); break;                                    // sltiu
+        case 12: binary(reg(i.rs), "&", hex(i.imm)); break;                               // andi
+        case 13: binary(reg(i.rs), "|", hex(i.imm)); break;                               // ori
+        case 14: binary(reg(i.rs), "^", hex(i.imm)); break;                               // xori
+        case 15: expression = hex(static_cast<uint32_t>(i.imm) << 16); break;             // lui
+        default: return false;
+    }
+    return true;
+}
+
+uint32_t branchTarget(uint32_t address, Opcode i) {
+    if (i.op == 2 || i.op == 3) return ((address + 4) & 0xf0000000) | (i.target * 4);
+    return address + 4 + i.offset * 4;
+}
+
+// Paths are passed to shell as single argument
+std::string quote(const std::string& argument) {
+#ifdef _WIN32
+    return "\"" + argument + "\"";  // Quotes are not allowed in Windows paths
+#else
+    std::string quoted = "'";
+    for (char c : argument) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+#endif
+}
+};  // namespace
+
+Translator::Translator(const Program& program) : program(program) {}
+
+bool Translator::contains(uint32_t address) const {
+    return address >= program.base && address - program.base < program.words.size() * 4 && (address & 3) == 0;
+}
+
+bool Translator::split(uint32_t address, std::vector<Opcode>& instructions) const {
+    // Must match BlockCache::compile, otherwise translation is never used
+    bool delaySlot = false;
+    for (uint32_t pc = address; instructions.size() < mips::BlockCache::MAX_BLOCK_SIZE; pc += 4) {
+        if (!contains(pc)) return false;
+
+        Opcode opcode(program.words[(pc - program.base) / 4]);
+        if (!debugger::decodeInstruction(opcode).valid) return false;
+        instructions.push_back(opcode);
+
+        if (delaySlot || Block::isException(opcode)) break;
+        delaySlot = Block::isBranch(opcode);
+    }
+    return true;
+}
+
+void Translator::discover() {
+    std::deque<uint32_t> queue = {program.entry};
+    std::map<uint32_t, bool> visited;
+
+    while (!queue.empty()) {
+        uint32_t address = queue.front();
+        queue.pop_front();
+        if (visited[address]) continue;
+        visited[address] = true;
+
+        std::vector<Opcode> instructions;
+        if (!split(address, instructions)) continue;
+
+        uint32_t end = address + static_cast<uint32_t>(instructions.size()) * 4;
+        bool fallThrough = true;
+        if (instructions.size() >= 2) {
+            uint32_t branchAddress = end - 8;
+            Opcode branch = instructions[instructions.size() - 2];
+            if (Block::isBranch(branch)) {
+                if (branch.op != 0) queue.push_back(branchTarget(branchAddress, branch));
+                // Unconditional jumps don't continue after delay slot (calls return there)
+                fallThrough = !(branch.op == 2 || (branch.op == 0 && branch.fun == 8));
+            }
+        }
+        if (fallThrough) queue.push_back(end);
+
+        blocks[address] = std::move(instructions);
+    }
+}
+
+std::string Translator::generateBlock(uint32_t address, const std::vector<Opcode>& instructions) const {
+    std::string out = string_format("static int block_%08x(Context* c) {\n", address);
+    out += "    uint32_t* r = c->reg;\n";
+    out += "    (void)r;\n";
+
+    const int count = static_cast<int>(instructions.size());
+    for (int n = 0; n < count; n++) {
+        Opcode i = instructions[n];
+        const uint32_t pc = address + n * 4;
+
+        std::string expression;
+        int target;
+        const bool native = translateNative(i, expression, target);
+        // State that is known only at block entry or after a jump
+        const bool dynamic = n == 0 || Block::isBranch(instructions[n - 1]);
+        // Load delay slots might be occupied
+        const bool pendingLoad = n == 0 || Block::isLoad(instructions[n - 1]);
+
+        auto disassembly = debugger::decodeInstruction(i);
+        out += string_format("\n    // %08x: %s %s\n", pc, disassembly.mnemonic.c_str(), disassembly.parameters.c_str());
+
+        // Native instructions can't be observed before next instruction overwrites state (except the last one)
+        if (dynamic) {
+            out += string_format("    beginDynamic(c, 0x%08xu);\n", i.opcode);
+        } else if (!native || n == count - 1) {
+            out += string_format("    begin(c, 0x%08xu, 0x%08xu);\n", pc, i.opcode);
+        }
+
+        if (!native) {
+            out += string_format("    execute(c, %u, 0x%08xu);\n", instructions::handlerIndex(i), i.opcode);
+        } else if (target == -1) {
+            out += string_format("    %s;\n", expression.c_str());
+        } else if (target != 0) {  // Writes to r0 are dropped
+            out += string_format("    r[%d] = %s;\n", target, expression.c_str());
+            if (pendingLoad) out += string_format("    invalidate(c, %d);\n", target);
+        }
+
+        if (pendingLoad || Block::isLoad(i)) out += "    moveLoadDelaySlots(c);\n";
+
+        // Interrupt, state change or code modification, exception or jump (block entered in a delay slot)
+        if (n == count - 1) continue;
+        if (!native) {
+            out += string_format("    if (*c->attention || *c->PC != 0x%08xu) return %d;\n", pc + 4, n + 1);
+        } else if (dynamic) {
+            out += string_format("    if (*c->PC != 0x%08xu) return %d;\n", pc + 4, n + 1);
+        }
+    }
+    out += string_format("    return %d;\n}\n\n", count);
+    return out;
+}
+
+std::string Translator::generate() const {
+    std::string out;
+    out += "// Generated by avocado_aot, do not edit\n";
+    out += "#include \"cpu/aot/abi.h\"\n\n";
+    out += "using namespace mips::aot;\n\n";
+
+    for (const auto& [address, instructions] : blocks) {
+        out += generateBlock(address, instructions);
+    }
+
+    for (const auto& [address, instructions] : blocks) {
+        out += string_format("static const uint32_t code_%08x[] = {", address);
+        for (size_t n = 0; n < instructions.size(); n++) {
+            out += string_format("%s0x%08xu", n == 0 ? "" : ", ", instructions[n].opcode);
+        }
+        out += "};\n";
+    }
+
+    out += "\nstatic const BlockEntry blocks[] = {\n";
+    for (const auto& [address, instructions] : blocks) {
+        out += string_format("    {0x%08xu, %zu, code_%08x, block_%08x},\n", address, instructions.size(), address, address);
+    }
+    out += "};\n\n";
+    out += "extern \"C\" AOT_EXPORT const ModuleInfo avocadoAotModule = {ABI_VERSION, sizeof(blocks) / sizeof(blocks[0]), blocks};\n";
+    return out;
+}
+
+bool compileModule(const std::string& source, const std::string& module, const std::string& include) {
+    // CXX might hold compiler with arguments (eg. "ccache g++"), it's not quoted
+    const char* cxx = getenv("CXX");
+    std::string command = std::string(cxx ? cxx : "c++") + " -std=c++17 -O2 -shared -fPIC -I" + quote(include) + " " + quote(source)
+                          + " -o " + quote(module);
+    printf("%s\n", command.c_str());
+    return system(command.c_str()) == 0;
+}
+};  // namespace aot
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "cpu/opcode.h"
+
+namespace aot {
+// Code of executable loaded at its virtual address
+struct Program {
+    uint32_t base;
+    uint32_t entry;
+    std::vector<uint32_t> words;
+};
+
+/**
+ * Finds code reachable from entry point (branch and jump targets, fall-through and return addresses)
+ * and emits C++ function for every block, split with the same rules as mips::BlockCache.
+ * Indirect jumps (jr) are not followed - code reached only by them is left to the emulator.
+ */
+class Translator {
+   public:
+    Translator(const Program& program);
+
+    void discover();
+    std::string generate() const;
+    size_t getBlockCount() const { return blocks.size(); }
+
+   private:
+    const Program& program;
+    std::map<uint32_t, std::vector<mips::Opcode>> blocks;  // Indexed by virtual address
+
+    bool contains(uint32_t address) const;
+    // Returns false if block leaves the program or holds invalid instruction (data)
+    bool split(uint32_t address, std::vector<mips::Opcode>& instructions) const;
+    std::string generateBlock(uint32_t address, const std::vector<mips::Opcode>& instructions) const;
+};
+
+// Builds generated source into shared object with $CXX (c++ by default), include is Avocado src directory
+bool compileModule(const std::string& source, const std::string& module, const std::string& include);
+};  // namespace aot